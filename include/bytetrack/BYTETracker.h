@@ -37,8 +37,15 @@ public:
 	BYTETracker(int frame_rate = 30, int track_buffer = 30);
 	~BYTETracker();
 
-	vector<STrack> update(const vector<Object>& objects, int fps, long long num_frames);
+	// roi_objects: detections on crops around weak tracks, only used by the second association
+	vector<STrack> update(const vector<Object>& objects, int fps, long long num_frames,
+		const vector<Object>& roi_objects = vector<Object>());
+	// advance every track one frame without detections, returns the tracked ones
+	vector<STrack> predict();
 	Scalar get_color(int idx);
+	const vector<STrack>& get_tracked_stracks() const { return tracked_stracks; }
+	const vector<STrack>& get_lost_stracks() const { return lost_stracks; }
+	int get_frame_id() const { return frame_id; }
 
 private:
 	vector<STrack*> joint_stracks(vector<STrack*> &tlista, vector<STrack> &tlistb);
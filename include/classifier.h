@@ -0,0 +1,113 @@
+#ifndef _RKNN_YOLOV5_DEMO_CLASSIFIER_H_
+#define _RKNN_YOLOV5_DEMO_CLASSIFIER_H_
+
+#include <stdint.h>
+
+#include "frame_pool.h"
+#include "npu_scheduler.h"
+
+#define CLASSIFIER_PATH_MAX 256
+#define CLASSIFIER_MAX_BATCH 32
+
+/**
+ * @brief Cascade classifier settings
+ *
+ * Detections of det_class (-1: every class) at least min_size pixels high
+ * and wide are queued, batch_size crops go through the classifier model
+ * together. A partial batch runs once its oldest crop has waited
+ * max_wait_ms, 0 classifies every frame on its own.
+ *
+ * The model is registered in the NPU scheduler with priority and budget_ms:
+ * a frame arriving over budget is not classified, and a batch gives way to
+ * higher priority models between runs until its oldest crop is late.
+ */
+typedef struct {
+    int enable;
+    char model_path[CLASSIFIER_PATH_MAX];
+    char label_path[CLASSIFIER_PATH_MAX];
+    int batch_size; // 0: the model batch
+    int max_wait_ms;
+    int det_class;
+    int min_size;
+    npu_priority_t priority;
+    int budget_ms;
+} classifier_config_t;
+
+struct classifier_t;
+
+/**
+ * @brief Called once every detection of a frame has its attribute
+ *
+ * The frame is still referenced by the classifier during the call.
+ */
+typedef void (*classifier_done_cb)(frame_t* frame, void* arg);
+
+/**
+ * @brief Fill cascade settings with the defaults
+ *
+ * @param config [out] Settings
+ */
+void default_classifier_config(classifier_config_t* config);
+
+/**
+ * @brief Load the classifier model and allocate the batch buffer
+ *
+ * The model takes RGB888 NHWC input, its batch is the first input dim and
+ * batch_size must be a multiple of it.
+ *
+ * @param config [in] Settings
+ * @param done [in] Frame completion callback
+ * @param arg [in] Callback argument
+ * @return classifier_t* Classifier; NULL: error
+ */
+struct classifier_t* create_classifier(const classifier_config_t* config, classifier_done_cb done, void* arg);
+
+/**
+ * @brief Classify what is queued and free the classifier
+ *
+ * @param classifier [in] Classifier, can be NULL
+ */
+void destroy_classifier(struct classifier_t* classifier);
+
+/**
+ * @brief Queue the detections of a frame
+ *
+ * Takes a reference on the frame until its detections are classified. Full
+ * batches run right away, a frame without eligible detections completes in
+ * the call.
+ *
+ * @param classifier [in] Classifier
+ * @param frame [in] Frame with results attached
+ * @param now_ms [in] frame_clock_ms()
+ * @return int 0: success; -1: error
+ */
+int classifier_submit(struct classifier_t* classifier, frame_t* frame, int64_t now_ms);
+
+/**
+ * @brief Run the partial batch whose oldest crop has waited max_wait_ms
+ *
+ * @param classifier [in] Classifier
+ * @param now_ms [in] frame_clock_ms()
+ * @return int 0: success; -1: error
+ */
+int classifier_poll(struct classifier_t* classifier, int64_t now_ms);
+
+/**
+ * @brief Get the time until the next partial batch is due
+ *
+ * @param classifier [in] Classifier
+ * @param now_ms [in] frame_clock_ms()
+ * @return int Milliseconds; -1: nothing queued
+ */
+int classifier_wait_ms(struct classifier_t* classifier, int64_t now_ms);
+
+/**
+ * @brief Get the name of an attribute class
+ *
+ * @param classifier [in] Classifier
+ * @param attr_id [in] Class index
+ * @return const char* Label, "null" when unknown
+ */
+const char* classifier_attr_name(struct classifier_t* classifier, int attr_id);
+
+#endif //_RKNN_YOLOV5_DEMO_CLASSIFIER_H_
@@ -0,0 +1,94 @@
+#ifndef _RKNN_YOLOV5_DEMO_FRAME_CHANNEL_H_
+#define _RKNN_YOLOV5_DEMO_FRAME_CHANNEL_H_
+
+#include <stdint.h>
+
+#include "frame_pool.h"
+
+struct frame_channel_t;
+
+/**
+ * @brief What a producer does when the consumer has no credit left
+ */
+typedef enum {
+    FRAME_CHANNEL_DROP_OLDEST = 0, // the oldest queued frame is released, lowest latency
+    FRAME_CHANNEL_DROP_NEWEST,     // the pushed frame is skipped, queued frames are kept
+    FRAME_CHANNEL_BLOCK,           // the producer waits for a credit
+} frame_channel_policy_t;
+
+/**
+ * @brief Counters of a channel
+ */
+typedef struct {
+    uint64_t pushed;
+    uint64_t popped;
+    uint64_t dropped;
+} frame_channel_stats_t;
+
+/**
+ * @brief Create a bounded channel in front of a pipeline stage
+ *
+ * The capacity is the number of credits the stage advertises: at most that
+ * many frames wait for it, each holding one reference.
+ *
+ * @param name [in] Stage name for logs
+ * @param capacity [in] Frames the stage can accept
+ * @param policy [in] Policy when the stage is full
+ * @return frame_channel_t* Channel; NULL: error
+ */
+struct frame_channel_t* create_frame_channel(const char* name, int capacity, frame_channel_policy_t policy);
+
+/**
+ * @brief Release the queued frames and free a channel
+ *
+ * @param channel [in] Channel
+ */
+void destroy_frame_channel(struct frame_channel_t* channel);
+
+/**
+ * @brief Hand a frame to the stage
+ *
+ * The channel takes its own reference, the caller keeps its one.
+ *
+ * @param channel [in] Channel
+ * @param frame [in] Frame
+ * @param timeout_ms [in] Credit wait timeout for FRAME_CHANNEL_BLOCK, -1 to wait forever
+ * @return int 0: queued; 1: dropped by the policy; -1: channel closed
+ */
+int frame_channel_push(struct frame_channel_t* channel, frame_t* frame, int timeout_ms);
+
+/**
+ * @brief Take the oldest queued frame
+ *
+ * @param channel [in] Channel
+ * @param timeout_ms [in] Wait timeout, 0 to poll, -1 to wait forever
+ * @return frame_t* Frame whose reference now belongs to the caller; NULL: timeout or closed and empty
+ */
+frame_t* frame_channel_pop(struct frame_channel_t* channel, int timeout_ms);
+
+/**
+ * @brief Get the number of frames the stage can still accept
+ *
+ * @param channel [in] Channel
+ * @return int Credits, 0 when full
+ */
+int frame_channel_credits(struct frame_channel_t* channel);
+
+/**
+ * @brief Close a channel, waiting producers and consumers are woken up
+ *
+ * Pushes fail afterwards, queued frames can still be popped.
+ *
+ * @param channel [in] Channel
+ */
+void frame_channel_close(struct frame_channel_t* channel);
+
+/**
+ * @brief Get the counters of a channel
+ *
+ * @param channel [in] Channel
+ * @param stats [out] Counters
+ */
+void frame_channel_get_stats(struct frame_channel_t* channel, frame_channel_stats_t* stats);
+
+#endif //_RKNN_YOLOV5_DEMO_FRAME_CHANNEL_H_
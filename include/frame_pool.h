@@ -0,0 +1,99 @@
+#ifndef _RKNN_YOLOV5_DEMO_FRAME_POOL_H_
+#define _RKNN_YOLOV5_DEMO_FRAME_POOL_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "common.h"
+#include "image_utils.h"
+#include "frame_pyramid.h"
+#include "yolov5.h"
+
+struct frame_pool_t;
+
+/**
+ * @brief Pooled frame
+ *
+ * Handed out by frame_pool_acquire() with one reference. Every stage keeping
+ * the frame takes a reference with frame_ref() and drops it with
+ * frame_unref(), the frame goes back to its pool when the last one is gone.
+ * img points to pool memory, it must not be freed or replaced. bundle holds
+ * the images derived from img at capture, they stay valid with the frame.
+ */
+typedef struct {
+    image_buffer_t img;
+    struct timeval timestamp;
+    int64_t capture_ms; // frame_clock_ms() when the frame was taken from the pool
+    uint64_t seq;
+    letterbox_t letterbox;
+    frame_bundle_t bundle;
+    object_detect_result_list results;
+    int has_results;
+
+    // owned by the pool
+    struct frame_pool_t* pool;
+    int index; // 0 to count - 1, selects buffers kept per frame
+    int refcount;
+} frame_t;
+
+/**
+ * @brief Create a pool of frames of one layout
+ *
+ * @param count [in] Number of frames, the memory bound of every stage using the pool
+ * @param width [in] Frame width
+ * @param height [in] Frame height
+ * @param format [in] Frame format
+ * @param width_stride [in] Row stride in pixels, 0: packed
+ * @return frame_pool_t* Pool; NULL: error
+ */
+struct frame_pool_t* create_frame_pool(int count, int width, int height, image_format_t format, int width_stride);
+
+/**
+ * @brief Free a pool, every frame must have been released
+ *
+ * @param pool [in] Pool
+ */
+void destroy_frame_pool(struct frame_pool_t* pool);
+
+/**
+ * @brief Take a free frame
+ *
+ * Metadata is cleared and a new sequence number is given.
+ *
+ * @param pool [in] Pool
+ * @param timeout_ms [in] Wait timeout, 0 to poll, -1 to wait forever
+ * @return frame_t* Frame with one reference; NULL: no free frame
+ */
+frame_t* frame_pool_acquire(struct frame_pool_t* pool, int timeout_ms);
+
+/**
+ * @brief Get the number of free frames
+ *
+ * @param pool [in] Pool
+ * @return int Free frames
+ */
+int frame_pool_free_count(struct frame_pool_t* pool);
+
+/**
+ * @brief Get the monotonic clock used for frame ages
+ *
+ * @return int64_t Milliseconds
+ */
+int64_t frame_clock_ms();
+
+/**
+ * @brief Take one more reference on a frame
+ *
+ * @param frame [in] Frame
+ * @return frame_t* The same frame
+ */
+frame_t* frame_ref(frame_t* frame);
+
+/**
+ * @brief Drop a reference, the frame returns to its pool on the last one
+ *
+ * @param frame [in] Frame, can be NULL
+ */
+void frame_unref(frame_t* frame);
+
+#endif //_RKNN_YOLOV5_DEMO_FRAME_POOL_H_
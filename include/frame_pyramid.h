@@ -0,0 +1,120 @@
+#ifndef _RKNN_YOLOV5_DEMO_FRAME_PYRAMID_H_
+#define _RKNN_YOLOV5_DEMO_FRAME_PYRAMID_H_
+
+#include "common.h"
+#include "image_utils.h"
+#include "rga_job.h"
+
+#define FRAME_PYRAMID_MAX_OUTPUTS 4
+
+/**
+ * @brief One output of a frame pyramid
+ *
+ * img is owned by the pyramid, handle is its RGA import kept across frames,
+ * capacity the size of its buffer.
+ * With letterbox the aspect ratio is kept and the border filled with color,
+ * otherwise the whole source is scaled on the whole target, which must then
+ * have the aspect ratio of the source.
+ */
+typedef struct {
+    image_buffer_t img;
+    int handle;
+    int capacity;
+    int letterbox;
+    char color;
+    letterbox_plan_t plan;
+} frame_pyramid_output_t;
+
+/**
+ * @brief Frame pyramid
+ *
+ * Produces every configured output from one source frame with a single RGA
+ * job: the source is imported once and all scale tasks read it in the same
+ * submission, completion is one release fence in job.
+ */
+typedef struct {
+    int num_outputs;
+    frame_pyramid_output_t outputs[FRAME_PYRAMID_MAX_OUTPUTS];
+    rga_job_t job;
+} frame_pyramid_t;
+
+/**
+ * @brief Outputs of one frame, in the order they were added
+ *
+ * letterbox maps boxes of an output back to the source frame.
+ */
+typedef struct {
+    int count;
+    image_buffer_t* images[FRAME_PYRAMID_MAX_OUTPUTS];
+    letterbox_t letterbox[FRAME_PYRAMID_MAX_OUTPUTS];
+} frame_bundle_t;
+
+/**
+ * @brief Init an empty frame pyramid
+ *
+ * @param pyramid [out] Frame pyramid
+ * @return int 0: success; -1: error
+ */
+int init_frame_pyramid(frame_pyramid_t* pyramid);
+
+/**
+ * @brief Add an output and allocate its buffer
+ *
+ * YUV420SP outputs get a 16 pixel aligned width stride so they can go to the
+ * encoder as they are.
+ *
+ * @param pyramid [in] Frame pyramid
+ * @param width [in] Output width
+ * @param height [in] Output height
+ * @param format [in] Output format
+ * @param letterbox [in] 1: keep aspect ratio and pad; 0: fill the target, same aspect ratio as the source
+ * @param color [in] Pad color
+ * @return int Output index; -1: error
+ */
+int frame_pyramid_add_output(frame_pyramid_t* pyramid, int width, int height, image_format_t format, int letterbox,
+                             char color);
+
+/**
+ * @brief Change the size of an output for the next frames
+ *
+ * The buffer is kept, so the new size must fit in the one the output was
+ * added with, e.g. the largest input shape of a model.
+ *
+ * @param pyramid [in] Frame pyramid
+ * @param index [in] Output index
+ * @param width [in] Output width
+ * @param height [in] Output height
+ * @return int 0: success; -1: larger than the buffer
+ */
+int frame_pyramid_resize_output(frame_pyramid_t* pyramid, int index, int width, int height);
+
+/**
+ * @brief Submit the conversion of a source frame into every output
+ *
+ * Waits for the previous frame first, its outputs are overwritten. The
+ * source must stay valid until frame_pyramid_wait() returns.
+ *
+ * @param pyramid [in] Frame pyramid
+ * @param src_image [in] Source frame
+ * @return int 0: submitted or done; -1: error
+ */
+int frame_pyramid_submit(frame_pyramid_t* pyramid, image_buffer_t* src_image);
+
+/**
+ * @brief Wait for the submitted frame and publish its outputs
+ *
+ * @param pyramid [in] Frame pyramid
+ * @param bundle [out] Outputs of the frame
+ * @param timeout_ms [in] Wait timeout, 0 to poll, -1 to wait forever
+ * @return int 0: bundle ready; 1: still running; -1: error
+ */
+int frame_pyramid_wait(frame_pyramid_t* pyramid, frame_bundle_t* bundle, int timeout_ms);
+
+/**
+ * @brief Wait for pending work and free the outputs
+ *
+ * @param pyramid [in] Frame pyramid
+ */
+void release_frame_pyramid(frame_pyramid_t* pyramid);
+
+#endif //_RKNN_YOLOV5_DEMO_FRAME_PYRAMID_H_
@@ -0,0 +1,89 @@
+#ifndef _RKNN_YOLOV5_DEMO_INFER_CLIENT_H_
+#define _RKNN_YOLOV5_DEMO_INFER_CLIENT_H_
+
+#include <stdint.h>
+
+#include "common.h"
+#include "yolov5.h"
+
+struct infer_client_t;
+
+/**
+ * @brief Connect to an inference server
+ *
+ * The client allocates a ring of num_slots model inputs in a memfd and
+ * hands it to the server: frames are written in place and the results come
+ * back in the same slots, only slot numbers go through the socket.
+ *
+ * @param path [in] Server socket path
+ * @param num_slots [in] Frames in flight at most
+ * @return infer_client_t* Client; NULL: error
+ */
+struct infer_client_t* infer_client_connect(const char* path, int num_slots);
+
+/**
+ * @brief Disconnect and unmap the ring
+ *
+ * @param client [in] Client, can be NULL
+ */
+void infer_client_close(struct infer_client_t* client);
+
+/**
+ * @brief Get the model input of the server
+ *
+ * @param client [in] Client
+ * @param width [out] Model input width
+ * @param height [out] Model input height
+ * @param channels [out] Model input channels
+ */
+void infer_client_model_size(struct infer_client_t* client, int* width, int* height, int* channels);
+
+/**
+ * @brief Get the model input image of a slot, in the shared ring
+ *
+ * Write it only while the slot is not submitted.
+ *
+ * @param client [in] Client
+ * @param slot [in] Slot index
+ * @param img [out] RGB888 image of the model input size
+ * @return int 0: success; -1: no such slot
+ */
+int infer_client_slot_image(struct infer_client_t* client, int slot, image_buffer_t* img);
+
+/**
+ * @brief Hand a slot to the server
+ *
+ * @param client [in] Client
+ * @param slot [in] Slot whose image is ready
+ * @param letterbox [in] Letterbox of the image, boxes are mapped back with it
+ * @param seq [in] Caller sequence number, returned with the results
+ * @return int 0: success; -1: error, the server is gone
+ */
+int infer_client_submit(struct infer_client_t* client, int slot, const letterbox_t* letterbox, uint64_t seq);
+
+/**
+ * @brief Wait for the next done slot
+ *
+ * results points into the ring and stays valid until the slot is submitted
+ * again.
+ *
+ * @param client [in] Client
+ * @param timeout_ms [in] Wait timeout, 0 to poll, -1 to wait forever
+ * @param slot [out] Slot done
+ * @param seq [out] Sequence number given on submit, can be NULL
+ * @param results [out] Results of the slot
+ * @return int 0: slot done, check the status returned by infer_client_status(); 1: timeout; -1: error
+ */
+int infer_client_wait(struct infer_client_t* client, int timeout_ms, int* slot, uint64_t* seq,
+                      object_detect_result_list** results);
+
+/**
+ * @brief Get the inference status of a done slot
+ *
+ * @param client [in] Client
+ * @param slot [in] Slot index
+ * @return int 0: results valid; -1: inference failed
+ */
+int infer_client_status(struct infer_client_t* client, int slot);
+
+#endif //_RKNN_YOLOV5_DEMO_INFER_CLIENT_H_
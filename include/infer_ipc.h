@@ -0,0 +1,146 @@
+#ifndef _RKNN_YOLOV5_DEMO_INFER_IPC_H_
+#define _RKNN_YOLOV5_DEMO_INFER_IPC_H_
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// older C libraries lack the memfd seals
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+
+#include "common.h"
+#include "yolov5.h"
+
+#define INFER_IPC_MAGIC 0x52494e46 // "RINF"
+#define INFER_IPC_VERSION 1
+#define INFER_IPC_MAX_SLOTS 16
+// the ring memfd is sealed against size changes, the server maps it only then
+#define INFER_RING_SEALS (F_SEAL_SHRINK | F_SEAL_GROW)
+
+/**
+ * @brief Messages between the inference server and its clients
+ *
+ * The socket is a Unix SOCK_SEQPACKET one, a message is one packet:
+ *   server -> client  INFER_MSG_MODEL   model input width, height, channels
+ *   client -> server  INFER_MSG_RING    num_slots, ring_size, the ring fd, sealed with INFER_RING_SEALS
+ *   server -> client  INFER_MSG_RING    status: 0 ring mapped; -1 refused
+ *   client -> server  INFER_MSG_SUBMIT  slot, seq
+ *   server -> client  INFER_MSG_DONE    slot, seq, status
+ * Images and results never go through the socket, only slot numbers.
+ */
+typedef enum {
+    INFER_MSG_MODEL = 1,
+    INFER_MSG_RING,
+    INFER_MSG_SUBMIT,
+    INFER_MSG_DONE,
+} infer_msg_type_t;
+
+typedef struct {
+    int32_t type;
+    int32_t slot;
+    uint64_t seq;
+    int32_t status;
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    int32_t num_slots;
+    int64_t ring_size;
+} infer_msg_t;
+
+/**
+ * @brief Start of the shared ring, written once by the client
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t num_slots;
+    int32_t image_size;
+    int32_t slot_stride;
+} infer_ring_header_t;
+
+/**
+ * @brief One slot of the ring, followed by its model input image
+ *
+ * The client owns the slot until it is submitted and again once it is done:
+ * it writes letterbox and the image, the server writes status and results.
+ */
+typedef struct {
+    uint64_t seq;
+    int32_t status;
+    letterbox_t letterbox;
+    object_detect_result_list results;
+} infer_slot_t;
+
+/**
+ * @brief Get the size of a ring
+ *
+ * @param num_slots [in] Number of slots
+ * @param image_size [in] Bytes of one model input image
+ * @return size_t Ring size
+ */
+size_t infer_ring_size(int num_slots, int image_size);
+
+/**
+ * @brief Fill the header of a new ring
+ *
+ * @param ring [in] Mapped ring
+ * @param num_slots [in] Number of slots
+ * @param image_size [in] Bytes of one model input image
+ */
+void infer_ring_init(void* ring, int num_slots, int image_size);
+
+/**
+ * @brief Check a ring mapped from a peer
+ *
+ * @param ring [in] Mapped ring
+ * @param ring_size [in] Mapped size
+ * @param image_size [in] Bytes of one model input image expected
+ * @return int Number of slots; -1: invalid ring
+ */
+int infer_ring_check(const void* ring, size_t ring_size, int image_size);
+
+/**
+ * @brief Get a slot of a ring
+ *
+ * @param ring [in] Mapped ring
+ * @param slot [in] Slot index, checked by the caller
+ * @return infer_slot_t* Slot
+ */
+infer_slot_t* infer_ring_slot(void* ring, int slot);
+
+/**
+ * @brief Get the model input image of a slot
+ *
+ * @param ring [in] Mapped ring
+ * @param slot [in] Slot index, checked by the caller
+ * @return unsigned char* Image bytes
+ */
+unsigned char* infer_ring_image(void* ring, int slot);
+
+/**
+ * @brief Send one message
+ *
+ * @param sock [in] Connected socket
+ * @param msg [in] Message
+ * @param fd [in] File descriptor passed along, -1: none
+ * @return int 0: success; -1: error
+ */
+int infer_send_msg(int sock, const infer_msg_t* msg, int fd);
+
+/**
+ * @brief Receive one message
+ *
+ * @param sock [in] Connected socket
+ * @param msg [out] Message
+ * @param fd [out] File descriptor passed along, -1: none; NULL: closed if any
+ * @param timeout_ms [in] Wait timeout, 0 to poll, -1 to wait forever
+ * @return int 0: message received; 1: timeout; -1: error or peer gone
+ */
+int infer_recv_msg(int sock, infer_msg_t* msg, int* fd, int timeout_ms);
+
+#endif //_RKNN_YOLOV5_DEMO_INFER_IPC_H_
@@ -0,0 +1,75 @@
+#ifndef _RKNN_YOLOV5_DEMO_INFER_SERVER_H_
+#define _RKNN_YOLOV5_DEMO_INFER_SERVER_H_
+
+#include "common.h"
+#include "yolov5.h"
+
+#define INFER_SERVER_MAX_CLIENTS 16
+#define INFER_SERVER_MAX_BATCH (INFER_SERVER_MAX_CLIENTS * 4)
+
+struct infer_server_t;
+
+/**
+ * @brief One frame submitted by a client
+ *
+ * img is the model input in the client ring and results the slot results,
+ * both are used in place.
+ */
+typedef struct {
+    image_buffer_t img;
+    letterbox_t letterbox;
+    object_detect_result_list* results;
+    int status; // set by the backend, 0: results valid
+} infer_request_t;
+
+/**
+ * @brief What runs the submitted frames
+ *
+ * run gets every frame submitted by every client since the last call, in
+ * the order they arrived, and sets the status of each.
+ */
+typedef struct {
+    int width;
+    int height;
+    int channels;
+    void (*run)(infer_request_t* requests, int count, void* arg);
+    void* arg;
+} infer_backend_t;
+
+/**
+ * @brief Listen for clients on a Unix socket
+ *
+ * An existing socket file at path is replaced.
+ *
+ * @param path [in] Socket path
+ * @param backend [in] Backend, copied
+ * @return infer_server_t* Server; NULL: error
+ */
+struct infer_server_t* create_infer_server(const char* path, const infer_backend_t* backend);
+
+/**
+ * @brief Close every client connection and remove the socket
+ *
+ * @param server [in] Server, can be NULL
+ */
+void destroy_infer_server(struct infer_server_t* server);
+
+/**
+ * @brief Serve clients until infer_server_stop()
+ *
+ * A client going away only drops its connection and its ring, the backend
+ * and the other clients go on.
+ *
+ * @param server [in] Server
+ * @return int 0: stopped; -1: error
+ */
+int infer_server_run(struct infer_server_t* server);
+
+/**
+ * @brief Make infer_server_run() return, safe from a signal handler
+ *
+ * @param server [in] Server
+ */
+void infer_server_stop(struct infer_server_t* server);
+
+#endif //_RKNN_YOLOV5_DEMO_INFER_SERVER_H_
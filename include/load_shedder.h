@@ -0,0 +1,95 @@
+#ifndef _RKNN_YOLOV5_DEMO_LOAD_SHEDDER_H_
+#define _RKNN_YOLOV5_DEMO_LOAD_SHEDDER_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Load shedder settings
+ *
+ * Levels step down the inference rate first (1 of 2 frames, 1 of 3, ... up
+ * to 1 of max_rate_divisor), then the model input resolution for
+ * resolution_levels more steps, on models compiled with smaller input
+ * shapes of the same aspect.
+ */
+typedef struct {
+    int enable;
+    int max_latency_ms;   // capture to result budget of a frame
+    int window;           // frames per level decision
+    float overload_ratio; // step down when more of a window was late
+    float headroom_ratio; // step up when the worst latency of a window is under this share of the budget
+    int max_rate_divisor;
+    int resolution_levels;
+} load_shedder_config_t;
+
+/**
+ * @brief Counters and current decision of a load shedder
+ */
+typedef struct {
+    uint64_t admitted;
+    uint64_t completed;
+    uint64_t dropped_late; // dropped before the NPU, could not finish in time
+    uint64_t skipped_rate; // skipped by the reduced inference rate
+    uint64_t missed;       // completed after their deadline
+    uint64_t step_downs;
+    uint64_t step_ups;
+    int level;
+    int rate_divisor;
+    int resolution_level;
+    float avg_service_ms; // admission to result
+    float avg_latency_ms; // capture to result
+} load_shedder_stats_t;
+
+typedef struct {
+    load_shedder_config_t config;
+    load_shedder_stats_t stats;
+    uint64_t frame_count;
+    int late_in_row;
+    int window_frames;
+    int window_late;
+    int64_t window_max_latency;
+} load_shedder_t;
+
+/**
+ * @brief Fill load shedder settings with the defaults
+ *
+ * @param config [out] Settings
+ */
+void default_load_shedder_config(load_shedder_config_t* config);
+
+/**
+ * @brief Init a load shedder at full rate and resolution
+ *
+ * @param shedder [out] Load shedder
+ * @param config [in] Settings
+ */
+void init_load_shedder(load_shedder_t* shedder, const load_shedder_config_t* config);
+
+/**
+ * @brief Decide whether a frame goes to the NPU
+ *
+ * @param shedder [in] Load shedder
+ * @param capture_ms [in] Capture time of the frame
+ * @param now_ms [in] Current time, same clock
+ * @return int 1: infer the frame; 0: drop it
+ */
+int load_shedder_admit(load_shedder_t* shedder, int64_t capture_ms, int64_t now_ms);
+
+/**
+ * @brief Account the result of an admitted frame
+ *
+ * @param shedder [in] Load shedder
+ * @param capture_ms [in] Capture time of the frame
+ * @param admit_ms [in] Time the frame was admitted
+ * @param now_ms [in] Time its result is ready
+ */
+void load_shedder_complete(load_shedder_t* shedder, int64_t capture_ms, int64_t admit_ms, int64_t now_ms);
+
+/**
+ * @brief Get the counters and the current decision
+ *
+ * @param shedder [in] Load shedder
+ * @param stats [out] Counters
+ */
+void load_shedder_get_stats(const load_shedder_t* shedder, load_shedder_stats_t* stats);
+
+#endif //_RKNN_YOLOV5_DEMO_LOAD_SHEDDER_H_
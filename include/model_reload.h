@@ -0,0 +1,62 @@
+#ifndef _RKNN_YOLOV5_DEMO_MODEL_RELOAD_H_
+#define _RKNN_YOLOV5_DEMO_MODEL_RELOAD_H_
+
+#include "yolov5.h"
+
+#define MODEL_RELOAD_PATH_MAX 256
+
+struct model_reloader_t;
+
+/**
+ * @brief Create the background loader of detector models
+ *
+ * Models are loaded and warmed up on a thread of their own, the NPU runs of
+ * the warm up go through the scheduler at low priority and give way to the
+ * running pipeline, retired contexts are released on the same thread.
+ *
+ * @param warmup_runs [in] Dummy inferences before a model is handed over
+ * @return model_reloader_t* Reloader; NULL: error
+ */
+struct model_reloader_t* create_model_reloader(int warmup_runs);
+
+/**
+ * @brief Stop the thread and release every context it still holds
+ *
+ * @param reloader [in] Reloader, can be NULL
+ */
+void destroy_model_reloader(struct model_reloader_t* reloader);
+
+/**
+ * @brief Start loading a model
+ *
+ * @param reloader [in] Reloader
+ * @param model_path [in] Model file, copied
+ * @param box_threshold [in] Box threshold of the new context
+ * @param nms_threshold [in] NMS threshold of the new context
+ * @param float_outputs [in] float_outputs of the new context
+ * @param init_flags [in] rknn_init flags of the new context, with RKNN_FLAG_MEM_ALLOC_OUTSIDE it is
+ *                        warmed up on an internal memory of its own (own_internal_mem), see
+ *                        model_switch_attach()
+ * @return int 0: queued; -1: a load is already running or waiting to be taken
+ */
+int model_reloader_request(struct model_reloader_t* reloader, const char* model_path, float box_threshold,
+                           float nms_threshold, int float_outputs, uint32_t init_flags);
+
+/**
+ * @brief Take a loaded and warmed up model
+ *
+ * @param reloader [in] Reloader
+ * @param app_ctx [out] Context, owned by the caller
+ * @return int 1: taken; 0: nothing ready
+ */
+int model_reloader_take(struct model_reloader_t* reloader, rknn_app_context_t* app_ctx);
+
+/**
+ * @brief Release a context no frame uses anymore, off the caller thread
+ *
+ * @param reloader [in] Reloader
+ * @param app_ctx [in] Context, copied and cleared
+ */
+void model_reloader_retire(struct model_reloader_t* reloader, rknn_app_context_t* app_ctx);
+
+#endif //_RKNN_YOLOV5_DEMO_MODEL_RELOAD_H_
@@ -0,0 +1,116 @@
+#ifndef _RKNN_YOLOV5_DEMO_MODEL_SWITCH_H_
+#define _RKNN_YOLOV5_DEMO_MODEL_SWITCH_H_
+
+#include <stdint.h>
+
+#include "rknn_api.h"
+#include "yolov5.h"
+
+#define MODEL_SWITCH_PATH_MAX 256
+
+/**
+ * @brief Small / large detector switching settings
+ *
+ * The stream goes to the small model when the NPU is busy more than
+ * high_util of the time or frames find queue_ratio of the time a frame
+ * already waiting, unless the scene is complex: complex_detections boxes
+ * on average keep the large model until the NPU is saturated. It comes
+ * back when the large model is expected to use less than low_util, the
+ * expectation scaling the measured use with the run times of both models.
+ * A model is kept min_dwell_ms at least.
+ */
+typedef struct {
+    int enable;
+    char small_model_path[MODEL_SWITCH_PATH_MAX];
+    float high_util;
+    float low_util;
+    float queue_ratio;
+    int complex_detections;
+    int min_dwell_ms;
+    int window_ms;
+    int share_memory; // both contexts run on one internal memory
+} model_switch_config_t;
+
+typedef struct {
+    model_switch_config_t config;
+    rknn_app_context_t* large; // the pipeline context, can be replaced by a reload
+    rknn_app_context_t small;
+    rknn_tensor_mem* internal_mem; // created with the small context, NULL: not shared
+    int use_small;
+    int64_t switched_ms;
+    uint64_t switches;
+
+    // measure of the current window
+    int64_t window_start_ms;
+    double window_busy_ms;
+    int window_frames;
+    int window_queued;
+    float util;
+    float det_avg;
+    float run_ms[2]; // average run of the large and the small model
+} model_switch_t;
+
+/**
+ * @brief Fill switching settings with the defaults
+ *
+ * @param config [out] Settings
+ */
+void default_model_switch_config(model_switch_config_t* config);
+
+/**
+ * @brief Load both models
+ *
+ * large must hold model_path and thresholds and not be loaded yet. With
+ * share_memory both are initialized with RKNN_FLAG_MEM_ALLOC_OUTSIDE and
+ * get one internal memory of the larger size, they never run at the same
+ * time. Both models must have the same input size.
+ *
+ * @param sw [out] Model switch
+ * @param config [in] Settings
+ * @param large [in] Pipeline context, loaded here
+ * @return int 0: success; -1: error, nothing stays loaded
+ */
+int init_model_switch(model_switch_t* sw, const model_switch_config_t* config, rknn_app_context_t* large);
+
+/**
+ * @brief Release the small model and the shared memory
+ *
+ * The large context must be released before.
+ *
+ * @param sw [in] Model switch
+ */
+void release_model_switch(model_switch_t* sw);
+
+/**
+ * @brief Give a new large context the shared internal memory
+ *
+ * For a reloaded model initialized with the flags of the switch, before it
+ * replaces the large one; the memory it was warmed up on is released. Nothing
+ * to do without share_memory.
+ *
+ * @param sw [in] Model switch
+ * @param app_ctx [in] New large context
+ * @return int 0: success; -1: it needs more memory than is shared, or error
+ */
+int model_switch_attach(model_switch_t* sw, rknn_app_context_t* app_ctx);
+
+/**
+ * @brief Get the model the next frame runs on
+ *
+ * @param sw [in] Model switch
+ * @return rknn_app_context_t* Small or large context
+ */
+rknn_app_context_t* model_switch_active(model_switch_t* sw);
+
+/**
+ * @brief Account one inference and decide the model of the next ones
+ *
+ * @param sw [in] Model switch
+ * @param run_ms [in] Inference time of the frame
+ * @param queued [in] Frames waiting for inference when it finished
+ * @param detections [in] Boxes found
+ * @param now_ms [in] frame_clock_ms()
+ */
+void model_switch_update(model_switch_t* sw, float run_ms, int queued, int detections, int64_t now_ms);
+
+#endif //_RKNN_YOLOV5_DEMO_MODEL_SWITCH_H_
@@ -11,6 +11,7 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <rockchip/rk_mpi.h>
 #ifdef __cplusplus
         extern "C"
@@ -45,8 +46,10 @@ typedef struct {
         // paramter for resource malloc
         RK_U32 width;
         RK_U32 height;
+        // in pixels, set them before init_mpp to match the producer, 0: align to 16
         RK_U32 hor_stride;
         RK_U32 ver_stride;
+        // MPP_FMT_YUV422_YUYV (default) or MPP_FMT_YUV420SP, set before init_mpp
         MppFrameFormat fmt;
         MppCodingType type;
         RK_U32 num_frames;
@@ -0,0 +1,116 @@
+#ifndef _RKNN_YOLOV5_DEMO_NPU_SCHEDULER_H_
+#define _RKNN_YOLOV5_DEMO_NPU_SCHEDULER_H_
+
+#include "rknn_api.h"
+
+#define NPU_SCHED_MAX_MODELS 8
+
+typedef enum {
+    NPU_PRIORITY_HIGH,
+    NPU_PRIORITY_NORMAL,
+    NPU_PRIORITY_LOW,
+    NPU_PRIORITY_NUM
+} npu_priority_t;
+
+/**
+ * @brief Model sharing the NPU
+ *
+ * budget_ms is the NPU time the model may use per second, 0: unlimited.
+ * has_work tells whether the model has jobs waiting outside the scheduler,
+ * e.g. frames queued before the detector, can be NULL.
+ */
+typedef struct {
+    const char* name;
+    npu_priority_t priority;
+    int budget_ms;
+    int (*has_work)(void* arg);
+    void* arg;
+} npu_model_desc_t;
+
+/**
+ * @brief Per model accounting
+ *
+ * queue is the time from npu_sched_run() to the NPU being granted, exec
+ * the time spent in rknn_run.
+ */
+typedef struct {
+    unsigned long long runs;
+    unsigned long long rejected;
+    unsigned long long yields;
+    double queue_ms_total;
+    double queue_ms_max;
+    double exec_ms_total;
+    double exec_ms_max;
+} npu_model_stats_t;
+
+/**
+ * @brief Init the scheduler shared by every RKNN context of the process
+ *
+ * At most slots rknn_run calls are in flight, a free slot goes to the waiting
+ * model of highest priority. Jobs are not interrupted: low priority work
+ * gives way between runs with npu_sched_should_yield().
+ *
+ * @param slots [in] Concurrent runs, 1 serializes the NPU
+ * @param report_sec [in] Period of the stats print, 0: only on deinit
+ * @return int 0: success; -1: error
+ */
+int npu_sched_init(int slots, int report_sec);
+
+/**
+ * @brief Print the stats and forget every model
+ */
+void npu_sched_deinit();
+
+/**
+ * @brief Register a model
+ *
+ * @param desc [in] Model description, name is copied
+ * @return int Model id, > 0; -1: error
+ */
+int npu_sched_register(const npu_model_desc_t* desc);
+
+/**
+ * @brief Run a context when the NPU is granted to the model
+ *
+ * @param id [in] Model id, 0 runs without scheduling
+ * @param ctx [in] RKNN context
+ * @param extend [in] rknn_run extension, can be NULL
+ * @return int rknn_run result
+ */
+int npu_sched_run(int id, rknn_context ctx, rknn_run_extend* extend);
+
+/**
+ * @brief Admission control, whether the model is within its budget
+ *
+ * A rejected job should be dropped or deferred, it is counted.
+ *
+ * @param id [in] Model id
+ * @return int 1: admitted; 0: budget used up for this second
+ */
+int npu_sched_admit(int id);
+
+/**
+ * @brief Whether a model of higher priority is waiting for the NPU
+ *
+ * Checked by multi-run jobs between runs, a yield is counted.
+ *
+ * @param id [in] Model id
+ * @return int 1: give way; 0: continue
+ */
+int npu_sched_should_yield(int id);
+
+/**
+ * @brief Get the accounting of a model
+ *
+ * @param id [in] Model id
+ * @param stats [out] Stats
+ * @return int 0: success; -1: unknown model
+ */
+int npu_sched_get_stats(int id, npu_model_stats_t* stats);
+
+/**
+ * @brief Print queueing delay versus execution time of every model
+ */
+void npu_sched_dump();
+
+#endif //_RKNN_YOLOV5_DEMO_NPU_SCHEDULER_H_
@@ -0,0 +1,172 @@
+#ifndef _RKNN_YOLOV5_DEMO_PIPELINE_CONFIG_H_
+#define _RKNN_YOLOV5_DEMO_PIPELINE_CONFIG_H_
+
+#include "common.h"
+#include "frame_channel.h"
+#include "load_shedder.h"
+#include "motion_detect.h"
+#include "tracking.h"
+#include "tiled_detect.h"
+#include "classifier.h"
+#include "npu_scheduler.h"
+#include "model_switch.h"
+
+#define PIPELINE_PATH_MAX 256
+
+/**
+ * @brief Settings shared by every stage
+ *
+ * queue_depth is the number of credits the stage advertises to its producer
+ * and policy what the producer does when they are used up. threads bounds the
+ * CPU work of the stage, 0 uses every core.
+ */
+typedef struct {
+    int threads;
+    int queue_depth;
+    frame_channel_policy_t policy;
+} stage_config_t;
+
+// the CPU letterbox runs inline on the detector thread, it has no queue
+typedef struct {
+    int threads;
+} preprocess_config_t;
+
+typedef struct {
+    char device[PIPELINE_PATH_MAX];
+    int width;
+    int height;
+    image_format_t format;
+    int pool_size;
+} source_config_t;
+
+// stage.threads is unused, the detector thread does the whole inference
+typedef struct {
+    stage_config_t stage;
+    char model_path[PIPELINE_PATH_MAX];
+    char label_path[PIPELINE_PATH_MAX];
+    float box_threshold;
+    float nms_threshold;
+    // rknn_infer_server socket, empty: the model runs in this process
+    char server[PIPELINE_PATH_MAX];
+    // dummy inferences of a reloaded model before it takes over
+    int reload_warmup;
+    // input shape of a dynamic shape model, 0x0: picked from the source size
+    int input_width;
+    int input_height;
+    // 1: fp16 model outputs converted to fp32 by the runtime, 0: decoded as fp16
+    int float_outputs;
+    // outputs of the first inference saved there for rknn_decode_replay, empty: off
+    char record_path[PIPELINE_PATH_MAX];
+} inference_config_t;
+
+typedef struct {
+    stage_config_t stage;
+    int enable;
+    int fps;
+    int gop;
+    int bitrate;
+    int overlay;
+    char url[PIPELINE_PATH_MAX];
+} encode_config_t;
+
+// thumbnail for the preview UI, letterboxed into width x height
+typedef struct {
+    int enable;
+    int width;
+    int height;
+    image_format_t format;
+} preview_config_t;
+
+typedef struct {
+    int slots;
+    int report_sec;
+    npu_priority_t detector_priority;
+} npu_config_t;
+
+/**
+ * @brief Pipeline config
+ *
+ * The stages are wired at build time, the INI file sets them up. One
+ * section per stage:
+ *   [source]     device, width, height, format (yuyv, nv12), pool_size
+ *   [preprocess] threads of the CPU letterbox fallback, it runs inline
+ *                before inference on the two model input slots
+ *   [inference]  model, labels, box_threshold, nms_threshold; server: send
+ *                the model inputs to rknn_infer_server instead, model and
+ *                thresholds are then the server ones; reload_warmup: runs
+ *                of a model reloaded on SIGHUP before it is swapped in;
+ *                input_shape: auto or WxH, one of a dynamic shape model;
+ *                float_outputs: fp16 models decode fp32 outputs; record:
+ *                file of the first output tensors, for rknn_decode_replay
+ *   [overlay]    enable: draw the detections on the streamed frames
+ *   [encode]     enable, fps, gop, bitrate (0: derived from size and fps)
+ *   [preview]    enable, width, height, format (rgb, nv12): thumbnail of
+ *                every capture, published in the frame bundle
+ *   [sink]       url: RTMP output, the encode branch runs only when it is set
+ *   [shedder]    enable, max_latency_ms, window, overload_ratio,
+ *                headroom_ratio, max_rate_divisor, resolution_levels: frames
+ *                dropped before the NPU, see load_shedder_config_t
+ *   [motion]     enable, scale, tile_size, threshold, min_tiles, bg_shift,
+ *                max_skip: static frames skip inference, see motion_config_t
+ *   [tracking]   enable, detect_interval, adaptive, max_drift,
+ *                min_confidence, track_buffer: detect every N frames and
+ *                predict the boxes in between; redetect, redetect_max_rois,
+ *                redetect_min_height, redetect_lost_frames: look again at
+ *                native resolution around weak tracks, see tracking_config_t
+ *   [tiling]     enable, overlap, full_frame, nms_threshold, ios_threshold,
+ *                region = x, y, w, h (repeated, none: whole frame): detect on
+ *                model size tiles of the regions, see tiling_config_t
+ *   [cascade]    enable, model, labels, batch_size, max_wait_ms, det_class,
+ *                min_size: classify the detections in batches of crops, see
+ *                classifier_config_t; priority, budget_ms: its NPU share
+ *   [switching]  enable, small_model, high_util, low_util, queue_ratio,
+ *                complex_detections, min_dwell_ms, window_ms, share_memory:
+ *                run the small model while the NPU is overloaded, see
+ *                model_switch_config_t
+ *   [npu]        slots: models running at once, report_sec (0: off),
+ *                detector_priority; priorities are high, normal, low
+ * inference also takes queue_depth and policy (drop_oldest, drop_newest,
+ * block) of its input channel, encode threads, queue_depth and policy. The
+ * source pushes every frame into two channels: the detector thread runs
+ * preprocess, inference and tracking on its own, the encode thread draws the
+ * overlay, encodes and sends to the sink. Keys no stage honours are refused.
+ */
+typedef struct {
+    source_config_t source;
+    preprocess_config_t preprocess;
+    inference_config_t inference;
+    encode_config_t encode;
+    preview_config_t preview;
+    load_shedder_config_t shedder;
+    motion_config_t motion;
+    tracking_config_t tracking;
+    tiling_config_t tiling;
+    classifier_config_t cascade;
+    npu_config_t npu;
+    model_switch_config_t switching;
+} pipeline_config_t;
+
+/**
+ * @brief Fill a config with the built-in defaults
+ *
+ * @param config [out] Pipeline config
+ */
+void default_pipeline_config(pipeline_config_t* config);
+
+/**
+ * @brief Override a config with the keys of an INI file
+ *
+ * @param path [in] INI file path
+ * @param config [in/out] Pipeline config, keys absent from the file keep their value
+ * @return int 0: success; -1: error
+ */
+int load_pipeline_config(const char* path, pipeline_config_t* config);
+
+/**
+ * @brief Print the effective config
+ *
+ * @param config [in] Pipeline config
+ */
+void dump_pipeline_config(const pipeline_config_t* config);
+
+#endif //_RKNN_YOLOV5_DEMO_PIPELINE_CONFIG_H_
@@ -14,6 +14,9 @@
 #define NMS_THRESH 0.45
 #define BOX_THRESH 0.25
 #define PROP_BOX_SIZE (5 + OBJ_CLASS_NUM)
+#define POST_MAX_OUTPUTS 16
+#define POST_MAX_DECODERS 8
+#define SEG_MAX_RUNS 65536
 
 // class rknn_app_context_t;
 
@@ -21,6 +24,11 @@ typedef struct {
     image_rect_t box;
     float prop;
     int cls_id;
+    int track_id;  // 0: not tracked
+    int predicted; // 1: box predicted by the tracker, not detected on this frame
+    int attr_id;     // class given by the cascade classifier
+    float attr_prop; // 0: not classified
+    int mask_area;   // pixels of the instance mask in the source image, 0: no mask
 } object_detect_result;
 
 typedef struct {
@@ -29,11 +37,108 @@ typedef struct {
     object_detect_result results[OBJ_NUMB_MAX_SIZE];
 } object_detect_result_list;
 
-int init_post_process();
+/**
+ * @brief Instance masks of one frame, mask k belongs to result k
+ *
+ * A mask is run lengths over the pixels of its result box, row by row:
+ * background and object alternate, starting with background (0 when the
+ * first pixel is object). run_count -1: the pool was full, only the
+ * mask_area of the result holds.
+ */
+typedef struct seg_mask_list_t {
+    int count;
+    int used; // runs taken in the pool
+    int run_start[OBJ_NUMB_MAX_SIZE];
+    int run_count[OBJ_NUMB_MAX_SIZE];
+    uint32_t runs[SEG_MAX_RUNS];
+} seg_mask_list_t;
+
+// raw output tensors of one inference in output_attrs order
+typedef struct {
+    int count;
+    void* buf[POST_MAX_OUTPUTS];
+    uint32_t size[POST_MAX_OUTPUTS];
+} post_outputs_t;
+
+/**
+ * @brief Detection head decoder
+ *
+ * decode appends the candidates of one frame in model input pixels, boxes
+ * as x, y, w, h, with their score and class, and any data a head carries
+ * per candidate in extras; NMS and the letterbox undo are common to every
+ * head. assemble then works on the kept results only, candidates giving
+ * the candidate index of each. Tensors are int8 when is_quant, native fp16
+ * when is_fp16, fp32 otherwise.
+ */
+typedef struct post_decoder_t {
+    const char* name;
+    // 1: the outputs have the layout of this head
+    int (*match)(const rknn_app_context_t* app_ctx);
+    int (*decode)(const rknn_app_context_t* app_ctx, void** buffers, float conf_threshold, std::vector<float>& boxes,
+                  std::vector<float>& probs, std::vector<int>& class_ids, std::vector<float>& extras);
+    // NULL: boxes only
+    void (*assemble)(const rknn_app_context_t* app_ctx, void** buffers, const float* extras, const int* candidates,
+                     const letterbox_t* letter_box, object_detect_result_list* od_results);
+} post_decoder_t;
+
+// label_path: one class name per line, nullptr for the coco labels next to the model
+int init_post_process(const char *label_path = nullptr);
 void deinit_post_process();
 char *coco_cls_to_name(int cls_id);
 int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter_box, float conf_threshold, float nms_threshold, object_detect_result_list *od_results);
-void yuyv_to_rgb(unsigned char *yuv, unsigned char *rgb, int width, int height);
+
+/**
+ * @brief Post process outputs that are already in memory
+ *
+ * Needs no NPU: a context with output_attrs, model size and the type flags
+ * is enough, e.g. one filled by load_post_outputs() on a host.
+ *
+ * @param app_ctx [in] Context, its decoder is found on the first call
+ * @param buffers [in] Output tensors in output_attrs order
+ * @return int 0: success; -1: no decoder for the outputs
+ */
+int post_process_buffers(rknn_app_context_t *app_ctx, void **buffers, letterbox_t *letter_box, float conf_threshold,
+                         float nms_threshold, object_detect_result_list *od_results);
+
+/**
+ * @brief Add a head decoder, tried before the built in yolov5, yolov8 and yolov5-seg ones
+ *
+ * @param decoder [in] Decoder, must outlive every context using it
+ * @return int 0: success; -1: table full
+ */
+int register_post_decoder(const post_decoder_t* decoder);
+
+/**
+ * @brief Find the decoder of the output layout of a model
+ *
+ * @param app_ctx [in] Context with io_num and output_attrs
+ * @return const post_decoder_t* Decoder; NULL: none matches
+ */
+const post_decoder_t* find_post_decoder(const rknn_app_context_t* app_ctx);
+
+/**
+ * @brief Save output tensors with their attrs, see rknn_decode_replay
+ *
+ * @param path [in] Record file
+ * @param app_ctx [in] Context the outputs come from
+ * @param outputs [in] Tensors
+ * @return int 0: success; -1: error
+ */
+int save_post_outputs(const char* path, const rknn_app_context_t* app_ctx, const post_outputs_t* outputs);
+
+/**
+ * @brief Load a record of save_post_outputs()
+ *
+ * Fills output_attrs, io_num.n_output, model size and the type flags of
+ * app_ctx, release with free_post_outputs().
+ *
+ * @param path [in] Record file
+ * @param app_ctx [out] Context
+ * @param outputs [out] Tensors
+ * @return int 0: success; -1: error
+ */
+int load_post_outputs(const char* path, rknn_app_context_t* app_ctx, post_outputs_t* outputs);
+void free_post_outputs(rknn_app_context_t* app_ctx, post_outputs_t* outputs);
 
 void deinitPostProcess();
 #endif //_RKNN_YOLOV5_DEMO_POSTPROCESS_H_
\ No newline at end of file
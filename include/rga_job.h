@@ -0,0 +1,75 @@
+#ifndef _RKNN_YOLOV5_DEMO_RGA_JOB_H_
+#define _RKNN_YOLOV5_DEMO_RGA_JOB_H_
+
+#include "common.h"
+#include "image_utils.h"
+
+/**
+ * @brief Asynchronous RGA job
+ *
+ * Completion handle of a conversion submitted with convert_image_async().
+ * fence_fd is the release fence of the last RGA task of the job, it becomes
+ * readable (POLLIN) when the 2D engine has finished, so it can be waited on
+ * with rga_job_wait() or added to an epoll set. fence_fd is -1 when the job
+ * was already completed at submit time (e.g. CPU fallback). core is the
+ * rga_scheduler core running the job, -1 when none.
+ */
+typedef struct {
+    int fence_fd;
+    int src_handle;
+    int dst_handle;
+    int core;
+    int status;
+} rga_job_t;
+
+/**
+ * @brief Convert image without waiting for the RGA
+ *
+ * Same semantic as convert_image(), the pad fill and the scale are chained
+ * on the RGA through fences. Source and target buffers must stay valid until
+ * the job is completed.
+ *
+ * @param src_image [in] Source Image
+ * @param dst_image [out] Target Image
+ * @param src_box [in] Crop rectangle on source image
+ * @param dst_box [in] Crop rectangle on target image
+ * @param color [in] Pading color if dst_box can not fill target image
+ * @param job [out] Completion handle
+ * @return int 0: submitted or done; -1: error
+ */
+int convert_image_async(image_buffer_t* src_image, image_buffer_t* dst_image, image_rect_t* src_box, image_rect_t* dst_box,
+                        char color, rga_job_t* job);
+
+/**
+ * @brief Convert image with a letterbox plan without waiting for the RGA
+ *
+ * @param src_image [in] Source Image
+ * @param dst_image [out] Target Image, must be allocated
+ * @param plan [in] Letterbox plan
+ * @param job [out] Completion handle
+ * @return int 0: submitted or done; -1: error
+ */
+int convert_image_with_letterbox_plan_async(image_buffer_t* src_image, image_buffer_t* dst_image, letterbox_plan_t* plan,
+                                            rga_job_t* job);
+
+/**
+ * @brief Import an image buffer in the RGA driver
+ *
+ * Uses the dma-buf fd when the image has one, else the virtual address.
+ *
+ * @param image [in] Image
+ * @param format [in] RGA pixel format of the image
+ * @return int Buffer handle, release it with releasebuffer_handle(); <= 0: error
+ */
+int rga_import_image(image_buffer_t* image, int format);
+
+/**
+ * @brief Wait for a job and release its resources
+ *
+ * @param job [in] Completion handle
+ * @param timeout_ms [in] Wait timeout, 0 to poll, -1 to wait forever
+ * @return int 0: completed; 1: still running; -1: error
+ */
+int rga_job_wait(rga_job_t* job, int timeout_ms);
+
+#endif //_RKNN_YOLOV5_DEMO_RGA_JOB_H_
@@ -0,0 +1,89 @@
+#ifndef _RKNN_YOLOV5_DEMO_RGA_SCHEDULER_H_
+#define _RKNN_YOLOV5_DEMO_RGA_SCHEDULER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+
+/**
+ * @brief RGA cores known by the scheduler
+ *
+ * RK3588 has two RGA3 cores and one RGA2 core, RK356x only the RGA2 core.
+ */
+typedef enum {
+    RGA_SCHED_RGA3_CORE0,
+    RGA_SCHED_RGA3_CORE1,
+    RGA_SCHED_RGA2_CORE0,
+    RGA_SCHED_CORE_NUM
+} rga_sched_core_t;
+
+/**
+ * @brief Scheduled RGA job description
+ *
+ */
+typedef struct {
+    image_format_t src_format;
+    image_format_t dst_format;
+    int src_width;
+    int src_height;
+    int dst_width;
+    int dst_height;
+} rga_sched_request_t;
+
+/**
+ * @brief Pick the least loaded core able to run the request and account it
+ *
+ * @param request [in] Job description
+ * @param core [out] Selected core index
+ * @return int im2d core mask to put in im_opt_t.core or imconfig(); 0: let the driver choose; -1: no core supports the request
+ */
+int rga_scheduler_acquire(const rga_sched_request_t* request, int* core);
+
+/**
+ * @brief Pick one core able to run every task of a multi-task job
+ *
+ * The job is accounted once, release it with a single rga_scheduler_release().
+ *
+ * @param requests [in] Task descriptions
+ * @param count [in] Number of tasks
+ * @param core [out] Selected core index
+ * @return int im2d core mask; 0: let the driver choose; -1: no core supports all tasks
+ */
+int rga_scheduler_acquire_batch(const rga_sched_request_t* requests, int count, int* core);
+
+/**
+ * @brief Account the completion of a job started with rga_scheduler_acquire()
+ *
+ * @param core [in] Core index returned by rga_scheduler_acquire()
+ */
+void rga_scheduler_release(int core);
+
+/**
+ * @brief Whether a core supports color fill
+ *
+ * @param core [in] Core index
+ * @return int 1: imfill supported; 0: pad must be filled by cpu
+ */
+int rga_scheduler_core_can_fill(int core);
+
+/**
+ * @brief Get jobs in flight on a core
+ *
+ * @param core [in] Core index
+ * @return int Queue depth
+ */
+int rga_scheduler_queue_depth(int core);
+
+/**
+ * @brief Print per-core queue depth and job count
+ *
+ */
+void rga_scheduler_dump();
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif //_RKNN_YOLOV5_DEMO_RGA_SCHEDULER_H_
@@ -0,0 +1,71 @@
+#ifndef _RKNN_YOLOV5_DEMO_ROI_DETECT_H_
+#define _RKNN_YOLOV5_DEMO_ROI_DETECT_H_
+
+#include "yolov5.h"
+
+/**
+ * @brief Detector on native resolution crops
+ *
+ * Every crop has the model size (the frame size when smaller) and is read
+ * 1:1 from the frame, so only its position changes between crops and frames.
+ * The crops share two model inputs, the RGA reads the next one while the NPU
+ * runs the current one.
+ */
+typedef struct {
+    int width;
+    int height;
+    int roi_width;
+    int roi_height;
+    int num_threads;
+    letterbox_plan_t plans[2];
+    yolov5_input_t inputs[2];
+} roi_detector_t;
+
+/**
+ * @brief Init a crop detector
+ *
+ * @param det [out] Crop detector
+ * @param app_ctx [in] Model
+ * @param num_threads [in] Threads of the CPU crop fallback, 0: every core
+ * @return int 0: success; -1: error
+ */
+int init_roi_detector(roi_detector_t* det, rknn_app_context_t* app_ctx, int num_threads);
+
+/**
+ * @brief Free the crop inputs and plans
+ *
+ * @param det [in] Crop detector
+ */
+void release_roi_detector(roi_detector_t* det);
+
+/**
+ * @brief Get the crop size for frames of a size
+ *
+ * @param det [in] Crop detector
+ * @param app_ctx [in] Model
+ * @param width [in] Frame width
+ * @param height [in] Frame height
+ * @param roi_width [out] Crop width
+ * @param roi_height [out] Crop height
+ * @return int 0: success; -1: error
+ */
+int roi_detector_crop_size(roi_detector_t* det, rknn_app_context_t* app_ctx, int width, int height, int* roi_width,
+                           int* roi_height);
+
+/**
+ * @brief Detect on crops of a frame
+ *
+ * Detections found by several overlapping crops are kept once.
+ *
+ * @param det [in] Crop detector
+ * @param app_ctx [in] Model
+ * @param img [in] Frame
+ * @param rois [in] Crops of roi_detector_crop_size(), on even pixels
+ * @param num_rois [in] Number of crops
+ * @param od_results [out] Detections in frame coordinates
+ * @return int 0: success; -1: error
+ */
+int detect_rois(roi_detector_t* det, rknn_app_context_t* app_ctx, image_buffer_t* img, const image_rect_t* rois,
+                int num_rois, object_detect_result_list* od_results);
+
+#endif //_RKNN_YOLOV5_DEMO_ROI_DETECT_H_
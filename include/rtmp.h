@@ -5,7 +5,7 @@
         {
 #endif
 
-int init_rtmp_streamer(char* stream,uint8_t* data,uint32_t size);
+int init_rtmp_streamer(char* stream,uint8_t* data,uint32_t size,int width,int height);
 int write_frame(uint8_t*data,int size);
 #ifdef __cplusplus
         }
@@ -5,14 +5,48 @@
         {
 #endif
 #include <stdio.h>
-#include "v4l2.h"
 #include "mpp.h"
 typedef struct
 {
-        V4l2Context             *v4l2_ctx;
         MppContext              *mpp_enc_data;
+        int                     width;
+        int                     height;
 }StreamerContext;
+
+/**
+ * @brief Start the H.264 encoder and the RTMP output
+ *
+ * @param streamer_ctx [out] Streamer
+ * @param url [in] RTMP url
+ * @param width [in] Frame width
+ * @param height [in] Frame height
+ * @param hor_stride [in] NV12 row stride in pixels of the pushed frames
+ * @param ver_stride [in] NV12 luma rows of the pushed frames
+ * @param fps [in] Frame rate
+ * @param gop [in] Frames between key frames, 0: two seconds
+ * @param bps [in] Bitrate, 0: derived from the size and fps
+ * @return int 0: success; -1: error
+ */
+int init_streamer(StreamerContext *streamer_ctx, char *url, int width, int height, int hor_stride, int ver_stride,
+                  int fps, int gop, int bps);
+
+/**
+ * @brief Encode one NV12 frame and send it
+ *
+ * @param streamer_ctx [in] Streamer
+ * @param data [in] Frame laid out with the strides given to init_streamer
+ * @param size [in] Frame size in bytes
+ * @return int 0: sent; -1: error or end of stream
+ */
+int streamer_push_frame(StreamerContext *streamer_ctx, uint8_t *data, int size);
+
+/**
+ * @brief Stop the encoder
+ *
+ * @param streamer_ctx [in] Streamer
+ */
+void release_streamer(StreamerContext *streamer_ctx);
 #ifdef __cplusplus
         }
 #endif
-#endif /* ！_STREAMER_H */
\ No newline at end of file
+#endif /* ！_STREAMER_H */
@@ -0,0 +1,96 @@
+#ifndef _RKNN_YOLOV5_DEMO_TILED_DETECT_H_
+#define _RKNN_YOLOV5_DEMO_TILED_DETECT_H_
+
+#include "yolov5.h"
+
+#define TILING_MAX_REGIONS 8
+#define TILING_MAX_TILES 64
+
+/**
+ * @brief Tiled inference settings
+ *
+ * Every region is cut into overlapping tiles of model size, read 1:1 from
+ * the source so small objects keep their pixels. With full_frame the whole
+ * frame is also letterboxed once for the objects larger than a tile.
+ * Detections of all tiles are merged with nms_threshold IoU, and with
+ * ios_threshold intersection over the smaller box inside the area both tiles
+ * see, which joins the parts of an object cut by a tile seam.
+ */
+typedef struct {
+    int enable;
+    int overlap;         // pixels shared by neighbour tiles
+    int full_frame;
+    float nms_threshold; // 0: inference nms_threshold
+    float ios_threshold;
+    int num_regions;     // 0: the whole frame
+    image_rect_t regions[TILING_MAX_REGIONS];
+} tiling_config_t;
+
+/**
+ * @brief One tile, seams are its edges that cut a region
+ */
+typedef struct {
+    image_rect_t crop;
+    letterbox_plan_t plan;
+    int seam_left;
+    int seam_top;
+    int seam_right;
+    int seam_bottom;
+} tile_t;
+
+/**
+ * @brief Tiled detector
+ *
+ * The tiles share two model inputs, the RGA crops the next tile while the
+ * NPU runs the current one. The layout is built for the first frame and
+ * again when the frame size changes.
+ */
+typedef struct {
+    tiling_config_t config;
+    int width;
+    int height;
+    int num_threads;
+    int num_tiles;
+    tile_t tiles[TILING_MAX_TILES];
+    yolov5_input_t inputs[2];
+} tiled_detector_t;
+
+/**
+ * @brief Fill tiling settings with the defaults
+ *
+ * @param config [out] Settings
+ */
+void default_tiling_config(tiling_config_t* config);
+
+/**
+ * @brief Init a tiled detector
+ *
+ * @param det [out] Tiled detector
+ * @param app_ctx [in] Model the tiles are sized for
+ * @param config [in] Settings
+ * @param num_threads [in] Threads of the CPU crop fallback, 0: every core
+ * @return int 0: success; -1: error
+ */
+int init_tiled_detector(tiled_detector_t* det, rknn_app_context_t* app_ctx, const tiling_config_t* config,
+                        int num_threads);
+
+/**
+ * @brief Free the tile inputs and plans
+ *
+ * @param det [in] Tiled detector
+ */
+void release_tiled_detector(tiled_detector_t* det);
+
+/**
+ * @brief Detect on every tile of a frame and merge the results
+ *
+ * @param det [in] Tiled detector
+ * @param app_ctx [in] Model
+ * @param img [in] Frame
+ * @param od_results [out] Merged detections in frame coordinates
+ * @return int 0: success; -1: error
+ */
+int tiled_detect(tiled_detector_t* det, rknn_app_context_t* app_ctx, image_buffer_t* img,
+                 object_detect_result_list* od_results);
+
+#endif //_RKNN_YOLOV5_DEMO_TILED_DETECT_H_
@@ -0,0 +1,105 @@
+#ifndef _RKNN_YOLOV5_DEMO_TRACKING_H_
+#define _RKNN_YOLOV5_DEMO_TRACKING_H_
+
+#include "yolov5.h"
+
+/**
+ * @brief Tracking settings
+ *
+ * The detector runs on one of detect_interval frames, the others get the
+ * boxes predicted by the tracks. With adaptive, the interval shrinks so no
+ * track moves more than max_drift of its height between two detections,
+ * and falls to 1 while a track is under min_confidence.
+ *
+ * With redetect, detection frames also look again at native resolution
+ * around tracks lost for at most redetect_lost_frames, under min_confidence
+ * or smaller than redetect_min_height, up to redetect_max_rois crops.
+ */
+typedef struct {
+    int enable;
+    int detect_interval;
+    int adaptive;
+    float max_drift;
+    float min_confidence;
+    int track_buffer; // frames a lost track is kept
+    int redetect;
+    int redetect_max_rois;
+    int redetect_min_height;
+    int redetect_lost_frames;
+} tracking_config_t;
+
+struct tracker_t;
+
+/**
+ * @brief Fill tracking settings with the defaults
+ *
+ * @param config [out] Settings
+ */
+void default_tracking_config(tracking_config_t* config);
+
+/**
+ * @brief Create a tracker
+ *
+ * @param config [in] Settings
+ * @param fps [in] Frame rate of the tracked stream
+ * @return tracker_t* Tracker; NULL: error
+ */
+struct tracker_t* create_tracker(const tracking_config_t* config, int fps);
+
+/**
+ * @brief Free a tracker
+ *
+ * @param tracker [in] Tracker, can be NULL
+ */
+void destroy_tracker(struct tracker_t* tracker);
+
+/**
+ * @brief Decide whether the next frame runs the detector
+ *
+ * Called once per frame, in frame order.
+ *
+ * @param tracker [in] Tracker
+ * @return int 1: detect; 0: predict
+ */
+int tracker_want_detection(struct tracker_t* tracker);
+
+/**
+ * @brief Choose the crops to detect again before tracker_update()
+ *
+ * Each crop is centered on a weak track and may cover several of them.
+ *
+ * @param tracker [in] Tracker
+ * @param width [in] Frame width
+ * @param height [in] Frame height
+ * @param roi_width [in] Crop width, even
+ * @param roi_height [in] Crop height, even
+ * @param rois [out] Crops on even pixels
+ * @param max_rois [in] Size of rois
+ * @return int Number of crops
+ */
+int tracker_select_rois(struct tracker_t* tracker, int width, int height, int roi_width, int roi_height,
+                        image_rect_t* rois, int max_rois);
+
+/**
+ * @brief Associate the detections of a frame with the tracks
+ *
+ * roi_results only take part in the second association: they keep weak
+ * tracks and find lost ones again but never start a track.
+ *
+ * @param tracker [in] Tracker
+ * @param results [in/out] Detections in, tracked boxes with their track_id out
+ * @param roi_results [in] Detections on the crops of tracker_select_rois(), can be NULL
+ * @return int Next detection interval
+ */
+int tracker_update(struct tracker_t* tracker, object_detect_result_list* results,
+                   const object_detect_result_list* roi_results);
+
+/**
+ * @brief Predict the boxes of a frame without detections
+ *
+ * @param tracker [in] Tracker
+ * @param results [out] Tracked boxes with predicted set
+ */
+void tracker_predict(struct tracker_t* tracker, object_detect_result_list* results);
+
+#endif //_RKNN_YOLOV5_DEMO_TRACKING_H_
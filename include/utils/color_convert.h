@@ -0,0 +1,85 @@
+#ifndef _RKNN_MODEL_ZOO_COLOR_CONVERT_H_
+#define _RKNN_MODEL_ZOO_COLOR_CONVERT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+
+/**
+ * @brief Convert YUYV 4:2:2 to RGB888 (BT.601 limited range, 6 bit fixed point)
+ *
+ * @param yuyv [in] Source pixels
+ * @param yuyv_stride [in] Source row pitch in bytes
+ * @param rgb [out] Target pixels
+ * @param rgb_stride [in] Target row pitch in bytes
+ * @param width [in] Image width, must be even
+ * @param height [in] Image height
+ * @param num_threads [in] Row stripe threads, 1: calling thread only, 0: one per cpu
+ * @return int 0: success; -1: error
+ */
+int yuyv_to_rgb888(const unsigned char* yuyv, int yuyv_stride, unsigned char* rgb, int rgb_stride,
+                   int width, int height, int num_threads);
+
+/**
+ * @brief Convert packed YUYV to packed RGB888 on the calling thread
+ *
+ * @param yuv [in] Source pixels, row pitch width * 2
+ * @param rgb [out] Target pixels, row pitch width * 3
+ * @param width [in] Image width, must be even
+ * @param height [in] Image height
+ */
+void yuyv_to_rgb(unsigned char* yuv, unsigned char* rgb, int width, int height);
+
+/**
+ * @brief Convert NV12 to RGB888 (BT.601 limited range, 6 bit fixed point)
+ *
+ * @param y [in] Source luma plane
+ * @param y_stride [in] Luma row pitch in bytes
+ * @param uv [in] Source interleaved chroma plane
+ * @param uv_stride [in] Chroma row pitch in bytes
+ * @param rgb [out] Target pixels
+ * @param rgb_stride [in] Target row pitch in bytes
+ * @param width [in] Image width, must be even
+ * @param height [in] Image height, must be even
+ * @param num_threads [in] Row stripe threads, 1: calling thread only, 0: one per cpu
+ * @return int 0: success; -1: error
+ */
+int nv12_to_rgb888(const unsigned char* y, int y_stride, const unsigned char* uv, int uv_stride,
+                   unsigned char* rgb, int rgb_stride, int width, int height, int num_threads);
+
+/**
+ * @brief Convert YUYV 4:2:2 to NV12, chroma of two rows is averaged
+ *
+ * @param yuyv [in] Source pixels
+ * @param yuyv_stride [in] Source row pitch in bytes
+ * @param y [out] Target luma plane
+ * @param y_stride [in] Luma row pitch in bytes
+ * @param uv [out] Target interleaved chroma plane
+ * @param uv_stride [in] Chroma row pitch in bytes
+ * @param width [in] Image width, must be even
+ * @param height [in] Image height, must be even
+ * @param num_threads [in] Row stripe threads, 1: calling thread only, 0: one per cpu
+ * @return int 0: success; -1: error
+ */
+int yuyv_to_nv12(const unsigned char* yuyv, int yuyv_stride, unsigned char* y, int y_stride,
+                 unsigned char* uv, int uv_stride, int width, int height, int num_threads);
+
+/**
+ * @brief Convert pixel format on cpu, same size
+ *
+ * Supports YUYV->RGB888, NV12->RGB888 and YUYV->NV12.
+ *
+ * @param src_image [in] Source Image
+ * @param dst_image [out] Target Image, must be allocated
+ * @param num_threads [in] Row stripe threads, 0: one per cpu
+ * @return int 0: success; -1: error
+ */
+int convert_color_cpu(image_buffer_t* src_image, image_buffer_t* dst_image, int num_threads);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif //_RKNN_MODEL_ZOO_COLOR_CONVERT_H_
@@ -0,0 +1,84 @@
+#ifndef _RKNN_MODEL_ZOO_IMAGE_RESIZE_H_
+#define _RKNN_MODEL_ZOO_IMAGE_RESIZE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+
+/**
+ * @brief Bilinear coefficient table of one plane
+ *
+ * For each target column (row) the two source columns (rows) and their
+ * Q8 weights, the two weights of an entry always sum to 256. scratch holds
+ * the two last horizontally scaled rows of every stripe, it is allocated on
+ * the first resize and kept with the table.
+ */
+typedef struct {
+    int src_width;
+    int src_height;
+    int dst_width;
+    int dst_height;
+    int* x_ofs;
+    unsigned short* x_coef;
+    int* y_ofs;
+    unsigned short* y_coef;
+    unsigned short* scratch;
+    int scratch_size;
+} resize_table_t;
+
+/**
+ * @brief CPU bilinear resizer
+ *
+ * Tables are built by image_resizer_prepare() and kept as long as the
+ * format and box sizes do not change, chroma is only used for YUV420SP.
+ */
+typedef struct {
+    int format;
+    resize_table_t plane;
+    resize_table_t chroma;
+} image_resizer_t;
+
+/**
+ * @brief Build the coefficient tables, keep them if they already match
+ *
+ * @param resizer [in/out] Resizer, zero it before the first call
+ * @param format [in] Image format
+ * @param src_w [in] Source box width
+ * @param src_h [in] Source box height
+ * @param dst_w [in] Target box width
+ * @param dst_h [in] Target box height
+ * @return int 0: success; -1: error
+ */
+int image_resizer_prepare(image_resizer_t* resizer, image_format_t format, int src_w, int src_h, int dst_w, int dst_h);
+
+/**
+ * @brief Free the coefficient tables
+ *
+ * @param resizer [in] Resizer
+ */
+void image_resizer_release(image_resizer_t* resizer);
+
+/**
+ * @brief Crop and scale a box of src into a box of dst, same format
+ *
+ * Supports RGB888, RGBA8888, GRAY8 and YUV420SP, for YUV420SP the box
+ * coordinates and sizes must be even.
+ *
+ * @param resizer [in/out] Resizer, tables are rebuilt when needed; NULL: build temporary tables
+ * @param src [in] Source Image
+ * @param src_box [in] Crop rectangle on source image, NULL: whole image
+ * @param dst [out] Target Image
+ * @param dst_box [in] Rectangle on target image, NULL: whole image
+ * @param num_threads [in] Row stripe threads, 0: one per cpu
+ * @return int 0: success; -1: error
+ */
+int resize_image_bilinear(image_resizer_t* resizer, image_buffer_t* src, image_rect_t* src_box,
+                          image_buffer_t* dst, image_rect_t* dst_box, int num_threads);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif //_RKNN_MODEL_ZOO_IMAGE_RESIZE_H_
@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include "common.h"
+#include "image_resize.h"
 
 /**
  * @brief LetterBox
@@ -17,6 +18,35 @@ typedef struct {
     float scale;
 } letterbox_t;
 
+/**
+ * @brief Letterbox plan
+ * 
+ * Geometry of a letterbox from a source size to a model size, built once per
+ * stream with init_letterbox_plan() and applied on every frame. letterbox is
+ * the inverse mapping given to post_process. The pad border is filled only on
+ * the first frame converted into a target buffer (pad_filled), so the pad area
+ * of that buffer must not be written by anyone else. resizer keeps the CPU
+ * scale tables when RGA can not do the conversion, free them with
+ * release_letterbox_plan(). num_threads bounds that CPU conversion, 0 uses
+ * every core; both are kept when the plan is built again.
+ */
+typedef struct {
+    int src_width;
+    int src_height;
+    int dst_width;
+    int dst_height;
+    image_rect_t src_box;
+    image_rect_t dst_box;
+    letterbox_t letterbox;
+    char color;
+    int need_pad;
+    int pad_filled;
+    void* pad_buf;
+    int pad_fd;
+    image_resizer_t resizer;
+    int num_threads;
+} letterbox_plan_t;
+
 /**
  * @brief Read image file (support png/jpeg/bmp)
  * 
@@ -58,14 +88,134 @@ int convert_image(image_buffer_t* src_image, image_buffer_t* dst_image, image_re
  */
 int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_image, letterbox_t* letterbox, char color);
 
+/**
+ * @brief Build a letterbox plan
+ * 
+ * The plan must be zeroed before the first call, it can be built again for
+ * new sizes without releasing it.
+ * 
+ * @param plan [out] Letterbox plan
+ * @param src_w [in] Source image width
+ * @param src_h [in] Source image height
+ * @param dst_w [in] Target image width
+ * @param dst_h [in] Target image height
+ * @param color [in] Fill color on target image
+ * @return int 0: success; -1: error
+ */
+int init_letterbox_plan(letterbox_plan_t* plan, int src_w, int src_h, int dst_w, int dst_h, char color);
+
+/**
+ * @brief Build a letterbox plan of one crop of the source
+ * 
+ * Like init_letterbox_plan() for a source of crop size, the plan then reads
+ * crop out of src_w x src_h images. letterbox maps back into the crop, add
+ * the crop origin to get source coordinates.
+ * 
+ * @param plan [out] Letterbox plan
+ * @param src_w [in] Source image width
+ * @param src_h [in] Source image height
+ * @param crop [in] Rectangle on source image, even for YUV420SP sources
+ * @param dst_w [in] Target image width
+ * @param dst_h [in] Target image height
+ * @param color [in] Fill color on target image
+ * @return int 0: success; -1: error
+ */
+int init_letterbox_plan_crop(letterbox_plan_t* plan, int src_w, int src_h, const image_rect_t* crop, int dst_w, int dst_h,
+                             char color);
+
+/**
+ * @brief Release a letterbox plan
+ * 
+ * @param plan [in] Letterbox plan
+ */
+void release_letterbox_plan(letterbox_plan_t* plan);
+
+/**
+ * @brief Check that a plan was built for these image sizes
+ * 
+ * @param plan [in] Letterbox plan
+ * @param src_image [in] Source Image
+ * @param dst_image [in] Target Image
+ * @return int 1: match; 0: plan must be rebuilt
+ */
+int letterbox_plan_match(const letterbox_plan_t* plan, const image_buffer_t* src_image, const image_buffer_t* dst_image);
+
+/**
+ * @brief Tell whether the pad border of the target still has to be filled and mark it filled
+ * 
+ * @param plan [in] Letterbox plan
+ * @param dst_image [in] Target Image
+ * @return int 1: fill the pad with this conversion; 0: pad already filled
+ */
+int letterbox_plan_begin_fill(letterbox_plan_t* plan, const image_buffer_t* dst_image);
+
+/**
+ * @brief Convert image with a letterbox plan
+ * 
+ * @param src_image [in] Source Image
+ * @param dst_image [out] Target Image, must be allocated
+ * @param plan [in] Letterbox plan
+ * @return int 0: success; -1: error
+ */
+int convert_image_with_letterbox_plan(image_buffer_t* src_image, image_buffer_t* dst_image, letterbox_plan_t* plan);
+
+/**
+ * @brief Compute letterbox geometry
+ * 
+ * @param src_w [in] Source image width
+ * @param src_h [in] Source image height
+ * @param dst_w [in] Target image width
+ * @param dst_h [in] Target image height
+ * @param dst_box [out] Rectangle on target image receiving the scaled source
+ * @param letterbox [out] Letterbox, can be NULL
+ * @return int 0: success; -1: error
+ */
+int get_letterbox_box(int src_w, int src_h, int dst_w, int dst_h, image_rect_t* dst_box, letterbox_t* letterbox);
+
 /**
  * @brief Get the image size
  * 
+ * Strides are taken into account, this is the size of the whole buffer.
+ * 
  * @param image [in] Image
  * @return int image size
  */
 int get_image_size(image_buffer_t* image);
 
+/**
+ * @brief Get the row stride of an image in pixels
+ * 
+ * @param image [in] Image
+ * @return int width_stride if set, else width
+ */
+int get_image_width_stride(const image_buffer_t* image);
+
+/**
+ * @brief Get the number of rows allocated for the first plane
+ * 
+ * @param image [in] Image
+ * @return int height_stride if set, else height
+ */
+int get_image_height_stride(const image_buffer_t* image);
+
+/**
+ * @brief Get the row pitch of the first plane in bytes
+ * 
+ * YUV420SP chroma rows use the same pitch and start at pitch * height stride.
+ * 
+ * @param image [in] Image
+ * @return int row pitch; 0: unknown format
+ */
+int get_image_pitch(const image_buffer_t* image);
+
+/**
+ * @brief Get the RGA pixel format of an image format
+ * 
+ * @param fmt [in] Image format
+ * @return int RK_FORMAT_* value; -1: no RGA format
+ */
+int get_rga_fmt(image_format_t fmt);
+
 int cvtcolor_rga(image_buffer_t *src_img_buf, image_format_t dst_img_format);
 
 #ifdef __cplusplus
@@ -0,0 +1,83 @@
+#ifndef _RKNN_MODEL_ZOO_MOTION_DETECT_H_
+#define _RKNN_MODEL_ZOO_MOTION_DETECT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+
+/**
+ * @brief Motion detector settings
+ */
+typedef struct {
+    int enable;
+    int scale;     // luma downsample factor, each sample averages 2x2 source pixels
+    int tile_size; // tile side in downsampled pixels
+    int threshold; // mean absolute difference per pixel over the tile noise for a changed tile
+    int min_tiles; // changed tiles for a frame to have motion
+    int bg_shift;  // background follows the scene by 1/(1 << bg_shift) per frame
+    int max_skip;  // static frames before one is reported as motion anyway, 0: never
+} motion_config_t;
+
+/**
+ * @brief Motion detector
+ *
+ * Keeps a downsampled luma background and, per tile, the usual difference
+ * of a static scene (noise, Q4). A tile changed when its mean absolute
+ * difference to the background is threshold above its noise.
+ */
+typedef struct {
+    motion_config_t config;
+    int src_width;
+    int src_height;
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    unsigned char* luma;
+    unsigned char* background;
+    unsigned short* noise;
+    int changed_tiles;
+    int skipped;
+    int initialized;
+} motion_detector_t;
+
+/**
+ * @brief Fill motion detector settings with the defaults
+ *
+ * @param config [out] Settings
+ */
+void default_motion_config(motion_config_t* config);
+
+/**
+ * @brief Init a motion detector, buffers are allocated on the first frame
+ *
+ * @param detector [out] Motion detector
+ * @param config [in] Settings
+ */
+void init_motion_detector(motion_detector_t* detector, const motion_config_t* config);
+
+/**
+ * @brief Free the buffers of a motion detector
+ *
+ * @param detector [in] Motion detector
+ */
+void release_motion_detector(motion_detector_t* detector);
+
+/**
+ * @brief Compare a frame with the background and update it
+ *
+ * Support YUYV 4:2:2, NV12, NV21 and GRAY8, only the luma is read.
+ *
+ * @param detector [in] Motion detector
+ * @param image [in] Frame
+ * @return int 1: motion, the frame needs inference; 0: static; -1: error
+ */
+int motion_detect(motion_detector_t* detector, image_buffer_t* image);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif //_RKNN_MODEL_ZOO_MOTION_DETECT_H_
@@ -0,0 +1,40 @@
+#ifndef _RKNN_MODEL_ZOO_ROW_PARALLEL_H_
+#define _RKNN_MODEL_ZOO_ROW_PARALLEL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// most stripes of one call, e.g. for per stripe scratch buffers
+#define ROW_PARALLEL_MAX_THREADS 8
+
+/**
+ * @brief Row stripe task
+ *
+ * @param arg [in] User argument
+ * @param stripe [in] Stripe index, 0 to ROW_PARALLEL_MAX_THREADS - 1
+ * @param row_begin [in] First row of the stripe
+ * @param row_end [in] Row after the last row of the stripe
+ */
+typedef void (*row_task_fn)(void* arg, int stripe, int row_begin, int row_end);
+
+/**
+ * @brief Split rows in stripes and run them on several threads
+ *
+ * The stripes go to worker threads started once for the process, the calling
+ * thread runs the first stripe and returns when all stripes are done.
+ *
+ * @param rows [in] Row count
+ * @param row_align [in] Stripe height alignment (2 for 4:2:0 chroma)
+ * @param num_threads [in] Thread count, 0: one per online cpu
+ * @param task [in] Stripe function
+ * @param arg [in] User argument given to task
+ * @return int 0: success; -1: error
+ */
+int row_parallel_for(int rows, int row_align, int num_threads, row_task_fn task, void* arg);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif //_RKNN_MODEL_ZOO_ROW_PARALLEL_H_
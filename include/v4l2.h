@@ -33,6 +33,8 @@ typedef struct
         uint32_t        height;
         uint32_t        pixelformat;
         uint32_t        field;
+        uint32_t        bytesperline;   /* row pitch negotiated with the driver */
+        volatile int    *run;           /* main_loop returns once *run is 0, NULL: only on errors */
 
         /*call back function*/
         _Bool (*process_image)(uint8_t *p, int size,struct timeval);
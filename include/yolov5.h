@@ -19,6 +19,15 @@
 #include "rknn_api.h"
 #include "common.h"
 
+#define YOLOV5_MAX_SHAPES 8
+
+typedef struct {
+    int width;
+    int height;
+} yolov5_shape_t;
+
+struct post_decoder_t;
+struct seg_mask_list_t;
 
 typedef struct {
     rknn_context rknn_ctx;
@@ -29,15 +38,75 @@ typedef struct {
     int model_width;
     int model_height;
     bool is_quant;
+    // fp16 outputs decoded as they are, without the runtime conversion to fp32
+    bool is_fp16;
     const char* model_path;
+    // 0: BOX_THRESH / NMS_THRESH
+    float box_threshold;
+    float nms_threshold;
+    // npu_scheduler model, 0: not scheduled
+    int npu_id;
+    // rknn_init flags, e.g. RKNN_FLAG_MEM_ALLOC_OUTSIDE when the internal memory is shared
+    uint32_t init_flags;
+    // internal memory of its own until the shared one is attached, NULL: none
+    rknn_tensor_mem* own_internal_mem;
+    // 1: fp16 outputs are converted to fp32 by the runtime (want_float)
+    int float_outputs;
+    // input shapes the model was compiled with, model_width/height is the active one
+    int num_shapes;
+    yolov5_shape_t shapes[YOLOV5_MAX_SHAPES];
+    // head of the outputs, NULL: found from their layout on the first frame
+    const struct post_decoder_t* decoder;
+    // the outputs of the next inference are saved there for replay, cleared once written
+    const char* record_path;
+    // instance masks of segmentation heads, NULL: only the mask_area of the results
+    struct seg_mask_list_t* masks;
 } rknn_app_context_t;
 
 #include "postprocess.h"
+#include "rga_job.h"
+
+// letterboxed model input, filled by the RGA while the NPU works on another one
+typedef struct {
+    image_buffer_t img;
+    letterbox_plan_t plan;
+    rga_job_t job;
+} yolov5_input_t;
 
 
 int init_yolov5_model(rknn_app_context_t* app_ctx);
 
 int release_yolov5_model(rknn_app_context_t* app_ctx);
 
+// the buffer takes the largest input shape, the image the active one
+int init_yolov5_input(rknn_app_context_t* app_ctx, yolov5_input_t* input);
+
+// give the image of an idle input the active shape, its letterbox plan follows on the next prepare
+void resize_yolov5_input(rknn_app_context_t* app_ctx, yolov5_input_t* input);
+
+// activate one of the compiled input shapes, output attrs and so strides follow
+int set_yolov5_input_shape(rknn_app_context_t* app_ctx, int width, int height);
+
+// shape for a source: least letterbox padding, then the largest; level > 0 steps down to smaller
+// shapes of about the same aspect ratio, e.g. for the load shedder
+int pick_yolov5_input_shape(const rknn_app_context_t* app_ctx, int src_width, int src_height, int level,
+                            yolov5_shape_t* shape);
+
+void release_yolov5_input(yolov5_input_t* input);
+
+// submit the letterbox of img into input, returns without waiting for the RGA
+int prepare_yolov5_input(rknn_app_context_t* app_ctx, image_buffer_t* img, yolov5_input_t* input);
+
+// same with a plan kept by the caller instead of input->plan, e.g. one per tile
+int prepare_yolov5_input_with_plan(rknn_app_context_t* app_ctx, image_buffer_t* img, letterbox_plan_t* plan,
+                                   yolov5_input_t* input);
+
+// wait for the input fence just before rknn_run, then run and post process
+int inference_yolov5_input(rknn_app_context_t* app_ctx, yolov5_input_t* input, object_detect_result_list* od_results);
+
+// same with the letterbox of the plan the input was prepared with
+int inference_yolov5_input_with_letterbox(rknn_app_context_t* app_ctx, yolov5_input_t* input, letterbox_t* letterbox,
+                                          object_detect_result_list* od_results);
+
 int inference_yolov5_model(rknn_app_context_t* app_ctx, image_buffer_t* img, object_detect_result_list* od_results);
 #endif //_RKNN_DEMO_YOLOV5_H_
\ No newline at end of file
@@ -17,7 +17,19 @@ BYTETracker::~BYTETracker()
 {
 }
 
-vector<STrack> BYTETracker::update(const vector<Object>& objects, int fps, long long num_frames)
+static STrack object_to_strack(const Object& object)
+{
+	vector<float> tlbr_;
+	tlbr_.resize(4);
+	tlbr_[0] = object.rect.x;
+	tlbr_[1] = object.rect.y;
+	tlbr_[2] = object.rect.x + object.rect.width;
+	tlbr_[3] = object.rect.y + object.rect.height;
+	return STrack(STrack::tlbr_to_tlwh(tlbr_), object.prob, object.name, object.label);
+}
+
+vector<STrack> BYTETracker::update(const vector<Object>& objects, int fps, long long num_frames,
+	const vector<Object>& roi_objects)
 {
 
 	////////////////// Step 1: Get detections //////////////////
@@ -46,17 +58,8 @@ vector<STrack> BYTETracker::update(const vector<Object>& objects, int fps, long
    		// #pragma omp parallel for
 		for (int i = 0; i < objects.size(); i++)
 		{
-			vector<float> tlbr_;
-			tlbr_.resize(4);
-			tlbr_[0] = objects[i].rect.x;
-			tlbr_[1] = objects[i].rect.y;
-			tlbr_[2] = objects[i].rect.x + objects[i].rect.width;
-			tlbr_[3] = objects[i].rect.y + objects[i].rect.height;
-
-			float score = objects[i].prob;
-
-			STrack strack(STrack::tlbr_to_tlwh(tlbr_), score, objects[i].name, objects[i].label);
-			if (score >= track_thresh)
+			STrack strack = object_to_strack(objects[i]);
+			if (strack.score >= track_thresh)
 			{
 				detections.push_back(strack);
 			}
@@ -112,10 +115,17 @@ vector<STrack> BYTETracker::update(const vector<Object>& objects, int fps, long
 	}
 	detections.clear();
 	detections.assign(detections_low.begin(), detections_low.end());
+	// re-detections around weak tracks follow the low score ones, they may also find lost tracks
+	int num_low = detections.size();
+	for (int i = 0; i < roi_objects.size(); i++)
+	{
+		detections.push_back(object_to_strack(roi_objects[i]));
+	}
 	
 	for (int i = 0; i < u_track.size(); i++)
 	{
-		if (strack_pool[u_track[i]]->state == TrackState::Tracked)
+		if (strack_pool[u_track[i]]->state == TrackState::Tracked ||
+			(roi_objects.size() > 0 && strack_pool[u_track[i]]->state == TrackState::Lost))
 		{
 			r_tracked_stracks.push_back(strack_pool[u_track[i]]);
 		}
@@ -123,6 +133,15 @@ vector<STrack> BYTETracker::update(const vector<Object>& objects, int fps, long
 
 	dists.clear();
 	dists = iou_distance(r_tracked_stracks, detections, dist_size, dist_size_size);
+	for (int i = 0; i < dists.size(); i++)
+	{
+		if (r_tracked_stracks[i]->state != TrackState::Lost)
+			continue;
+		for (int j = 0; j < num_low && j < dists[i].size(); j++)
+		{
+			dists[i][j] = 1.0;
+		}
+	}
 
 	matches.clear();
 	u_track.clear();
@@ -292,5 +311,38 @@ vector<STrack> BYTETracker::update(const vector<Object>& objects, int fps, long
 	// 		output_stracks.push_back(this->tracked_stracks[i]);
 	// 	}
 	// }
+	for (int i = 0; i < this->tracked_stracks.size(); i++)
+	{
+		if (this->tracked_stracks[i].is_activated)
+		{
+			output_stracks.push_back(this->tracked_stracks[i]);
+		}
+	}
+	return output_stracks;
+}
+
+vector<STrack> BYTETracker::predict()
+{
+	// one frame passes as in update, lost tracks keep moving so they can be found again
+	this->frame_id++;
+	vector<STrack*> strack_pool;
+	for (int i = 0; i < this->tracked_stracks.size(); i++)
+	{
+		strack_pool.push_back(&this->tracked_stracks[i]);
+	}
+	for (int i = 0; i < this->lost_stracks.size(); i++)
+	{
+		strack_pool.push_back(&this->lost_stracks[i]);
+	}
+	STrack::multi_predict(strack_pool, this->kalman_filter);
+
+	vector<STrack> output_stracks;
+	for (int i = 0; i < this->tracked_stracks.size(); i++)
+	{
+		if (this->tracked_stracks[i].is_activated && this->tracked_stracks[i].state == TrackState::Tracked)
+		{
+			output_stracks.push_back(this->tracked_stracks[i]);
+		}
+	}
 	return output_stracks;
 }
\ No newline at end of file
@@ -0,0 +1,555 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "im2d.h"
+#include "rga.h"
+#include "rknn_api.h"
+
+#include "classifier.h"
+#include "rga_job.h"
+#include "rga_scheduler.h"
+
+extern "C" {
+#include "file_utils.h"
+}
+
+typedef struct {
+    frame_t *frame;
+    int index;
+    int64_t queued_ms;
+} classifier_entry_t;
+
+struct classifier_t {
+    classifier_config_t config;
+    rknn_context ctx;
+    rknn_input_output_num io_num;
+    rknn_tensor_attr output_attr;
+    int model_batch;
+    int width;
+    int height;
+    int channel;
+    int num_classes;
+    int batch_size;
+    // batch_size crops stacked vertically, the model input of every run is a slice of it
+    image_buffer_t batch;
+    int batch_handle;
+    std::vector<std::string> labels;
+    std::deque<classifier_entry_t> queue;
+    classifier_done_cb done;
+    void *done_arg;
+    int npu_id;
+    bool draining;
+    uint64_t num_batches;
+    uint64_t num_crops;
+};
+
+void default_classifier_config(classifier_config_t *config)
+{
+    memset(config, 0, sizeof(classifier_config_t));
+    config->enable = 0;
+    snprintf(config->model_path, CLASSIFIER_PATH_MAX, "./model/classifier.rknn");
+    config->batch_size = 0;
+    config->max_wait_ms = 20;
+    config->det_class = -1;
+    config->min_size = 16;
+    config->priority = NPU_PRIORITY_LOW;
+    config->budget_ms = 0;
+}
+
+static void load_labels(struct classifier_t *classifier, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        printf("open classifier labels %s fail, ids are printed\n", path);
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        classifier->labels.push_back(line);
+    }
+    fclose(fp);
+}
+
+static int load_model(struct classifier_t *classifier)
+{
+    char *model = NULL;
+    int model_len = read_data_from_file(classifier->config.model_path, &model);
+    if (model == NULL)
+    {
+        printf("load classifier model %s fail!\n", classifier->config.model_path);
+        return -1;
+    }
+    int ret = rknn_init(&classifier->ctx, model, model_len, 0, NULL);
+    free(model);
+    if (ret < 0)
+    {
+        printf("classifier rknn_init fail! ret=%d\n", ret);
+        classifier->ctx = 0;
+        return -1;
+    }
+    ret = rknn_query(classifier->ctx, RKNN_QUERY_IN_OUT_NUM, &classifier->io_num, sizeof(rknn_input_output_num));
+    if (ret != RKNN_SUCC || classifier->io_num.n_input != 1 || classifier->io_num.n_output < 1)
+    {
+        printf("classifier must have one input and an output\n");
+        return -1;
+    }
+
+    rknn_tensor_attr input_attr;
+    memset(&input_attr, 0, sizeof(input_attr));
+    input_attr.index = 0;
+    ret = rknn_query(classifier->ctx, RKNN_QUERY_INPUT_ATTR, &input_attr, sizeof(rknn_tensor_attr));
+    memset(&classifier->output_attr, 0, sizeof(rknn_tensor_attr));
+    classifier->output_attr.index = 0;
+    ret |= rknn_query(classifier->ctx, RKNN_QUERY_OUTPUT_ATTR, &classifier->output_attr, sizeof(rknn_tensor_attr));
+    if (ret != RKNN_SUCC)
+    {
+        printf("classifier rknn_query fail! ret=%d\n", ret);
+        return -1;
+    }
+
+    classifier->model_batch = input_attr.dims[0] > 0 ? input_attr.dims[0] : 1;
+    if (input_attr.fmt == RKNN_TENSOR_NCHW)
+    {
+        classifier->channel = input_attr.dims[1];
+        classifier->height = input_attr.dims[2];
+        classifier->width = input_attr.dims[3];
+    }
+    else
+    {
+        classifier->height = input_attr.dims[1];
+        classifier->width = input_attr.dims[2];
+        classifier->channel = input_attr.dims[3];
+    }
+    classifier->num_classes = classifier->output_attr.n_elems / classifier->model_batch;
+    if (classifier->channel != 3 || classifier->num_classes <= 0)
+    {
+        printf("classifier input must be RGB, got %d channels\n", classifier->channel);
+        return -1;
+    }
+    printf("classifier input %dx%dx%d batch %d, %d classes\n", classifier->width, classifier->height,
+           classifier->channel, classifier->model_batch, classifier->num_classes);
+    return 0;
+}
+
+struct classifier_t *create_classifier(const classifier_config_t *config, classifier_done_cb done, void *arg)
+{
+    classifier_t *classifier = new classifier_t();
+    classifier->config = *config;
+    classifier->done = done;
+    classifier->done_arg = arg;
+    if (load_model(classifier) != 0)
+    {
+        destroy_classifier(classifier);
+        return NULL;
+    }
+    npu_model_desc_t desc = {"cascade", config->priority, config->budget_ms, NULL, NULL};
+    classifier->npu_id = npu_sched_register(&desc);
+    if (classifier->npu_id < 0)
+    {
+        classifier->npu_id = 0;
+    }
+    if (config->label_path[0] != '\0')
+    {
+        load_labels(classifier, config->label_path);
+    }
+
+    int batch_size = config->batch_size > 0 ? config->batch_size : classifier->model_batch;
+    if (batch_size % classifier->model_batch != 0 || batch_size > CLASSIFIER_MAX_BATCH)
+    {
+        printf("classifier batch_size %d must be a multiple of the model batch %d, at most %d\n", batch_size,
+               classifier->model_batch, CLASSIFIER_MAX_BATCH);
+        destroy_classifier(classifier);
+        return NULL;
+    }
+    classifier->batch_size = batch_size;
+    classifier->batch.width = classifier->width;
+    classifier->batch.height = classifier->height * batch_size;
+    classifier->batch.format = IMAGE_FORMAT_RGB888;
+    classifier->batch.fd = -1;
+    classifier->batch.size = get_image_size(&classifier->batch);
+    classifier->batch.virt_addr = (unsigned char *)malloc(classifier->batch.size);
+    if (classifier->batch.virt_addr == NULL)
+    {
+        printf("malloc buffer size:%d fail!\n", classifier->batch.size);
+        destroy_classifier(classifier);
+        return NULL;
+    }
+    return classifier;
+}
+
+static int clip_crop(const image_buffer_t *img, const image_rect_t *box, image_rect_t *crop)
+{
+    // even for the subsampled chroma of YUV sources
+    crop->left = (box->left < 0 ? 0 : box->left) & ~1;
+    crop->top = (box->top < 0 ? 0 : box->top) & ~1;
+    crop->right = (((box->right >= img->width ? img->width - 1 : box->right) + 1) & ~1) - 1;
+    crop->bottom = (((box->bottom >= img->height ? img->height - 1 : box->bottom) + 1) & ~1) - 1;
+    return crop->right > crop->left && crop->bottom > crop->top ? 0 : -1;
+}
+
+static image_buffer_t slot_image(struct classifier_t *classifier, int slot)
+{
+    image_buffer_t img = classifier->batch;
+    img.height = classifier->height;
+    img.size = classifier->width * classifier->height * 3;
+    img.virt_addr = classifier->batch.virt_addr + slot * img.size;
+    return img;
+}
+
+// every crop of the batch in one RGA job, the source frames are imported once
+static int crop_batch_rga(struct classifier_t *classifier, const classifier_entry_t *entries,
+                          const image_rect_t *crops, int count)
+{
+    int dst_fmt = get_rga_fmt(IMAGE_FORMAT_RGB888);
+    rga_sched_request_t requests[CLASSIFIER_MAX_BATCH];
+    for (int i = 0; i < count; i++)
+    {
+        if (get_rga_fmt(entries[i].frame->img.format) < 0)
+        {
+            return -1;
+        }
+        requests[i].src_format = entries[i].frame->img.format;
+        requests[i].dst_format = IMAGE_FORMAT_RGB888;
+        requests[i].src_width = crops[i].right - crops[i].left + 1;
+        requests[i].src_height = crops[i].bottom - crops[i].top + 1;
+        requests[i].dst_width = classifier->width;
+        requests[i].dst_height = classifier->height;
+    }
+    int core = -1;
+    int im_core = rga_scheduler_acquire_batch(requests, count, &core);
+    if (im_core < 0)
+    {
+        return -1;
+    }
+    if (classifier->batch_handle <= 0)
+    {
+        classifier->batch_handle = rga_import_image(&classifier->batch, dst_fmt);
+        if (classifier->batch_handle <= 0)
+        {
+            classifier->batch_handle = 0;
+            rga_scheduler_release(core);
+            return -1;
+        }
+    }
+
+    std::vector<frame_t *> frames;
+    std::vector<int> handles;
+    int ret = 0;
+    for (int i = 0; i < count && ret == 0; i++)
+    {
+        if (!frames.empty() && frames.back() == entries[i].frame)
+        {
+            continue;
+        }
+        int handle = rga_import_image(&entries[i].frame->img, get_rga_fmt(entries[i].frame->img.format));
+        if (handle <= 0)
+        {
+            ret = -1;
+            break;
+        }
+        frames.push_back(entries[i].frame);
+        handles.push_back(handle);
+    }
+
+    im_job_handle_t job_handle = ret == 0 ? imbeginJob() : 0;
+    if (ret == 0 && job_handle <= 0)
+    {
+        printf("imbeginJob fail\n");
+        ret = -1;
+    }
+    if (ret == 0)
+    {
+        rga_buffer_t dst = wrapbuffer_handle(classifier->batch_handle, classifier->batch.width,
+                                             classifier->batch.height, dst_fmt);
+        rga_buffer_t pat;
+        memset(&pat, 0, sizeof(rga_buffer_t));
+        im_rect prect;
+        memset(&prect, 0, sizeof(im_rect));
+        im_opt_t opt;
+        memset(&opt, 0, sizeof(im_opt_t));
+        opt.core = im_core;
+        size_t f = 0;
+        for (int i = 0; i < count; i++)
+        {
+            while (frames[f] != entries[i].frame)
+            {
+                f++;
+            }
+            image_buffer_t *src_img = &entries[i].frame->img;
+            rga_buffer_t src = wrapbuffer_handle(handles[f], src_img->width, src_img->height,
+                                                 get_rga_fmt(src_img->format), get_image_width_stride(src_img),
+                                                 get_image_height_stride(src_img));
+            im_rect srect = {crops[i].left, crops[i].top, crops[i].right - crops[i].left + 1,
+                             crops[i].bottom - crops[i].top + 1};
+            im_rect drect = {0, i * classifier->height, classifier->width, classifier->height};
+            IM_STATUS status = improcessTask(job_handle, src, dst, pat, srect, drect, prect, &opt, 0);
+            if (status <= 0)
+            {
+                printf("classifier crop %d improcessTask fail: %s\n", i, imStrError(status));
+                imcancelJob(job_handle);
+                ret = -1;
+                break;
+            }
+        }
+        if (ret == 0 && imendJob(job_handle, IM_SYNC, -1, NULL) <= 0)
+        {
+            printf("classifier imendJob fail\n");
+            ret = -1;
+        }
+    }
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+        releasebuffer_handle(handles[i]);
+    }
+    rga_scheduler_release(core);
+    return ret;
+}
+
+static void attach_outputs(struct classifier_t *classifier, const float *scores, const classifier_entry_t *entries,
+                           int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const float *row = scores + i * classifier->num_classes;
+        int best = 0;
+        float sum = 0;
+        int probs = 1;
+        for (int c = 0; c < classifier->num_classes; c++)
+        {
+            if (row[c] > row[best])
+            {
+                best = c;
+            }
+            probs = probs && row[c] >= 0;
+            sum += row[c];
+        }
+        // logits unless the model already ends with a softmax
+        float prop = row[best];
+        if (!probs || fabsf(sum - 1.0f) > 1e-2f)
+        {
+            float denom = 0;
+            for (int c = 0; c < classifier->num_classes; c++)
+            {
+                denom += expf(row[c] - row[best]);
+            }
+            prop = 1.0f / denom;
+        }
+        object_detect_result *res = &entries[i].frame->results.results[entries[i].index];
+        res->attr_id = best;
+        res->attr_prop = prop;
+    }
+}
+
+// a batch whose oldest crop waited that long no longer gives way
+static int batch_is_late(struct classifier_t *classifier, int64_t queued_ms)
+{
+    int limit_ms = classifier->config.max_wait_ms * 4;
+    return frame_clock_ms() - queued_ms > (limit_ms > 100 ? limit_ms : 100);
+}
+
+// 0: done; 1: gave way to a higher priority model, the rest is queued again; -1: error
+static int run_batch(struct classifier_t *classifier, int count)
+{
+    classifier_entry_t entries[CLASSIFIER_MAX_BATCH];
+    image_rect_t crops[CLASSIFIER_MAX_BATCH];
+    for (int i = 0; i < count; i++)
+    {
+        entries[i] = classifier->queue.front();
+        classifier->queue.pop_front();
+        // boxes were checked when queued
+        clip_crop(&entries[i].frame->img, &entries[i].frame->results.results[entries[i].index].box, &crops[i]);
+    }
+
+    int ret = crop_batch_rga(classifier, entries, crops, count);
+    if (ret != 0)
+    {
+        // one conversion per crop, RGA or CPU
+        ret = 0;
+        for (int i = 0; i < count && ret == 0; i++)
+        {
+            image_buffer_t slot = slot_image(classifier, i);
+            ret = convert_image(&entries[i].frame->img, &slot, &crops[i], NULL, 0);
+        }
+    }
+
+    // the model runs on model_batch slots at a time, trailing slots of the last run are ignored
+    int processed = 0;
+    int yielded = 0;
+    for (int first = 0; first < count && ret == 0; first += classifier->model_batch)
+    {
+        if (!classifier->draining && !batch_is_late(classifier, entries[0].queued_ms) &&
+            npu_sched_should_yield(classifier->npu_id))
+        {
+            yielded = 1;
+            break;
+        }
+        int n = count - first < classifier->model_batch ? count - first : classifier->model_batch;
+        rknn_input input;
+        memset(&input, 0, sizeof(input));
+        input.index = 0;
+        input.type = RKNN_TENSOR_UINT8;
+        input.fmt = RKNN_TENSOR_NHWC;
+        input.size = classifier->model_batch * classifier->width * classifier->height * 3;
+        input.buf = slot_image(classifier, first).virt_addr;
+        ret = rknn_inputs_set(classifier->ctx, 1, &input);
+        if (ret == 0)
+        {
+            ret = npu_sched_run(classifier->npu_id, classifier->ctx, nullptr);
+        }
+        if (ret < 0)
+        {
+            printf("classifier rknn_run fail! ret=%d\n", ret);
+            break;
+        }
+        rknn_output output;
+        memset(&output, 0, sizeof(output));
+        output.index = 0;
+        output.want_float = 1;
+        ret = rknn_outputs_get(classifier->ctx, 1, &output, NULL);
+        if (ret < 0)
+        {
+            printf("classifier rknn_outputs_get fail! ret=%d\n", ret);
+            break;
+        }
+        attach_outputs(classifier, (float *)output.buf, entries + first, n);
+        rknn_outputs_release(classifier->ctx, 1, &output);
+        processed = first + n;
+    }
+    if (ret != 0)
+    {
+        // failed crops stay unclassified
+        processed = count;
+    }
+    for (int i = count - 1; i >= processed; i--)
+    {
+        classifier->queue.push_front(entries[i]);
+    }
+    if (processed > 0)
+    {
+        classifier->num_batches++;
+        classifier->num_crops += processed;
+    }
+
+    // a frame is done once none of its crops is left in the queue
+    for (int i = 0; i < processed; i++)
+    {
+        frame_t *frame = entries[i].frame;
+        int last_of_frame = i + 1 == processed ? classifier->queue.empty() || classifier->queue.front().frame != frame
+                                               : entries[i + 1].frame != frame;
+        if (last_of_frame && classifier->done != NULL)
+        {
+            classifier->done(frame, classifier->done_arg);
+        }
+        frame_unref(frame);
+    }
+    if (ret < 0)
+    {
+        return -1;
+    }
+    return yielded;
+}
+
+int classifier_submit(struct classifier_t *classifier, frame_t *frame, int64_t now_ms)
+{
+    const classifier_config_t *config = &classifier->config;
+    int queued = 0;
+    // over budget the frame goes out unclassified
+    int admitted = frame->has_results && frame->results.count > 0 && npu_sched_admit(classifier->npu_id);
+    for (int i = 0; frame->has_results && i < frame->results.count; i++)
+    {
+        object_detect_result *res = &frame->results.results[i];
+        res->attr_id = 0;
+        res->attr_prop = 0;
+        image_rect_t crop;
+        if (!admitted || (config->det_class >= 0 && res->cls_id != config->det_class) || clip_crop(&frame->img, &res->box, &crop) != 0 ||
+            crop.right - crop.left + 1 < config->min_size || crop.bottom - crop.top + 1 < config->min_size)
+        {
+            continue;
+        }
+        classifier_entry_t entry = {frame_ref(frame), i, now_ms};
+        classifier->queue.push_back(entry);
+        queued++;
+    }
+    if (queued == 0 && classifier->done != NULL)
+    {
+        classifier->done(frame, classifier->done_arg);
+    }
+
+    int ret = 0;
+    while (ret == 0 && (int)classifier->queue.size() >= classifier->batch_size)
+    {
+        ret = run_batch(classifier, classifier->batch_size);
+    }
+    if (ret == 0 && config->max_wait_ms <= 0 && !classifier->queue.empty())
+    {
+        ret = run_batch(classifier, std::min((int)classifier->queue.size(), classifier->batch_size));
+    }
+    return ret < 0 ? -1 : 0;
+}
+
+int classifier_poll(struct classifier_t *classifier, int64_t now_ms)
+{
+    if (classifier->queue.empty() || now_ms - classifier->queue.front().queued_ms < classifier->config.max_wait_ms)
+    {
+        return 0;
+    }
+    return run_batch(classifier, std::min((int)classifier->queue.size(), classifier->batch_size)) < 0 ? -1 : 0;
+}
+
+int classifier_wait_ms(struct classifier_t *classifier, int64_t now_ms)
+{
+    if (classifier->queue.empty())
+    {
+        return -1;
+    }
+    int64_t wait = classifier->queue.front().queued_ms + classifier->config.max_wait_ms - now_ms;
+    return wait > 0 ? (int)wait : 0;
+}
+
+const char *classifier_attr_name(struct classifier_t *classifier, int attr_id)
+{
+    if (attr_id < 0 || attr_id >= (int)classifier->labels.size())
+    {
+        return "null";
+    }
+    return classifier->labels[attr_id].c_str();
+}
+
+void destroy_classifier(struct classifier_t *classifier)
+{
+    if (classifier == NULL)
+    {
+        return;
+    }
+    classifier->draining = true;
+    while (!classifier->queue.empty() && classifier->ctx != 0)
+    {
+        int count = classifier->queue.size();
+        run_batch(classifier, count < classifier->batch_size ? count : classifier->batch_size);
+    }
+    if (classifier->num_batches > 0)
+    {
+        printf("classifier %llu crops in %llu batches\n", (unsigned long long)classifier->num_crops,
+               (unsigned long long)classifier->num_batches);
+    }
+    if (classifier->batch_handle > 0)
+    {
+        releasebuffer_handle(classifier->batch_handle);
+    }
+    free(classifier->batch.virt_addr);
+    if (classifier->ctx != 0)
+    {
+        rknn_destroy(classifier->ctx);
+    }
+    delete classifier;
+}
@@ -0,0 +1,77 @@
+/*-------------------------------------------
+                Includes
+-------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "yolov5.h"
+
+// post process of recorded output tensors without any NPU: records come
+// from [inference] record on the board, the decoders run the same on a host
+
+/*-------------------------------------------
+                  Main Function
+-------------------------------------------*/
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("%s <record> [labels] [box_threshold] [nms_threshold]\n", argv[0]);
+        return -1;
+    }
+    const char *record_path = argv[1];
+    float box_threshold = argc > 3 ? atof(argv[3]) : BOX_THRESH;
+    float nms_threshold = argc > 4 ? atof(argv[4]) : NMS_THRESH;
+
+    rknn_app_context_t app_ctx;
+    memset(&app_ctx, 0, sizeof(rknn_app_context_t));
+    static seg_mask_list_t masks;
+    app_ctx.masks = &masks;
+    post_outputs_t outputs;
+    if (load_post_outputs(record_path, &app_ctx, &outputs) != 0)
+    {
+        return -1;
+    }
+    init_post_process(argc > 2 ? argv[2] : nullptr);
+
+    letterbox_t letterbox = {0, 0, 1.0f};
+    object_detect_result_list results;
+    int ret = post_process_buffers(&app_ctx, outputs.buf, &letterbox, box_threshold, nms_threshold, &results);
+    if (ret == 0)
+    {
+        printf("%s: %s head, %d outputs %s, model %dx%d, %d objects\n", record_path, app_ctx.decoder->name,
+               outputs.count, app_ctx.is_quant ? "int8" : (app_ctx.is_fp16 ? "fp16" : "fp32"), app_ctx.model_width,
+               app_ctx.model_height, results.count);
+        for (int i = 0; i < results.count; i++)
+        {
+            object_detect_result *det = &results.results[i];
+            printf("%s @ (%d %d %d %d) %.3f", coco_cls_to_name(det->cls_id), det->box.left, det->box.top,
+                   det->box.right, det->box.bottom, det->prop);
+            if (i < masks.count)
+            {
+                printf(" mask %d pixels in %d runs", det->mask_area, masks.run_count[i]);
+                // runs alternate background and mask over the whole box, -1: pool was full
+                long total = 0;
+                long area = 0;
+                for (int r = 0; r < masks.run_count[i]; r++)
+                {
+                    uint32_t run = masks.runs[masks.run_start[i] + r];
+                    total += run;
+                    area += (r % 2) ? run : 0;
+                }
+                long box_area = (long)(det->box.right - det->box.left) * (det->box.bottom - det->box.top);
+                if (masks.run_count[i] >= 0 && (total != box_area || area != det->mask_area))
+                {
+                    printf(" (runs cover %ld of %ld box pixels, %ld masked)", total, box_area, area);
+                    ret = -1;
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    deinit_post_process();
+    free_post_outputs(&app_ctx, &outputs);
+    return ret;
+}
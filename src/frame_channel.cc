@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "frame_channel.h"
+
+struct frame_channel_t {
+    std::string name;
+    int capacity;
+    frame_channel_policy_t policy;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<frame_t*> frames;
+    frame_channel_stats_t stats;
+};
+
+struct frame_channel_t *create_frame_channel(const char *name, int capacity, frame_channel_policy_t policy)
+{
+    if (capacity <= 0)
+    {
+        printf("frame channel %s capacity %d invalid\n", name, capacity);
+        return NULL;
+    }
+    frame_channel_t *channel = new frame_channel_t();
+    channel->name = name != NULL ? name : "";
+    channel->capacity = capacity;
+    channel->policy = policy;
+    channel->closed = false;
+    memset(&channel->stats, 0, sizeof(frame_channel_stats_t));
+    return channel;
+}
+
+void destroy_frame_channel(struct frame_channel_t *channel)
+{
+    if (channel == NULL)
+    {
+        return;
+    }
+    frame_channel_close(channel);
+    while (!channel->frames.empty())
+    {
+        frame_unref(channel->frames.front());
+        channel->frames.pop_front();
+    }
+    delete channel;
+}
+
+int frame_channel_push(struct frame_channel_t *channel, frame_t *frame, int timeout_ms)
+{
+    frame_t *dropped = NULL;
+    {
+        std::unique_lock<std::mutex> lock(channel->mutex);
+        if (channel->closed)
+        {
+            return -1;
+        }
+        if ((int)channel->frames.size() >= channel->capacity)
+        {
+            switch (channel->policy)
+            {
+            case FRAME_CHANNEL_DROP_OLDEST:
+                dropped = channel->frames.front();
+                channel->frames.pop_front();
+                break;
+            case FRAME_CHANNEL_DROP_NEWEST:
+                channel->stats.dropped++;
+                return 1;
+            case FRAME_CHANNEL_BLOCK:
+            {
+                auto has_credit = [channel] {
+                    return channel->closed || (int)channel->frames.size() < channel->capacity;
+                };
+                if (timeout_ms < 0)
+                {
+                    channel->not_full.wait(lock, has_credit);
+                }
+                else if (!channel->not_full.wait_for(lock, std::chrono::milliseconds(timeout_ms), has_credit))
+                {
+                    channel->stats.dropped++;
+                    return 1;
+                }
+                if (channel->closed)
+                {
+                    return -1;
+                }
+                break;
+            }
+            }
+        }
+        channel->frames.push_back(frame_ref(frame));
+        channel->stats.pushed++;
+        if (dropped != NULL)
+        {
+            channel->stats.dropped++;
+        }
+    }
+    channel->not_empty.notify_one();
+    // released outside the lock, the pool has its own one
+    frame_unref(dropped);
+    return 0;
+}
+
+frame_t *frame_channel_pop(struct frame_channel_t *channel, int timeout_ms)
+{
+    frame_t *frame = NULL;
+    {
+        std::unique_lock<std::mutex> lock(channel->mutex);
+        auto ready = [channel] { return channel->closed || !channel->frames.empty(); };
+        if (timeout_ms < 0)
+        {
+            channel->not_empty.wait(lock, ready);
+        }
+        else if (!channel->not_empty.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready))
+        {
+            return NULL;
+        }
+        if (channel->frames.empty())
+        {
+            return NULL;
+        }
+        frame = channel->frames.front();
+        channel->frames.pop_front();
+        channel->stats.popped++;
+    }
+    channel->not_full.notify_one();
+    return frame;
+}
+
+int frame_channel_credits(struct frame_channel_t *channel)
+{
+    std::lock_guard<std::mutex> lock(channel->mutex);
+    return channel->capacity - (int)channel->frames.size();
+}
+
+void frame_channel_close(struct frame_channel_t *channel)
+{
+    {
+        std::lock_guard<std::mutex> lock(channel->mutex);
+        channel->closed = true;
+    }
+    channel->not_empty.notify_all();
+    channel->not_full.notify_all();
+}
+
+void frame_channel_get_stats(struct frame_channel_t *channel, frame_channel_stats_t *stats)
+{
+    std::lock_guard<std::mutex> lock(channel->mutex);
+    *stats = channel->stats;
+}
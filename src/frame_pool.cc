@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "frame_pool.h"
+
+struct frame_pool_t {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<frame_t*> frames;
+    std::vector<frame_t*> free_list;
+    uint64_t next_seq;
+};
+
+struct frame_pool_t *create_frame_pool(int count, int width, int height, image_format_t format, int width_stride)
+{
+    if (count <= 0 || width <= 0 || height <= 0)
+    {
+        return NULL;
+    }
+    frame_pool_t *pool = new frame_pool_t();
+    pool->next_seq = 0;
+    for (int i = 0; i < count; i++)
+    {
+        frame_t *frame = (frame_t *)calloc(1, sizeof(frame_t));
+        if (frame == NULL)
+        {
+            destroy_frame_pool(pool);
+            return NULL;
+        }
+        frame->img.width = width;
+        frame->img.height = height;
+        frame->img.width_stride = width_stride;
+        frame->img.format = format;
+        frame->img.fd = -1;
+        frame->img.size = get_image_size(&frame->img);
+        // cache line aligned for the NEON kernels
+        void *addr = NULL;
+        if (posix_memalign(&addr, 64, frame->img.size) != 0)
+        {
+            printf("frame pool malloc size %d fail\n", frame->img.size);
+            free(frame);
+            destroy_frame_pool(pool);
+            return NULL;
+        }
+        frame->img.virt_addr = (unsigned char *)addr;
+        frame->pool = pool;
+        frame->index = i;
+        pool->frames.push_back(frame);
+        pool->free_list.push_back(frame);
+    }
+    return pool;
+}
+
+void destroy_frame_pool(struct frame_pool_t *pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+    if (pool->free_list.size() != pool->frames.size())
+    {
+        printf("destroy frame pool with %d frames in use\n", (int)(pool->frames.size() - pool->free_list.size()));
+    }
+    for (size_t i = 0; i < pool->frames.size(); i++)
+    {
+        free(pool->frames[i]->img.virt_addr);
+        free(pool->frames[i]);
+    }
+    delete pool;
+}
+
+frame_t *frame_pool_acquire(struct frame_pool_t *pool, int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    if (timeout_ms < 0)
+    {
+        pool->cond.wait(lock, [pool] { return !pool->free_list.empty(); });
+    }
+    else if (!pool->cond.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                  [pool] { return !pool->free_list.empty(); }))
+    {
+        return NULL;
+    }
+    frame_t *frame = pool->free_list.back();
+    pool->free_list.pop_back();
+    frame->refcount = 1;
+    frame->seq = pool->next_seq++;
+    memset(&frame->timestamp, 0, sizeof(frame->timestamp));
+    frame->capture_ms = frame_clock_ms();
+    memset(&frame->letterbox, 0, sizeof(frame->letterbox));
+    frame->bundle.count = 0;
+    frame->results.count = 0;
+    frame->has_results = 0;
+    return frame;
+}
+
+int frame_pool_free_count(struct frame_pool_t *pool)
+{
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    return (int)pool->free_list.size();
+}
+
+int64_t frame_clock_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+frame_t *frame_ref(frame_t *frame)
+{
+    std::lock_guard<std::mutex> lock(frame->pool->mutex);
+    frame->refcount++;
+    return frame;
+}
+
+void frame_unref(frame_t *frame)
+{
+    if (frame == NULL)
+    {
+        return;
+    }
+    frame_pool_t *pool = frame->pool;
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (frame->refcount <= 0)
+        {
+            printf("frame %llu released too many times\n", (unsigned long long)frame->seq);
+            return;
+        }
+        if (--frame->refcount > 0)
+        {
+            return;
+        }
+        pool->free_list.push_back(frame);
+    }
+    pool->cond.notify_one();
+}
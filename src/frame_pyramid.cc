@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "im2d.h"
+#include "rga.h"
+
+#include "frame_pyramid.h"
+#include "rga_scheduler.h"
+
+static void reset_job(rga_job_t *job)
+{
+    memset(job, 0, sizeof(rga_job_t));
+    job->fence_fd = -1;
+    job->core = -1;
+}
+
+static int build_output_plan(frame_pyramid_output_t *out, image_buffer_t *src)
+{
+    if (letterbox_plan_match(&out->plan, src, &out->img))
+    {
+        return 0;
+    }
+    // letterbox_t has one scale for both axes, boxes of a distorted output could not be mapped back
+    if (!out->letterbox && (long)out->img.width * src->height != (long)out->img.height * src->width)
+    {
+        printf("stretch output %dx%d does not keep the aspect ratio of %dx%d\n", out->img.width, out->img.height,
+               src->width, src->height);
+        return -1;
+    }
+    if (init_letterbox_plan(&out->plan, src->width, src->height, out->img.width, out->img.height, out->color) != 0)
+    {
+        return -1;
+    }
+    if (!out->letterbox)
+    {
+        out->plan.dst_box.left = 0;
+        out->plan.dst_box.top = 0;
+        out->plan.dst_box.right = out->img.width - 1;
+        out->plan.dst_box.bottom = out->img.height - 1;
+        out->plan.need_pad = 0;
+        out->plan.letterbox.x_pad = 0;
+        out->plan.letterbox.y_pad = 0;
+        out->plan.letterbox.scale = (float)out->img.width / src->width;
+    }
+    return 0;
+}
+
+static im_rect to_im_rect(const image_rect_t *box)
+{
+    im_rect rect = {box->left, box->top, box->right - box->left + 1, box->bottom - box->top + 1};
+    return rect;
+}
+
+static int submit_rga(frame_pyramid_t *pyramid, image_buffer_t *src)
+{
+    rga_job_t *job = &pyramid->job;
+    int srcFmt = get_rga_fmt(src->format);
+    if (srcFmt < 0)
+    {
+        return -1;
+    }
+
+    rga_sched_request_t requests[FRAME_PYRAMID_MAX_OUTPUTS];
+    for (int i = 0; i < pyramid->num_outputs; i++)
+    {
+        frame_pyramid_output_t *out = &pyramid->outputs[i];
+        if (get_rga_fmt(out->img.format) < 0)
+        {
+            return -1;
+        }
+        requests[i].src_format = src->format;
+        requests[i].dst_format = out->img.format;
+        requests[i].src_width = src->width;
+        requests[i].src_height = src->height;
+        requests[i].dst_width = out->plan.dst_box.right - out->plan.dst_box.left + 1;
+        requests[i].dst_height = out->plan.dst_box.bottom - out->plan.dst_box.top + 1;
+    }
+    int im_core = rga_scheduler_acquire_batch(requests, pyramid->num_outputs, &job->core);
+    if (im_core < 0)
+    {
+        printf("no rga core supports every pyramid output\n");
+        return -1;
+    }
+
+    // the source is imported once per frame, outputs once for the pyramid lifetime
+    job->src_handle = rga_import_image(src, srcFmt);
+    if (job->src_handle <= 0)
+    {
+        printf("rga import src handle error %d\n", job->src_handle);
+        job->status = -1;
+        rga_job_wait(job, 0);
+        return -1;
+    }
+    for (int i = 0; i < pyramid->num_outputs; i++)
+    {
+        frame_pyramid_output_t *out = &pyramid->outputs[i];
+        if (out->handle <= 0)
+        {
+            out->handle = rga_import_image(&out->img, get_rga_fmt(out->img.format));
+            if (out->handle <= 0)
+            {
+                printf("rga import output %d handle error %d\n", i, out->handle);
+                out->handle = 0;
+                job->status = -1;
+                rga_job_wait(job, 0);
+                return -1;
+            }
+        }
+    }
+
+    rga_buffer_t rga_buf_src = wrapbuffer_handle(job->src_handle, src->width, src->height, srcFmt,
+                                                 get_image_width_stride(src), get_image_height_stride(src));
+    rga_buffer_t pat;
+    memset(&pat, 0, sizeof(rga_buffer_t));
+    im_rect prect;
+    memset(&prect, 0, sizeof(im_rect));
+    im_opt_t opt;
+    memset(&opt, 0, sizeof(im_opt_t));
+    opt.core = im_core;
+
+    im_job_handle_t job_handle = imbeginJob();
+    if (job_handle <= 0)
+    {
+        printf("imbeginJob fail\n");
+        job->status = -1;
+        rga_job_wait(job, 0);
+        return -1;
+    }
+
+    IM_STATUS ret_rga = IM_STATUS_SUCCESS;
+    for (int i = 0; i < pyramid->num_outputs; i++)
+    {
+        frame_pyramid_output_t *out = &pyramid->outputs[i];
+        image_buffer_t *dst = &out->img;
+        int dstFmt = get_rga_fmt(dst->format);
+        rga_buffer_t rga_buf_dst = wrapbuffer_handle(out->handle, dst->width, dst->height, dstFmt,
+                                                     get_image_width_stride(dst), get_image_height_stride(dst));
+
+        if (letterbox_plan_begin_fill(&out->plan, dst))
+        {
+            ret_rga = IM_STATUS_NOT_SUPPORTED;
+            if (rga_scheduler_core_can_fill(job->core))
+            {
+                im_rect dst_whole_rect = {0, 0, dst->width, dst->height};
+                uint32_t imcolor;
+                memset(&imcolor, out->color, sizeof(imcolor));
+                ret_rga = imfillTask(job_handle, rga_buf_dst, dst_whole_rect, imcolor);
+            }
+            if (ret_rga <= 0)
+            {
+                memset(dst->virt_addr, out->color, get_image_size(dst));
+            }
+        }
+
+        im_rect srect = to_im_rect(&out->plan.src_box);
+        im_rect drect = to_im_rect(&out->plan.dst_box);
+        ret_rga = improcessTask(job_handle, rga_buf_src, rga_buf_dst, pat, srect, drect, prect, &opt, 0);
+        if (ret_rga <= 0)
+        {
+            printf("Error on improcessTask output %d STATUS=%d\n", i, ret_rga);
+            printf("RGA error message: %s\n", imStrError((IM_STATUS)ret_rga));
+            imcancelJob(job_handle);
+            job->status = -1;
+            rga_job_wait(job, 0);
+            return -1;
+        }
+    }
+
+    ret_rga = imendJob(job_handle, IM_ASYNC, -1, &job->fence_fd);
+    if (ret_rga <= 0)
+    {
+        printf("Error on imendJob STATUS=%d\n", ret_rga);
+        job->fence_fd = -1;
+        job->status = -1;
+        rga_job_wait(job, 0);
+        return -1;
+    }
+    return 0;
+}
+
+// YUV420SP outputs get a 16 pixel aligned width stride for the encoder
+static void set_output_size(image_buffer_t *img, int width, int height)
+{
+    img->width = width;
+    img->height = height;
+    img->width_stride = 0;
+    if (img->format == IMAGE_FORMAT_YUV420SP_NV12 || img->format == IMAGE_FORMAT_YUV420SP_NV21)
+    {
+        img->width_stride = (width + 15) & ~15;
+    }
+    img->size = get_image_size(img);
+}
+
+int init_frame_pyramid(frame_pyramid_t *pyramid)
+{
+    memset(pyramid, 0, sizeof(frame_pyramid_t));
+    reset_job(&pyramid->job);
+    return 0;
+}
+
+int frame_pyramid_add_output(frame_pyramid_t *pyramid, int width, int height, image_format_t format, int letterbox,
+                             char color)
+{
+    if (pyramid->num_outputs >= FRAME_PYRAMID_MAX_OUTPUTS)
+    {
+        printf("frame pyramid has already %d outputs\n", pyramid->num_outputs);
+        return -1;
+    }
+    frame_pyramid_output_t *out = &pyramid->outputs[pyramid->num_outputs];
+    memset(out, 0, sizeof(frame_pyramid_output_t));
+    out->img.format = format;
+    set_output_size(&out->img, width, height);
+    out->img.virt_addr = (unsigned char *)malloc(out->img.size);
+    if (out->img.virt_addr == NULL)
+    {
+        printf("malloc buffer size:%d fail!\n", out->img.size);
+        return -1;
+    }
+    out->capacity = out->img.size;
+    out->letterbox = letterbox;
+    out->color = color;
+    return pyramid->num_outputs++;
+}
+
+int frame_pyramid_resize_output(frame_pyramid_t *pyramid, int index, int width, int height)
+{
+    if (index < 0 || index >= pyramid->num_outputs)
+    {
+        return -1;
+    }
+    frame_pyramid_output_t *out = &pyramid->outputs[index];
+    if (out->img.width == width && out->img.height == height)
+    {
+        return 0;
+    }
+    image_buffer_t resized = out->img;
+    set_output_size(&resized, width, height);
+    if (resized.size > out->capacity)
+    {
+        printf("pyramid output %d of %d bytes can not take %dx%d\n", index, out->capacity, width, height);
+        return -1;
+    }
+    rga_job_wait(&pyramid->job, -1);
+    // the import carries the dims, the plan follows on the next submit
+    if (out->handle > 0)
+    {
+        releasebuffer_handle(out->handle);
+        out->handle = 0;
+    }
+    out->img = resized;
+    return 0;
+}
+
+int frame_pyramid_submit(frame_pyramid_t *pyramid, image_buffer_t *src_image)
+{
+    if (pyramid->num_outputs == 0 || src_image == NULL)
+    {
+        return -1;
+    }
+    rga_job_wait(&pyramid->job, -1);
+    reset_job(&pyramid->job);
+
+    for (int i = 0; i < pyramid->num_outputs; i++)
+    {
+        if (build_output_plan(&pyramid->outputs[i], src_image) != 0)
+        {
+            return -1;
+        }
+    }
+
+    int ret = submit_rga(pyramid, src_image);
+    if (ret != 0)
+    {
+        // one conversion per output, every one reads the source again
+        ret = 0;
+        for (int i = 0; i < pyramid->num_outputs && ret == 0; i++)
+        {
+            frame_pyramid_output_t *out = &pyramid->outputs[i];
+            out->plan.pad_filled = 0;
+            ret = convert_image_with_letterbox_plan(src_image, &out->img, &out->plan);
+        }
+    }
+    pyramid->job.status = ret;
+    return ret;
+}
+
+int frame_pyramid_wait(frame_pyramid_t *pyramid, frame_bundle_t *bundle, int timeout_ms)
+{
+    int ret = rga_job_wait(&pyramid->job, timeout_ms);
+    if (ret != 0)
+    {
+        return ret;
+    }
+    bundle->count = pyramid->num_outputs;
+    for (int i = 0; i < pyramid->num_outputs; i++)
+    {
+        bundle->images[i] = &pyramid->outputs[i].img;
+        bundle->letterbox[i] = pyramid->outputs[i].plan.letterbox;
+    }
+    return 0;
+}
+
+void release_frame_pyramid(frame_pyramid_t *pyramid)
+{
+    rga_job_wait(&pyramid->job, -1);
+    for (int i = 0; i < pyramid->num_outputs; i++)
+    {
+        frame_pyramid_output_t *out = &pyramid->outputs[i];
+        if (out->handle > 0)
+        {
+            releasebuffer_handle(out->handle);
+            out->handle = 0;
+        }
+        release_letterbox_plan(&out->plan);
+        free(out->img.virt_addr);
+        out->img.virt_addr = NULL;
+    }
+    pyramid->num_outputs = 0;
+}
@@ -0,0 +1,222 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "infer_client.h"
+#include "infer_ipc.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+struct infer_client_t {
+    int sock;
+    int ring_fd;
+    void *ring;
+    size_t ring_size;
+    int num_slots;
+    int width;
+    int height;
+    int channels;
+};
+
+// older C libraries have no memfd_create() wrapper
+static int create_memfd(const char *name)
+{
+#ifdef SYS_memfd_create
+    return (int)syscall(SYS_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+struct infer_client_t *infer_client_connect(const char *path, int num_slots)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path) || num_slots <= 0 || num_slots > INFER_IPC_MAX_SLOTS)
+    {
+        printf("infer client path %s too long or %d slots not supported\n", path, num_slots);
+        return NULL;
+    }
+    infer_client_t *client = (infer_client_t *)calloc(1, sizeof(infer_client_t));
+    if (client == NULL)
+    {
+        return NULL;
+    }
+    client->ring_fd = -1;
+    client->sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    if (client->sock < 0 || connect(client->sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        printf("infer client connect to %s fail! errno=%d\n", path, errno);
+        infer_client_close(client);
+        return NULL;
+    }
+
+    // the server tells the model input, the ring is sized after it
+    infer_msg_t msg;
+    if (infer_recv_msg(client->sock, &msg, NULL, 5000) != 0 || msg.type != INFER_MSG_MODEL || msg.width <= 0 ||
+        msg.height <= 0 || msg.channels <= 0)
+    {
+        printf("infer client no model from %s\n", path);
+        infer_client_close(client);
+        return NULL;
+    }
+    client->width = msg.width;
+    client->height = msg.height;
+    client->channels = msg.channels;
+    int image_size = msg.width * msg.height * msg.channels;
+
+    client->num_slots = num_slots;
+    client->ring_size = infer_ring_size(num_slots, image_size);
+    client->ring_fd = create_memfd("infer_ring");
+    // sealed at its size, neither side can truncate the ring under the mapping of the other
+    if (client->ring_fd < 0 || ftruncate(client->ring_fd, client->ring_size) != 0 ||
+        fcntl(client->ring_fd, F_ADD_SEALS, INFER_RING_SEALS) != 0)
+    {
+        printf("infer client ring of %zu bytes fail! errno=%d\n", client->ring_size, errno);
+        infer_client_close(client);
+        return NULL;
+    }
+    client->ring = mmap(NULL, client->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, client->ring_fd, 0);
+    if (client->ring == MAP_FAILED)
+    {
+        client->ring = NULL;
+        printf("infer client ring mmap fail! errno=%d\n", errno);
+        infer_client_close(client);
+        return NULL;
+    }
+    infer_ring_init(client->ring, num_slots, image_size);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = INFER_MSG_RING;
+    msg.num_slots = num_slots;
+    msg.ring_size = client->ring_size;
+    if (infer_send_msg(client->sock, &msg, client->ring_fd) != 0 ||
+        infer_recv_msg(client->sock, &msg, NULL, 5000) != 0 || msg.type != INFER_MSG_RING || msg.status != 0)
+    {
+        printf("infer client ring refused by %s\n", path);
+        infer_client_close(client);
+        return NULL;
+    }
+    printf("infer client connected to %s, model input %dx%dx%d, %d slots\n", path, client->width, client->height,
+           client->channels, num_slots);
+    return client;
+}
+
+void infer_client_close(struct infer_client_t *client)
+{
+    if (client == NULL)
+    {
+        return;
+    }
+    if (client->ring != NULL)
+    {
+        munmap(client->ring, client->ring_size);
+    }
+    if (client->ring_fd >= 0)
+    {
+        close(client->ring_fd);
+    }
+    if (client->sock >= 0)
+    {
+        close(client->sock);
+    }
+    free(client);
+}
+
+void infer_client_model_size(struct infer_client_t *client, int *width, int *height, int *channels)
+{
+    *width = client->width;
+    *height = client->height;
+    *channels = client->channels;
+}
+
+int infer_client_slot_image(struct infer_client_t *client, int slot, image_buffer_t *img)
+{
+    if (slot < 0 || slot >= client->num_slots)
+    {
+        return -1;
+    }
+    memset(img, 0, sizeof(image_buffer_t));
+    img->width = client->width;
+    img->height = client->height;
+    img->format = IMAGE_FORMAT_RGB888;
+    img->virt_addr = infer_ring_image(client->ring, slot);
+    img->size = client->width * client->height * client->channels;
+    // a memfd is no dma-buf, the RGA goes through the virtual address
+    img->fd = -1;
+    return 0;
+}
+
+int infer_client_submit(struct infer_client_t *client, int slot, const letterbox_t *letterbox, uint64_t seq)
+{
+    if (slot < 0 || slot >= client->num_slots)
+    {
+        return -1;
+    }
+    infer_slot_t *s = infer_ring_slot(client->ring, slot);
+    s->letterbox = *letterbox;
+    s->status = -1;
+    s->results.count = 0;
+
+    infer_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = INFER_MSG_SUBMIT;
+    msg.slot = slot;
+    msg.seq = seq;
+    if (infer_send_msg(client->sock, &msg, -1) != 0)
+    {
+        printf("infer client submit fail, server gone\n");
+        return -1;
+    }
+    return 0;
+}
+
+int infer_client_wait(struct infer_client_t *client, int timeout_ms, int *slot, uint64_t *seq,
+                      object_detect_result_list **results)
+{
+    infer_msg_t msg;
+    int ret = infer_recv_msg(client->sock, &msg, NULL, timeout_ms);
+    if (ret != 0)
+    {
+        if (ret < 0)
+        {
+            printf("infer client wait fail, server gone\n");
+        }
+        return ret;
+    }
+    if (msg.type != INFER_MSG_DONE || msg.slot < 0 || msg.slot >= client->num_slots)
+    {
+        printf("infer client unexpected message type=%d slot=%d\n", msg.type, msg.slot);
+        return -1;
+    }
+    *slot = msg.slot;
+    if (seq != NULL)
+    {
+        *seq = msg.seq;
+    }
+    *results = &infer_ring_slot(client->ring, msg.slot)->results;
+    return 0;
+}
+
+int infer_client_status(struct infer_client_t *client, int slot)
+{
+    if (slot < 0 || slot >= client->num_slots)
+    {
+        return -1;
+    }
+    return infer_ring_slot(client->ring, slot)->status;
+}
@@ -0,0 +1,167 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "infer_ipc.h"
+
+// slot headers and images cache line aligned
+#define RING_ALIGN(x) (((x) + 63) & ~(size_t)63)
+
+static size_t slot_stride(int image_size)
+{
+    return RING_ALIGN(sizeof(infer_slot_t)) + RING_ALIGN((size_t)image_size);
+}
+
+size_t infer_ring_size(int num_slots, int image_size)
+{
+    return RING_ALIGN(sizeof(infer_ring_header_t)) + num_slots * slot_stride(image_size);
+}
+
+void infer_ring_init(void *ring, int num_slots, int image_size)
+{
+    infer_ring_header_t *header = (infer_ring_header_t *)ring;
+    header->magic = INFER_IPC_MAGIC;
+    header->version = INFER_IPC_VERSION;
+    header->num_slots = num_slots;
+    header->image_size = image_size;
+    header->slot_stride = (int32_t)slot_stride(image_size);
+}
+
+int infer_ring_check(const void *ring, size_t ring_size, int image_size)
+{
+    if (ring_size < sizeof(infer_ring_header_t))
+    {
+        return -1;
+    }
+    const infer_ring_header_t *header = (const infer_ring_header_t *)ring;
+    if (header->magic != INFER_IPC_MAGIC || header->version != INFER_IPC_VERSION)
+    {
+        printf("infer ring magic 0x%x version %u not supported\n", header->magic, header->version);
+        return -1;
+    }
+    if (header->num_slots <= 0 || header->num_slots > INFER_IPC_MAX_SLOTS || header->image_size != image_size ||
+        header->slot_stride != (int32_t)slot_stride(image_size) ||
+        infer_ring_size(header->num_slots, image_size) > ring_size)
+    {
+        printf("infer ring of %d slots image_size=%d does not match the model or its size %zu\n", header->num_slots,
+               header->image_size, ring_size);
+        return -1;
+    }
+    return header->num_slots;
+}
+
+infer_slot_t *infer_ring_slot(void *ring, int slot)
+{
+    const infer_ring_header_t *header = (const infer_ring_header_t *)ring;
+    return (infer_slot_t *)((unsigned char *)ring + RING_ALIGN(sizeof(infer_ring_header_t)) +
+                            (size_t)slot * header->slot_stride);
+}
+
+unsigned char *infer_ring_image(void *ring, int slot)
+{
+    return (unsigned char *)infer_ring_slot(ring, slot) + RING_ALIGN(sizeof(infer_slot_t));
+}
+
+int infer_send_msg(int sock, const infer_msg_t *msg, int fd)
+{
+    struct iovec iov;
+    iov.iov_base = (void *)msg;
+    iov.iov_len = sizeof(infer_msg_t);
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    if (fd >= 0)
+    {
+        memset(control, 0, sizeof(control));
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof(control);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    ssize_t ret;
+    do
+    {
+        ret = sendmsg(sock, &hdr, MSG_NOSIGNAL);
+    } while (ret < 0 && errno == EINTR);
+    if (ret != (ssize_t)sizeof(infer_msg_t))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int infer_recv_msg(int sock, infer_msg_t *msg, int *fd, int timeout_ms)
+{
+    if (fd != NULL)
+    {
+        *fd = -1;
+    }
+    struct pollfd pfd = {sock, POLLIN, 0};
+    int ret;
+    do
+    {
+        ret = poll(&pfd, 1, timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0)
+    {
+        return -1;
+    }
+    if (ret == 0)
+    {
+        return 1;
+    }
+
+    struct iovec iov;
+    iov.iov_base = msg;
+    iov.iov_len = sizeof(infer_msg_t);
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof(control);
+
+    ssize_t len;
+    do
+    {
+        len = recvmsg(sock, &hdr, MSG_CMSG_CLOEXEC);
+    } while (len < 0 && errno == EINTR);
+
+    int passed = -1;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            memcpy(&passed, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    // 0: the peer closed the connection
+    if (len != (ssize_t)sizeof(infer_msg_t) || (hdr.msg_flags & (MSG_TRUNC | MSG_CTRUNC)))
+    {
+        if (passed >= 0)
+        {
+            close(passed);
+        }
+        return -1;
+    }
+    if (fd != NULL)
+    {
+        *fd = passed;
+    }
+    else if (passed >= 0)
+    {
+        close(passed);
+    }
+    return 0;
+}
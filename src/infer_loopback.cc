@@ -0,0 +1,207 @@
+/*-------------------------------------------
+                Includes
+-------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "infer_client.h"
+#include "infer_ipc.h"
+#include "infer_server.h"
+
+// round trip of the inference server without any NPU: the echo backend
+// returns one box made of the first pixel bytes and the letterbox of each
+// frame, so every client can check it got its own results back
+
+#define LOOPBACK_WIDTH 64
+#define LOOPBACK_HEIGHT 48
+// default slots per client, up to INFER_IPC_MAX_SLOTS fill batches beyond INFER_SERVER_MAX_BATCH
+#define LOOPBACK_SLOTS 2
+
+static struct infer_server_t *g_server;
+
+static void handle_signal(int sig)
+{
+    if (g_server != NULL)
+    {
+        infer_server_stop(g_server);
+    }
+}
+
+static void run_echo(infer_request_t *requests, int count, void *arg)
+{
+    int *max_batch = (int *)arg;
+    if (count > *max_batch)
+    {
+        *max_batch = count;
+        printf("loopback server batch of %d frames\n", count);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        const unsigned char *p = requests[i].img.virt_addr;
+        object_detect_result *res = &requests[i].results->results[0];
+        memset(res, 0, sizeof(object_detect_result));
+        res->box.left = p[0];
+        res->box.top = p[1];
+        res->box.right = p[requests[i].img.size - 2];
+        res->box.bottom = p[requests[i].img.size - 1];
+        res->cls_id = requests[i].letterbox.x_pad;
+        res->prop = requests[i].letterbox.scale;
+        requests[i].results->count = 1;
+        requests[i].status = 0;
+    }
+}
+
+static int run_server(const char *path)
+{
+    int max_batch = 0;
+    infer_backend_t backend = {LOOPBACK_WIDTH, LOOPBACK_HEIGHT, 3, run_echo, &max_batch};
+    g_server = create_infer_server(path, &backend);
+    if (g_server == NULL)
+    {
+        return -1;
+    }
+    signal(SIGTERM, handle_signal);
+    signal(SIGPIPE, SIG_IGN);
+    int ret = infer_server_run(g_server);
+    destroy_infer_server(g_server);
+    return ret;
+}
+
+// abort_after > 0: exit without closing with a frame in flight, as a crashed camera would
+static int run_client(const char *path, int id, int frames, int slots, int abort_after)
+{
+    struct infer_client_t *client = NULL;
+    for (int retry = 0; retry < 50 && client == NULL; retry++)
+    {
+        client = infer_client_connect(path, slots);
+        if (client == NULL)
+        {
+            usleep(20 * 1000);
+        }
+    }
+    if (client == NULL)
+    {
+        return -1;
+    }
+
+    int errors = 0;
+    int in_flight = 0;
+    int submitted = 0;
+    int done = 0;
+    while (done < frames)
+    {
+        // keep every slot busy, the next frames are written while the others run
+        while (in_flight < slots && submitted < frames)
+        {
+            int slot = submitted % slots;
+            image_buffer_t img;
+            infer_client_slot_image(client, slot, &img);
+            memset(img.virt_addr, (id * 16 + submitted) & 0xff, img.size);
+            letterbox_t letterbox = {id, submitted, 1.0f};
+            if (infer_client_submit(client, slot, &letterbox, submitted) != 0)
+            {
+                infer_client_close(client);
+                return -1;
+            }
+            submitted++;
+            in_flight++;
+            if (abort_after > 0 && submitted == abort_after)
+            {
+                printf("loopback client %d exits with a frame in flight\n", id);
+                _exit(0);
+            }
+        }
+
+        int slot;
+        uint64_t seq;
+        object_detect_result_list *results;
+        if (infer_client_wait(client, 2000, &slot, &seq, &results) != 0)
+        {
+            infer_client_close(client);
+            return -1;
+        }
+        in_flight--;
+        done++;
+        int value = (id * 16 + (int)seq) & 0xff;
+        object_detect_result *res = &results->results[0];
+        if (infer_client_status(client, slot) != 0 || results->count != 1 || res->box.left != value ||
+            res->box.bottom != value || res->cls_id != id)
+        {
+            errors++;
+        }
+    }
+    printf("loopback client %d: %d frames, %d errors\n", id, frames, errors);
+    infer_client_close(client);
+    return errors == 0 ? 0 : -1;
+}
+
+/*-------------------------------------------
+                  Main Function
+-------------------------------------------*/
+int main(int argc, char **argv)
+{
+    int num_clients = argc > 1 ? atoi(argv[1]) : 4;
+    int frames = argc > 2 ? atoi(argv[2]) : 1000;
+    int slots = argc > 3 ? atoi(argv[3]) : LOOPBACK_SLOTS;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/infer_loopback_%d.sock", (int)getpid());
+    if (num_clients <= 0 || num_clients > INFER_SERVER_MAX_CLIENTS - 1 || frames <= 0 || slots <= 0 ||
+        slots > INFER_IPC_MAX_SLOTS)
+    {
+        printf("%s [clients 1-%d] [frames] [slots 1-%d]\n", argv[0], INFER_SERVER_MAX_CLIENTS - 1,
+               INFER_IPC_MAX_SLOTS);
+        return -1;
+    }
+
+    // children leave with _exit(), nothing may wait in a stdio buffer
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    pid_t server = fork();
+    if (server == 0)
+    {
+        _exit(run_server(path) == 0 ? 0 : 1);
+    }
+
+    // one more client dies mid-stream, the others must not notice
+    pid_t clients[INFER_SERVER_MAX_CLIENTS];
+    for (int i = 0; i <= num_clients; i++)
+    {
+        clients[i] = fork();
+        if (clients[i] == 0)
+        {
+            int crash = i == num_clients;
+            _exit(run_client(path, i, frames, slots, crash ? frames / 2 + 1 : 0) == 0 ? 0 : 1);
+        }
+    }
+
+    int failed = 0;
+    for (int i = 0; i <= num_clients; i++)
+    {
+        int status = 0;
+        waitpid(clients[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            failed++;
+        }
+    }
+
+    // a camera restarting finds the server as it left it
+    if (failed == 0 && run_client(path, num_clients + 1, frames, slots, 0) != 0)
+    {
+        failed++;
+    }
+
+    kill(server, SIGTERM);
+    int status = 0;
+    waitpid(server, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        failed++;
+    }
+    printf("loopback %s: %d clients, %d frames each, %d slots\n", failed == 0 ? "passed" : "FAILED", num_clients,
+           frames, slots);
+    return failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,341 @@
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "infer_ipc.h"
+#include "infer_server.h"
+
+typedef struct {
+    int sock;
+    int ring_fd;
+    void *ring;
+    size_t ring_size;
+    int num_slots;
+    bool closing;
+} infer_conn_t;
+
+typedef struct {
+    int conn;
+    int slot;
+    uint64_t seq;
+} infer_pending_t;
+
+struct infer_server_t {
+    std::string path;
+    int listen_sock;
+    infer_backend_t backend;
+    int image_size;
+    infer_conn_t conns[INFER_SERVER_MAX_CLIENTS];
+    int num_conns;
+    // client read first in a round, moves on every round so a full batch leaves nobody behind
+    int first_conn;
+    volatile sig_atomic_t stop;
+    uint64_t frames;
+};
+
+static void close_conn(infer_conn_t *conn)
+{
+    if (conn->ring != NULL)
+    {
+        munmap(conn->ring, conn->ring_size);
+    }
+    if (conn->ring_fd >= 0)
+    {
+        close(conn->ring_fd);
+    }
+    close(conn->sock);
+    memset(conn, 0, sizeof(infer_conn_t));
+    conn->sock = -1;
+    conn->ring_fd = -1;
+}
+
+struct infer_server_t *create_infer_server(const char *path, const infer_backend_t *backend)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path) || backend->run == NULL)
+    {
+        printf("infer server path %s too long or no backend\n", path);
+        return NULL;
+    }
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+    {
+        printf("infer server socket fail! errno=%d\n", errno);
+        return NULL;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    unlink(path);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(sock, INFER_SERVER_MAX_CLIENTS) != 0)
+    {
+        printf("infer server listen on %s fail! errno=%d\n", path, errno);
+        close(sock);
+        return NULL;
+    }
+
+    infer_server_t *server = new infer_server_t();
+    server->path = path;
+    server->listen_sock = sock;
+    server->backend = *backend;
+    server->image_size = backend->width * backend->height * backend->channels;
+    server->num_conns = 0;
+    server->first_conn = 0;
+    server->stop = 0;
+    server->frames = 0;
+    printf("infer server listening on %s, model input %dx%dx%d\n", path, backend->width, backend->height,
+           backend->channels);
+    return server;
+}
+
+void destroy_infer_server(struct infer_server_t *server)
+{
+    if (server == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < server->num_conns; i++)
+    {
+        close_conn(&server->conns[i]);
+    }
+    close(server->listen_sock);
+    unlink(server->path.c_str());
+    delete server;
+}
+
+void infer_server_stop(struct infer_server_t *server)
+{
+    server->stop = 1;
+}
+
+static void accept_conn(infer_server_t *server)
+{
+    int sock = accept4(server->listen_sock, NULL, NULL, SOCK_CLOEXEC);
+    if (sock < 0)
+    {
+        return;
+    }
+    if (server->num_conns >= INFER_SERVER_MAX_CLIENTS)
+    {
+        printf("infer server has already %d clients\n", server->num_conns);
+        close(sock);
+        return;
+    }
+    infer_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = INFER_MSG_MODEL;
+    msg.width = server->backend.width;
+    msg.height = server->backend.height;
+    msg.channels = server->backend.channels;
+    if (infer_send_msg(sock, &msg, -1) != 0)
+    {
+        close(sock);
+        return;
+    }
+    infer_conn_t *conn = &server->conns[server->num_conns++];
+    memset(conn, 0, sizeof(infer_conn_t));
+    conn->sock = sock;
+    conn->ring_fd = -1;
+}
+
+static int map_ring(infer_server_t *server, infer_conn_t *conn, const infer_msg_t *msg, int fd)
+{
+    struct stat st;
+    if (conn->ring != NULL || fd < 0 || fstat(fd, &st) != 0 || st.st_size < msg->ring_size || msg->ring_size <= 0)
+    {
+        printf("infer client ring refused\n");
+        return -1;
+    }
+    // a client shrinking the file would SIGBUS the server on its next access
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || (seals & INFER_RING_SEALS) != INFER_RING_SEALS)
+    {
+        printf("infer client ring not sealed, refused\n");
+        return -1;
+    }
+    void *ring = mmap(NULL, msg->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED)
+    {
+        printf("infer client ring mmap fail! errno=%d\n", errno);
+        return -1;
+    }
+    int num_slots = infer_ring_check(ring, msg->ring_size, server->image_size);
+    if (num_slots < 0)
+    {
+        munmap(ring, msg->ring_size);
+        return -1;
+    }
+    conn->ring_fd = fd;
+    conn->ring = ring;
+    conn->ring_size = msg->ring_size;
+    conn->num_slots = num_slots;
+    printf("infer client %d connected with %d slots\n", conn->sock, num_slots);
+    return 0;
+}
+
+// every message queued on the connection, submits are appended to pending;
+// once the batch is full the rest stays in the socket for the next round
+static void read_conn(infer_server_t *server, int index, infer_pending_t *pending, int *num_pending)
+{
+    infer_conn_t *conn = &server->conns[index];
+    while (!conn->closing && *num_pending < INFER_SERVER_MAX_BATCH)
+    {
+        infer_msg_t msg;
+        int fd = -1;
+        int ret = infer_recv_msg(conn->sock, &msg, &fd, 0);
+        if (ret == 1)
+        {
+            return;
+        }
+        if (ret != 0)
+        {
+            conn->closing = true;
+            return;
+        }
+        if (msg.type == INFER_MSG_RING)
+        {
+            infer_msg_t reply;
+            memset(&reply, 0, sizeof(reply));
+            reply.type = INFER_MSG_RING;
+            reply.status = map_ring(server, conn, &msg, fd);
+            if (reply.status != 0 && fd >= 0)
+            {
+                close(fd);
+            }
+            if (infer_send_msg(conn->sock, &reply, -1) != 0 || reply.status != 0)
+            {
+                conn->closing = true;
+            }
+            continue;
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        if (msg.type != INFER_MSG_SUBMIT || conn->ring == NULL || msg.slot < 0 || msg.slot >= conn->num_slots)
+        {
+            printf("infer client %d bad message type=%d slot=%d\n", conn->sock, msg.type, msg.slot);
+            conn->closing = true;
+            return;
+        }
+        infer_pending_t *p = &pending[(*num_pending)++];
+        p->conn = index;
+        p->slot = msg.slot;
+        p->seq = msg.seq;
+    }
+}
+
+static void run_pending(infer_server_t *server, infer_pending_t *pending, int num_pending)
+{
+    infer_request_t requests[INFER_SERVER_MAX_BATCH];
+    for (int i = 0; i < num_pending; i++)
+    {
+        infer_conn_t *conn = &server->conns[pending[i].conn];
+        infer_slot_t *slot = infer_ring_slot(conn->ring, pending[i].slot);
+        infer_request_t *req = &requests[i];
+        memset(&req->img, 0, sizeof(image_buffer_t));
+        req->img.width = server->backend.width;
+        req->img.height = server->backend.height;
+        req->img.format = IMAGE_FORMAT_RGB888;
+        req->img.virt_addr = infer_ring_image(conn->ring, pending[i].slot);
+        req->img.size = server->image_size;
+        req->img.fd = -1;
+        req->letterbox = slot->letterbox;
+        req->results = &slot->results;
+        req->status = -1;
+    }
+    server->backend.run(requests, num_pending, server->backend.arg);
+    server->frames += num_pending;
+
+    for (int i = 0; i < num_pending; i++)
+    {
+        infer_conn_t *conn = &server->conns[pending[i].conn];
+        infer_slot_t *slot = infer_ring_slot(conn->ring, pending[i].slot);
+        slot->seq = pending[i].seq;
+        slot->status = requests[i].status;
+        infer_msg_t msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.type = INFER_MSG_DONE;
+        msg.slot = pending[i].slot;
+        msg.seq = pending[i].seq;
+        msg.status = requests[i].status;
+        if (!conn->closing && infer_send_msg(conn->sock, &msg, -1) != 0)
+        {
+            conn->closing = true;
+        }
+    }
+}
+
+int infer_server_run(struct infer_server_t *server)
+{
+    infer_pending_t pending[INFER_SERVER_MAX_BATCH];
+    while (!server->stop)
+    {
+        struct pollfd pfds[INFER_SERVER_MAX_CLIENTS + 1];
+        pfds[0].fd = server->listen_sock;
+        pfds[0].events = POLLIN;
+        pfds[0].revents = 0;
+        for (int i = 0; i < server->num_conns; i++)
+        {
+            pfds[i + 1].fd = server->conns[i].sock;
+            pfds[i + 1].events = POLLIN;
+            pfds[i + 1].revents = 0;
+        }
+        // the timeout only bounds how late a stop request is seen
+        int ret = poll(pfds, server->num_conns + 1, 200);
+        if (ret < 0 && errno != EINTR)
+        {
+            printf("infer server poll fail! errno=%d\n", errno);
+            return -1;
+        }
+        if (ret <= 0)
+        {
+            continue;
+        }
+
+        // one round takes the frames of every client, they run as one batch
+        int num_pending = 0;
+        int num_conns = server->num_conns;
+        int first = num_conns > 0 ? server->first_conn % num_conns : 0;
+        server->first_conn = first + 1;
+        for (int k = 0; k < num_conns; k++)
+        {
+            int i = (first + k) % num_conns;
+            if (pfds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                read_conn(server, i, pending, &num_pending);
+            }
+        }
+        if (num_pending > 0)
+        {
+            run_pending(server, pending, num_pending);
+        }
+
+        // a client gone only takes its own ring with it
+        for (int i = server->num_conns - 1; i >= 0; i--)
+        {
+            if (server->conns[i].closing)
+            {
+                printf("infer client %d disconnected\n", server->conns[i].sock);
+                close_conn(&server->conns[i]);
+                server->conns[i] = server->conns[--server->num_conns];
+            }
+        }
+        if (pfds[0].revents & POLLIN)
+        {
+            accept_conn(server);
+        }
+    }
+    printf("infer server stopped after %llu frames\n", (unsigned long long)server->frames);
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*-------------------------------------------
+                Includes
+-------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "yolov5.h"
+#include "infer_server.h"
+#include "npu_scheduler.h"
+
+// the contexts outlive every camera process, they connect and go as they like
+static struct infer_server_t *g_server;
+
+static void handle_signal(int sig)
+{
+    if (g_server != NULL)
+    {
+        infer_server_stop(g_server);
+    }
+}
+
+// the model is batch 1, frames of every client run back to back
+static void run_yolov5(infer_request_t *requests, int count, void *arg)
+{
+    rknn_app_context_t *app_ctx = (rknn_app_context_t *)arg;
+    for (int i = 0; i < count; i++)
+    {
+        yolov5_input_t input;
+        memset(&input, 0, sizeof(yolov5_input_t));
+        input.img = requests[i].img;
+        input.job.fence_fd = -1;
+        input.job.core = -1;
+        requests[i].status =
+            inference_yolov5_input_with_letterbox(app_ctx, &input, &requests[i].letterbox, requests[i].results) < 0
+                ? -1
+                : 0;
+    }
+}
+
+/*-------------------------------------------
+                  Main Function
+-------------------------------------------*/
+int main(int argc, char **argv)
+{
+    if (argc < 3 || argc > 4)
+    {
+        printf("%s <model_path> <socket_path> [label_path]\n", argv[0]);
+        return -1;
+    }
+    const char *model_path = argv[1];
+    const char *socket_path = argv[2];
+
+    rknn_app_context_t rknn_app_ctx;
+    memset(&rknn_app_ctx, 0, sizeof(rknn_app_context_t));
+    npu_sched_init(1, 10);
+    init_post_process(argc == 4 ? argv[3] : nullptr);
+    rknn_app_ctx.model_path = model_path;
+    int ret = init_yolov5_model(&rknn_app_ctx);
+    if (ret != 0)
+    {
+        printf("init_yolov5_model fail! ret=%d model_path=%s\n", ret, model_path);
+        deinit_post_process();
+        npu_sched_deinit();
+        return -1;
+    }
+    npu_model_desc_t desc = {"server", NPU_PRIORITY_HIGH, 0, NULL, NULL};
+    rknn_app_ctx.npu_id = npu_sched_register(&desc);
+    if (rknn_app_ctx.npu_id < 0)
+    {
+        rknn_app_ctx.npu_id = 0;
+    }
+
+    infer_backend_t backend;
+    backend.width = rknn_app_ctx.model_width;
+    backend.height = rknn_app_ctx.model_height;
+    backend.channels = rknn_app_ctx.model_channel;
+    backend.run = run_yolov5;
+    backend.arg = &rknn_app_ctx;
+    g_server = create_infer_server(socket_path, &backend);
+    if (g_server != NULL)
+    {
+        signal(SIGINT, handle_signal);
+        signal(SIGTERM, handle_signal);
+        signal(SIGPIPE, SIG_IGN);
+        ret = infer_server_run(g_server);
+        destroy_infer_server(g_server);
+        g_server = NULL;
+    }
+    else
+    {
+        ret = -1;
+    }
+
+    deinit_post_process();
+    release_yolov5_model(&rknn_app_ctx);
+    npu_sched_deinit();
+    return ret;
+}
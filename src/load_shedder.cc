@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "load_shedder.h"
+
+#define LOAD_SHEDDER_EWMA 0.2f
+
+void default_load_shedder_config(load_shedder_config_t *config)
+{
+    config->enable = 1;
+    config->max_latency_ms = 200;
+    config->window = 30;
+    config->overload_ratio = 0.2f;
+    config->headroom_ratio = 0.5f;
+    config->max_rate_divisor = 4;
+    config->resolution_levels = 0;
+}
+
+static void apply_level(load_shedder_t *shedder, int level)
+{
+    load_shedder_stats_t *stats = &shedder->stats;
+    int rate_levels = shedder->config.max_rate_divisor - 1;
+    stats->level = level;
+    stats->rate_divisor = (level < rate_levels ? level : rate_levels) + 1;
+    stats->resolution_level = level > rate_levels ? level - rate_levels : 0;
+}
+
+void init_load_shedder(load_shedder_t *shedder, const load_shedder_config_t *config)
+{
+    memset(shedder, 0, sizeof(load_shedder_t));
+    shedder->config = *config;
+    if (shedder->config.max_rate_divisor < 1)
+    {
+        shedder->config.max_rate_divisor = 1;
+    }
+    if (shedder->config.window < 1)
+    {
+        shedder->config.window = 1;
+    }
+    apply_level(shedder, 0);
+}
+
+static void account(load_shedder_t *shedder, int late, int64_t latency)
+{
+    load_shedder_config_t *config = &shedder->config;
+    load_shedder_stats_t *stats = &shedder->stats;
+    shedder->window_frames++;
+    shedder->window_late += late;
+    if (latency > shedder->window_max_latency)
+    {
+        shedder->window_max_latency = latency;
+    }
+    if (shedder->window_frames < config->window)
+    {
+        return;
+    }
+
+    int max_level = config->max_rate_divisor - 1 + config->resolution_levels;
+    int level = stats->level;
+    float late_ratio = (float)shedder->window_late / shedder->window_frames;
+    if (late_ratio > config->overload_ratio && level < max_level)
+    {
+        level++;
+        stats->step_downs++;
+    }
+    else if (late_ratio == 0 && shedder->window_max_latency < config->max_latency_ms * config->headroom_ratio &&
+             level > 0)
+    {
+        level--;
+        stats->step_ups++;
+    }
+    if (level != stats->level)
+    {
+        int from = stats->level;
+        apply_level(shedder, level);
+        printf("load shedder level %d -> %d rate 1/%d resolution %d late %d/%d max latency %lldms\n", from, level,
+               stats->rate_divisor, stats->resolution_level, shedder->window_late, shedder->window_frames,
+               (long long)shedder->window_max_latency);
+    }
+    printf("load shedder admitted=%llu completed=%llu dropped_late=%llu skipped_rate=%llu missed=%llu "
+           "service=%.1fms latency=%.1fms level=%d\n",
+           (unsigned long long)stats->admitted, (unsigned long long)stats->completed,
+           (unsigned long long)stats->dropped_late, (unsigned long long)stats->skipped_rate,
+           (unsigned long long)stats->missed, stats->avg_service_ms, stats->avg_latency_ms, stats->level);
+    shedder->window_frames = 0;
+    shedder->window_late = 0;
+    shedder->window_max_latency = 0;
+}
+
+int load_shedder_admit(load_shedder_t *shedder, int64_t capture_ms, int64_t now_ms)
+{
+    load_shedder_stats_t *stats = &shedder->stats;
+    if (!shedder->config.enable)
+    {
+        stats->admitted++;
+        return 1;
+    }
+    shedder->frame_count++;
+    if (stats->rate_divisor > 1 && shedder->frame_count % stats->rate_divisor != 0)
+    {
+        stats->skipped_rate++;
+        return 0;
+    }
+    // the result would come after the deadline, the NPU time is better spent on a newer frame
+    int64_t expected = now_ms - capture_ms + (int64_t)stats->avg_service_ms;
+    // a whole window dropped means the service estimate is stale, let one frame through to measure it again
+    if (expected > shedder->config.max_latency_ms && shedder->late_in_row < shedder->config.window)
+    {
+        stats->dropped_late++;
+        shedder->late_in_row++;
+        account(shedder, 1, expected);
+        return 0;
+    }
+    shedder->late_in_row = 0;
+    stats->admitted++;
+    return 1;
+}
+
+void load_shedder_complete(load_shedder_t *shedder, int64_t capture_ms, int64_t admit_ms, int64_t now_ms)
+{
+    load_shedder_stats_t *stats = &shedder->stats;
+    float service = (float)(now_ms - admit_ms);
+    float latency = (float)(now_ms - capture_ms);
+    if (stats->completed == 0)
+    {
+        stats->avg_service_ms = service;
+        stats->avg_latency_ms = latency;
+    }
+    else
+    {
+        stats->avg_service_ms += LOAD_SHEDDER_EWMA * (service - stats->avg_service_ms);
+        stats->avg_latency_ms += LOAD_SHEDDER_EWMA * (latency - stats->avg_latency_ms);
+    }
+    stats->completed++;
+    int late = now_ms - capture_ms > shedder->config.max_latency_ms;
+    stats->missed += late;
+    if (shedder->config.enable)
+    {
+        account(shedder, late, now_ms - capture_ms);
+    }
+}
+
+void load_shedder_get_stats(const load_shedder_t *shedder, load_shedder_stats_t *stats)
+{
+    *stats = shedder->stats;
+}
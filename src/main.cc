@@ -21,10 +21,25 @@
 #include <string.h>
 #include <pthread.h>
 #include <signal.h>
-#include <stack>
+#include <mutex>
 
 #include "preprocess.h"
 #include "yolov5.h"
+#include "frame_pool.h"
+#include "frame_channel.h"
+#include "frame_pyramid.h"
+#include "pipeline_config.h"
+#include "load_shedder.h"
+#include "tracking.h"
+#include "tiled_detect.h"
+#include "roi_detect.h"
+#include "classifier.h"
+#include "infer_client.h"
+#include "model_reload.h"
+#include "model_switch.h"
+#ifdef ENABLE_STREAMING
+#include "streamer.h"
+#endif
 
 extern "C"
 {
@@ -32,6 +47,7 @@ extern "C"
 #include "file_utils.h"
 #include "image_drawing.h"
 #include "v4l2.h"
+#include "motion_detect.h"
 #include <fcntl.h>
 }
 
@@ -54,8 +70,45 @@ static long getCurrentTimeMsec()
 
 rknn_app_context_t rknn_app_ctx;
 v4l2_context_t *v4l2_ctx;
-std::stack<image_buffer_t *> frame_stack;
-static int g_flag_run = 1;
+pipeline_config_t g_config;
+// frames in the pool bound the memory of the whole pipeline
+struct frame_pool_t *frame_pool;
+struct frame_channel_t *detect_channel;
+struct frame_channel_t *encode_channel;
+// boxes of the last inference, drawn on the streamed frames
+std::mutex result_mutex;
+object_detect_result_list latest_results;
+// crops around weak tracks, NULL without tracking redetect
+roi_detector_t *roi_detector;
+// attributes of the detections, NULL without cascade
+struct classifier_t *classifier;
+// model inputs go to rknn_infer_server, NULL: the model runs here
+struct infer_client_t *infer_client;
+// detector models loaded on SIGHUP, NULL with a server
+struct model_reloader_t *reloader;
+// small model under load, NULL without switching
+model_switch_t *model_switch;
+// one pyramid per pool frame, its outputs are the bundle of the frame; NULL: nothing derived at capture
+static frame_pyramid_t *pyramids;
+// bundle outputs, -1: not made; the preview UI reads frame->bundle.images[preview_output]
+static int model_output = -1;
+static int encode_output = -1;
+static int preview_output = -1;
+// shape the capture letterboxes the model input to, and the largest one its buffers take
+static std::mutex bundle_mutex;
+static yolov5_shape_t bundle_shape;
+static yolov5_shape_t bundle_max_shape;
+// crop sizes, the server or the config hold the model input shape, else it follows the source
+static bool input_shape_locked;
+static const char *g_config_path;
+static volatile sig_atomic_t g_reload_requested;
+// cleared on exit, capture leaves its loop and the detector its own
+static volatile int g_flag_run = 1;
+
+static void request_reload(int sig)
+{
+    g_reload_requested = 1;
+}
 
 static void save_image(uint8_t *p, int size, char *path)
 {
@@ -73,145 +126,994 @@ static void save_image(uint8_t *p, int size, char *path)
     close(fd_file);
 }
 
+// the running input shape for the next captures
+static void publish_input_shape()
+{
+    std::lock_guard<std::mutex> lock(bundle_mutex);
+    bundle_shape.width = rknn_app_ctx.model_width;
+    bundle_shape.height = rknn_app_ctx.model_height;
+}
+
+// model input, encoder NV12 and preview thumbnail of every frame come from one pyramid submit
+static int init_capture_pyramids(int count, int width, int height)
+{
+    if (model_output < 0 && encode_channel == NULL && !g_config.preview.enable)
+    {
+        return 0;
+    }
+    pyramids = (frame_pyramid_t *)calloc(count, sizeof(frame_pyramid_t));
+    if (pyramids == NULL)
+    {
+        return -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        init_frame_pyramid(&pyramids[i]);
+    }
+    bool model_input = model_output >= 0;
+    for (int i = 0; i < count; i++)
+    {
+        frame_pyramid_t *pyramid = &pyramids[i];
+        if (model_input)
+        {
+            model_output = frame_pyramid_add_output(pyramid, bundle_max_shape.width, bundle_max_shape.height,
+                                                    IMAGE_FORMAT_RGB888, 1, 114);
+            if (model_output < 0)
+            {
+                return -1;
+            }
+            pyramid->outputs[model_output].plan.num_threads = g_config.preprocess.threads;
+        }
+        if (encode_channel != NULL)
+        {
+            encode_output = frame_pyramid_add_output(pyramid, width, height, IMAGE_FORMAT_YUV420SP_NV12, 0, 0);
+            if (encode_output < 0)
+            {
+                return -1;
+            }
+            pyramid->outputs[encode_output].plan.num_threads = g_config.encode.stage.threads;
+        }
+        if (g_config.preview.enable)
+        {
+            // letterboxed, the thumbnail may have any aspect ratio; 128 pads grey in RGB and NV12 alike
+            preview_output = frame_pyramid_add_output(pyramid, g_config.preview.width, g_config.preview.height,
+                                                      g_config.preview.format, 1, (char)128);
+            if (preview_output < 0)
+            {
+                return -1;
+            }
+            pyramid->outputs[preview_output].plan.num_threads = g_config.preprocess.threads;
+        }
+    }
+    return 0;
+}
+
+static void release_capture_pyramids(int count)
+{
+    for (int i = 0; pyramids != NULL && i < count; i++)
+    {
+        release_frame_pyramid(&pyramids[i]);
+    }
+    free(pyramids);
+    pyramids = NULL;
+}
+
+// the pyramid of a frame is only reused once the frame is back in the pool
+static int make_bundle(frame_t *frame)
+{
+    frame_pyramid_t *pyramid = &pyramids[frame->index];
+    if (model_output >= 0)
+    {
+        yolov5_shape_t shape;
+        {
+            std::lock_guard<std::mutex> lock(bundle_mutex);
+            shape = bundle_shape;
+        }
+        // a shape beyond the buffer keeps the last one, the detector then letterboxes the frame itself
+        frame_pyramid_resize_output(pyramid, model_output, shape.width, shape.height);
+    }
+    int ret = frame_pyramid_submit(pyramid, &frame->img);
+    if (ret == 0)
+    {
+        ret = frame_pyramid_wait(pyramid, &frame->bundle, -1);
+    }
+    return ret;
+}
+
 static void *StartStream(void *arg)
 {
+    source_config_t *source = &g_config.source;
+    int nv12 = source->format == IMAGE_FORMAT_YUV420SP_NV12;
 
     v4l2_ctx = alloc_v4l2_context();
     /*Configure v4l2_context_t*/
-    v4l2_ctx->process_image = [](uint8_t *p, int size, struct timeval) -> _Bool
+    v4l2_ctx->process_image = [](uint8_t *p, int size, struct timeval timestamp) -> _Bool
     {
-        // 这里是lambda函数体，根据需要编写判断逻辑
-        // 返回true或false
-
         // sleep(1);
         // save_image(p, size, "v4l2buffer");
 
-        // printf("size=%d\n",size);size=614400
-        image_buffer_t *image = (image_buffer_t *)malloc(sizeof(rga_buffer_t));
-        memset(image, 0, sizeof(rga_buffer_t));
-        image->width = v4l2_ctx->width;
-        image->height = v4l2_ctx->height;
-        image->format = IMAGE_FORMAT_YUYV_422;
-        memcpy(image->virt_addr, p, size);
-
-        cvtcolor_rga(image, IMAGE_FORMAT_RGB888);
-
-        frame_stack.push(image);
-        printf("frame_stack_size = %d\n", frame_stack.size());
-        if (frame_stack.size() > 10)
+        frame_t *frame = frame_pool_acquire(frame_pool, 0);
+        if (frame == NULL)
+        {
+            // every frame is still held downstream, skip this capture
+            return 1;
+        }
+        memcpy(frame->img.virt_addr, p, size < frame->img.size ? size : frame->img.size);
+        frame->timestamp = timestamp;
+        if (pyramids != NULL && make_bundle(frame) != 0)
         {
-            printf("clear_frame_stack\n");
-            // 清空
-            while (!frame_stack.empty())
-                frame_stack.pop();
+            printf("frame %llu bundle fail, skipped\n", (unsigned long long)frame->seq);
+            frame_unref(frame);
+            return 1;
         }
 
+        // one capture, every branch holds its own reference
+        frame_channel_push(detect_channel, frame, 0);
+        if (encode_channel != NULL)
+        {
+            frame_channel_push(encode_channel, frame, 0);
+        }
+        frame_unref(frame);
         return 1;
     };
     v4l2_ctx->force_format = 1;
-    v4l2_ctx->width = 640;
-    v4l2_ctx->height = 480;
-    v4l2_ctx->pixelformat = V4L2_PIX_FMT_YUYV;
+    v4l2_ctx->width = source->width;
+    v4l2_ctx->height = source->height;
+    v4l2_ctx->pixelformat = nv12 ? V4L2_PIX_FMT_NV12 : V4L2_PIX_FMT_YUYV;
     v4l2_ctx->field = V4L2_FIELD_INTERLACED;
-    v4l2_ctx->open_device((char *)arg, v4l2_ctx);
-    v4l2_ctx->init_device(v4l2_ctx); // 调用init_mmap
-    v4l2_ctx->start_capturing(v4l2_ctx);
-    v4l2_ctx->main_loop(v4l2_ctx);
+    v4l2_ctx->run = &g_flag_run;
+    if (v4l2_ctx->open_device(source->device, v4l2_ctx) != 0)
+    {
+        printf("open %s fail!\n", source->device);
+        free(v4l2_ctx);
+        v4l2_ctx = NULL;
+        goto out;
+    }
+    if (v4l2_ctx->init_device(v4l2_ctx) != 0) // 调用init_mmap
+    {
+        printf("init %s fail!\n", source->device);
+        goto close;
+    }
+    frame_pool = create_frame_pool(source->pool_size, v4l2_ctx->width, v4l2_ctx->height, source->format,
+                                   nv12 ? v4l2_ctx->bytesperline : v4l2_ctx->bytesperline / 2);
+    if (frame_pool == NULL)
+    {
+        printf("create_frame_pool fail!\n");
+        goto close;
+    }
+    if (init_capture_pyramids(source->pool_size, v4l2_ctx->width, v4l2_ctx->height) != 0)
+    {
+        printf("init_capture_pyramids fail!\n");
+        goto close;
+    }
+    if (v4l2_ctx->start_capturing(v4l2_ctx) == 0)
+    {
+        v4l2_ctx->main_loop(v4l2_ctx);
+    }
+close:
     v4l2_ctx->close(v4l2_ctx);
+    v4l2_ctx = NULL;
+out:
+    // nothing is captured anymore, the consumers drain their channels and stop
+    frame_channel_close(detect_channel);
+    if (encode_channel != NULL)
+    {
+        frame_channel_close(encode_channel);
+    }
+    return NULL;
+}
+
+// the detector keeps its NPU priority only while frames wait for it
+static int detector_has_work(void *arg)
+{
+    return detect_channel != NULL && frame_channel_credits(detect_channel) < g_config.inference.stage.queue_depth;
+}
+
+// the overlay draws the results of the last frame done
+static void publish_results(frame_t *frame, void *arg)
+{
+    std::lock_guard<std::mutex> lock(result_mutex);
+    latest_results = frame->results;
+}
+
+// hand the results of an inference to the frame and the overlay
+static int finish_frame(int ret, object_detect_result_list &od_results, const letterbox_t *letterbox, frame_t *frame,
+                        int64_t admit_ms, load_shedder_t *shedder, struct tracker_t *tracker, long start_time)
+{
+    if (ret == 0 && tracker != NULL)
+    {
+        object_detect_result_list roi_results;
+        int have_rois = 0;
+        int roi_width, roi_height;
+        if (roi_detector != NULL &&
+            roi_detector_crop_size(roi_detector, &rknn_app_ctx, frame->img.width, frame->img.height, &roi_width,
+                                   &roi_height) == 0)
+        {
+            image_rect_t rois[OBJ_NUMB_MAX_SIZE];
+            int num_rois = tracker_select_rois(tracker, frame->img.width, frame->img.height, roi_width, roi_height,
+                                               rois, OBJ_NUMB_MAX_SIZE);
+            have_rois = num_rois > 0 &&
+                        detect_rois(roi_detector, &rknn_app_ctx, &frame->img, rois, num_rois, &roi_results) == 0;
+        }
+        tracker_update(tracker, &od_results, have_rois ? &roi_results : NULL);
+    }
+    load_shedder_complete(shedder, frame->capture_ms, admit_ms, frame_clock_ms());
+    frame->results = od_results;
+    frame->letterbox = *letterbox;
+    frame->has_results = ret == 0;
+    if (ret == 0 && classifier != NULL)
+    {
+        // published once its detections are classified
+        classifier_submit(classifier, frame, frame_clock_ms());
+    }
+    else if (ret == 0)
+    {
+        publish_results(frame, NULL);
+    }
+    frame_unref(frame);
+    long end_time = getCurrentTimeMsec();
+    printf("infernece_once=%ldms\n", end_time - start_time);
+    if (ret != 0)
+    {
+        printf("inference_yolov5_input fail! ret=%d\n", ret);
+        return ret;
+    }
+
+    for (int i = 0; i < od_results.count; i++)
+    {
+        object_detect_result *det_result = &(od_results.results[i]);
+        printf("%s #%d @ (%d %d %d %d) %.3f\n", coco_cls_to_name(det_result->cls_id), det_result->track_id,
+               det_result->box.left, det_result->box.top,
+               det_result->box.right, det_result->box.bottom,
+               det_result->prop);
+    }
+    return 0;
+}
+
+// the input already lives in ring slot of the server, only its number is sent
+static int inference_remote(yolov5_input_t *input, int slot, frame_t *frame, object_detect_result_list *od_results)
+{
+    if (rga_job_wait(&input->job, -1) < 0)
+    {
+        printf("letterbox job fail!\n");
+        return -1;
+    }
+    if (infer_client_submit(infer_client, slot, &input->plan.letterbox, frame->seq) != 0)
+    {
+        return -1;
+    }
+    int done_slot;
+    object_detect_result_list *results;
+    if (infer_client_wait(infer_client, -1, &done_slot, NULL, &results) != 0 || done_slot != slot ||
+        infer_client_status(infer_client, slot) != 0)
+    {
+        return -1;
+    }
+    *od_results = *results;
+    return 0;
+}
+
+// the context of the next full frame or tile inference
+static rknn_app_context_t *detector_model()
+{
+    return model_switch != NULL ? model_switch_active(model_switch) : &rknn_app_ctx;
+}
+
+static void account_inference(int ret, long start_time, const object_detect_result_list *od_results)
+{
+    if (model_switch == NULL || ret != 0)
+    {
+        return;
+    }
+    int queued = g_config.inference.stage.queue_depth - frame_channel_credits(detect_channel);
+    model_switch_update(model_switch, (float)(getCurrentTimeMsec() - start_time), queued, od_results->count,
+                        frame_clock_ms());
+}
+
+// run the NPU on a prepared slot
+static int run_input(yolov5_input_t *input, int slot, frame_t *frame, int64_t admit_ms, load_shedder_t *shedder,
+                     struct tracker_t *tracker)
+{
+    object_detect_result_list od_results;
+    long start_time = getCurrentTimeMsec();
+    int ret = infer_client != NULL ? inference_remote(input, slot, frame, &od_results)
+                                   : inference_yolov5_input(detector_model(), input, &od_results);
+    account_inference(ret, start_time, &od_results);
+    return finish_frame(ret, od_results, &input->plan.letterbox, frame, admit_ms, shedder, tracker, start_time);
+}
+
+// run the slot prepared last before anything else touches the model, the shape or the tracker
+static int flush_pending_input(yolov5_input_t *inputs, frame_t **input_frames, int64_t *input_admit_ms,
+                               int *cur_input, bool *input_pending, load_shedder_t *shedder,
+                               struct tracker_t *tracker)
+{
+    *cur_input ^= 1;
+    *input_pending = false;
+    int slot = *cur_input;
+    int ret = run_input(&inputs[slot], slot, input_frames[slot], input_admit_ms[slot], shedder, tracker);
+    input_frames[slot] = NULL;
+    return ret;
+}
+
+// the capture pyramid letterboxed the frame for the running shape, NULL: it has to be done here
+static image_buffer_t *bundle_model_input(frame_t *frame)
+{
+    if (model_output < 0 || frame->bundle.count <= model_output)
+    {
+        return NULL;
+    }
+    image_buffer_t *image = frame->bundle.images[model_output];
+    if (image->width != rknn_app_ctx.model_width || image->height != rknn_app_ctx.model_height ||
+        rknn_app_ctx.model_channel != 3)
+    {
+        return NULL;
+    }
+    return image;
+}
+
+// run the NPU straight on the model input of the frame bundle
+static int run_bundle(frame_t *frame, int64_t admit_ms, load_shedder_t *shedder, struct tracker_t *tracker)
+{
+    yolov5_input_t input;
+    memset(&input, 0, sizeof(yolov5_input_t));
+    input.img = *frame->bundle.images[model_output];
+    input.job.fence_fd = -1;
+    input.job.core = -1;
+    letterbox_t letterbox = frame->bundle.letterbox[model_output];
+    object_detect_result_list od_results;
+    long start_time = getCurrentTimeMsec();
+    int ret = inference_yolov5_input_with_letterbox(detector_model(), &input, &letterbox, &od_results);
+    account_inference(ret, start_time, &od_results);
+    return finish_frame(ret, od_results, &letterbox, frame, admit_ms, shedder, tracker, start_time);
+}
+
+// every tile of the frame, boxes are already in frame coordinates
+static int run_tiled(tiled_detector_t *tiler, frame_t *frame, int64_t admit_ms, load_shedder_t *shedder,
+                     struct tracker_t *tracker)
+{
+    object_detect_result_list od_results;
+    letterbox_t identity = {0, 0, 1.0f};
+    long start_time = getCurrentTimeMsec();
+    int ret = tiled_detect(tiler, detector_model(), &frame->img, &od_results);
+    account_inference(ret, start_time, &od_results);
+    return finish_frame(ret, od_results, &identity, frame, admit_ms, shedder, tracker, start_time);
+}
+
+// frame not sent to the NPU: tracker predictions, or the last detections without tracking
+static void publish_without_inference(frame_t *frame, struct tracker_t *tracker)
+{
+    if (tracker != NULL)
+    {
+        tracker_predict(tracker, &frame->results);
+        std::lock_guard<std::mutex> lock(result_mutex);
+        // a track keeps the attribute of its last classified box
+        for (int i = 0; i < frame->results.count; i++)
+        {
+            object_detect_result *res = &frame->results.results[i];
+            for (int j = 0; j < latest_results.count; j++)
+            {
+                if (latest_results.results[j].track_id == res->track_id)
+                {
+                    res->attr_id = latest_results.results[j].attr_id;
+                    res->attr_prop = latest_results.results[j].attr_prop;
+                    break;
+                }
+            }
+        }
+        latest_results = frame->results;
+    }
+    else
+    {
+        frame->results = latest_results;
+    }
+    frame->has_results = 1;
+    frame_unref(frame);
+}
+
+// the model file and thresholds are read again from the config file
+static void start_reload()
+{
+    static pipeline_config_t config;
+    config = g_config;
+    if (g_config_path != NULL && load_pipeline_config(g_config_path, &config) != 0)
+    {
+        printf("reload %s fail, the running model is kept\n", g_config_path);
+        return;
+    }
+    // a model sharing the internal memory of the switch is loaded the same way
+    model_reloader_request(reloader, config.inference.model_path, config.inference.box_threshold,
+                           config.inference.nms_threshold, config.inference.float_outputs, rknn_app_ctx.init_flags);
+}
+
+// no slot may be prepared on the running shape, inputs NULL: not allocated yet
+static int apply_input_shape(const yolov5_shape_t *shape, yolov5_input_t *inputs)
+{
+    int width = rknn_app_ctx.model_width;
+    int height = rknn_app_ctx.model_height;
+    if (set_yolov5_input_shape(&rknn_app_ctx, shape->width, shape->height) != 0)
+    {
+        return -1;
+    }
+    if (model_switch != NULL && set_yolov5_input_shape(&model_switch->small, shape->width, shape->height) != 0)
+    {
+        // both models take the same frames
+        set_yolov5_input_shape(&rknn_app_ctx, width, height);
+        return -1;
+    }
+    for (int i = 0; inputs != NULL && i < 2; i++)
+    {
+        resize_yolov5_input(&rknn_app_ctx, &inputs[i]);
+    }
+    publish_input_shape();
+    return 0;
+}
+
+// between two frames, no slot is prepared for the running model anymore
+static int swap_model(rknn_app_context_t *next, yolov5_input_t *inputs)
+{
+    if (next->num_shapes > 1)
+    {
+        // a dynamic shape model goes on at the running shape when it has it
+        set_yolov5_input_shape(next, rknn_app_ctx.model_width, rknn_app_ctx.model_height);
+    }
+    bool resized = next->model_width != rknn_app_ctx.model_width || next->model_height != rknn_app_ctx.model_height ||
+                   next->model_channel != rknn_app_ctx.model_channel;
+    if (resized && (roi_detector != NULL || g_config.tiling.enable || model_switch != NULL))
+    {
+        // their crops and plans are sized after the running model, as is the small model
+        printf("new model input %dx%d differs, kept %dx%d for tiling, redetect and switching\n", next->model_width,
+               next->model_height, rknn_app_ctx.model_width, rknn_app_ctx.model_height);
+        model_reloader_retire(reloader, next);
+        return 0;
+    }
+    if (model_switch != NULL && model_switch_attach(model_switch, next) != 0)
+    {
+        printf("new model %s not swapped in, %s kept\n", next->model_path, g_config.inference.model_path);
+        model_reloader_retire(reloader, next);
+        return 0;
+    }
+
+    snprintf(g_config.inference.model_path, PIPELINE_PATH_MAX, "%s", next->model_path);
+    next->model_path = g_config.inference.model_path;
+    next->npu_id = rknn_app_ctx.npu_id;
+    // the slots also take the largest shape of the new model
+    bool realloc = resized || next->num_shapes > 1;
+    rknn_app_context_t old = rknn_app_ctx;
+    rknn_app_ctx = *next;
+    for (int i = 0; realloc && i < 2; i++)
+    {
+        int num_threads = inputs[i].plan.num_threads;
+        release_yolov5_input(&inputs[i]);
+        if (init_yolov5_input(&rknn_app_ctx, &inputs[i]) != 0)
+        {
+            model_reloader_retire(reloader, &old);
+            return -1;
+        }
+        inputs[i].plan.num_threads = num_threads;
+    }
+    model_reloader_retire(reloader, &old);
+    publish_input_shape();
+    printf("model %s swapped in\n", g_config.inference.model_path);
+    return 0;
 }
 
+// the large model alone, or with the small one when switching
+static int init_detector_model()
+{
+    if (g_config.switching.enable)
+    {
+        model_switch = (model_switch_t *)malloc(sizeof(model_switch_t));
+        if (model_switch != NULL && init_model_switch(model_switch, &g_config.switching, &rknn_app_ctx) == 0)
+        {
+            return 0;
+        }
+        printf("init_model_switch fail, %s only\n", rknn_app_ctx.model_path);
+        free(model_switch);
+        model_switch = NULL;
+    }
+    return init_yolov5_model(&rknn_app_ctx);
+}
+
+#ifdef ENABLE_STREAMING
+static void draw_latest_results(image_buffer_t *image)
+{
+    object_detect_result_list results;
+    {
+        std::lock_guard<std::mutex> lock(result_mutex);
+        results = latest_results;
+    }
+    for (int i = 0; i < results.count; i++)
+    {
+        image_rect_t *box = &results.results[i].box;
+        draw_rectangle(image, box->left, box->top, box->right - box->left, box->bottom - box->top, COLOR_BLUE, 3);
+    }
+}
+
+static void *StartEncode(void *arg)
+{
+    encode_config_t *encode = &g_config.encode;
+    StreamerContext streamer;
+    bool started = false;
+    memset(&streamer, 0, sizeof(StreamerContext));
+
+    frame_t *frame;
+    while ((frame = frame_channel_pop(encode_channel, -1)) != NULL)
+    {
+        // NV12 at the capture size, made with the model input by the capture pyramid
+        image_buffer_t *image = frame->bundle.images[encode_output];
+        if (!started)
+        {
+            if (init_streamer(&streamer, encode->url, image->width, image->height, get_image_width_stride(image),
+                              image->height, encode->fps, encode->gop, encode->bitrate) != 0)
+            {
+                printf("start streaming to %s fail!\n", encode->url);
+                frame_unref(frame);
+                break;
+            }
+            started = true;
+        }
+
+        if (encode->overlay)
+        {
+            draw_latest_results(image);
+        }
+        int ret = streamer_push_frame(&streamer, image->virt_addr, image->size);
+        frame_unref(frame);
+        if (ret != 0)
+        {
+            break;
+        }
+    }
+    // nothing reads the channel anymore, let capture release its frames
+    frame_channel_close(encode_channel);
+    release_streamer(&streamer);
+    return NULL;
+}
+#endif
+
 /*-------------------------------------------
                   Main Function
 -------------------------------------------*/
 int main(int argc, char **argv)
 {
-    if (argc != 3)
+    if (argc < 2 || argc > 4)
     {
-        printf("%s <model_path> <dev_path>\n", argv[0]);
+        printf("%s <config.ini>\n", argv[0]);
+        printf("%s <model_path> <dev_path> [rtmp_url]\n", argv[0]);
         return -1;
     }
 
-    const char *model_path = argv[1];
-    const char *dev_path = argv[2];
+    default_pipeline_config(&g_config);
+    if (argc == 2)
+    {
+        g_config_path = argv[1];
+        if (load_pipeline_config(argv[1], &g_config) != 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        snprintf(g_config.inference.model_path, PIPELINE_PATH_MAX, "%s", argv[1]);
+        snprintf(g_config.source.device, PIPELINE_PATH_MAX, "%s", argv[2]);
+        if (argc == 4)
+        {
+            snprintf(g_config.encode.url, PIPELINE_PATH_MAX, "%s", argv[3]);
+        }
+    }
+    dump_pipeline_config(&g_config);
+    const char *model_path = g_config.inference.model_path;
 
     int ret = 0;
+    // two input slots: the RGA letterboxes the next frame while the NPU runs the current one
+    yolov5_input_t inputs[2];
+    frame_t *input_frames[2] = {NULL, NULL};
+    int64_t input_admit_ms[2] = {0, 0};
+    load_shedder_t shedder;
+    motion_detector_t motion;
+    struct tracker_t *tracker = NULL;
+    tiled_detector_t *tiler = NULL;
+    uint64_t motion_skipped = 0;
+    int cur_input = 0;
+    bool input_pending = false;
+    // only threads that were started are joined on the way out
+    pthread_t read_thread;
+    pthread_t encode_thread;
+    bool read_started = false;
+    bool encode_started = false;
+    memset(inputs, 0, sizeof(inputs));
+    inputs[0].job.fence_fd = -1;
+    inputs[1].job.fence_fd = -1;
 
     memset(&rknn_app_ctx, 0, sizeof(rknn_app_context_t));
+    init_motion_detector(&motion, &g_config.motion);
 
-    init_post_process();
+    npu_sched_init(g_config.npu.slots, g_config.npu.report_sec);
+    init_post_process(g_config.inference.label_path);
     rknn_app_ctx.model_path = model_path;
-    ret = init_yolov5_model(&rknn_app_ctx);
-    if (ret != 0)
+    rknn_app_ctx.box_threshold = g_config.inference.box_threshold;
+    rknn_app_ctx.nms_threshold = g_config.inference.nms_threshold;
+    rknn_app_ctx.float_outputs = g_config.inference.float_outputs;
+    if (g_config.inference.record_path[0] != '\0')
+    {
+        rknn_app_ctx.record_path = g_config.inference.record_path;
+    }
+    if (g_config.inference.server[0] != '\0')
+    {
+        // one slot per model input of the pipeline
+        infer_client = infer_client_connect(g_config.inference.server, 2);
+        if (infer_client == NULL)
+        {
+            goto out;
+        }
+        infer_client_model_size(infer_client, &rknn_app_ctx.model_width, &rknn_app_ctx.model_height,
+                                &rknn_app_ctx.model_channel);
+        if (g_config.tiling.enable || g_config.tracking.redetect || g_config.cascade.enable)
+        {
+            printf("tiling, redetect and cascade need the model in process, disabled with %s\n",
+                   g_config.inference.server);
+            g_config.tiling.enable = 0;
+            g_config.tracking.redetect = 0;
+            g_config.cascade.enable = 0;
+        }
+    }
+    else if ((ret = init_detector_model()) != 0)
     {
         printf("init_yolov5_model fail! ret=%d model_path=%s\n", ret, model_path);
         goto out;
     }
+    else
+    {
+        npu_model_desc_t desc = {"detector", g_config.npu.detector_priority, 0, detector_has_work, NULL};
+        rknn_app_ctx.npu_id = npu_sched_register(&desc);
+        if (rknn_app_ctx.npu_id < 0)
+        {
+            rknn_app_ctx.npu_id = 0;
+        }
+        if (model_switch != NULL)
+        {
+            model_switch->small.npu_id = rknn_app_ctx.npu_id;
+        }
+        reloader = create_model_reloader(g_config.inference.reload_warmup);
+        signal(SIGHUP, request_reload);
+        if (g_config.inference.input_width > 0)
+        {
+            yolov5_shape_t shape = {g_config.inference.input_width, g_config.inference.input_height};
+            if (apply_input_shape(&shape, NULL) != 0)
+            {
+                printf("input shape %dx%d not applied, %dx%d kept\n", shape.width, shape.height,
+                       rknn_app_ctx.model_width, rknn_app_ctx.model_height);
+            }
+            input_shape_locked = true;
+        }
+    }
 
     // image_buffer_t src_image;
     // memset(&src_image, 0, sizeof(image_buffer_t));
     // ret = read_image(image_path, &src_image);
-    pthread_t read_thread;
-    pthread_create(&read_thread, NULL, StartStream, (void *)dev_path);
-    object_detect_result_list od_results;
-    while (g_flag_run)
+    if (g_config.tracking.enable)
     {
-        if (frame_stack.empty())
+        tracker = create_tracker(&g_config.tracking, g_config.encode.fps > 0 ? g_config.encode.fps : 30);
+    }
+
+    if (g_config.cascade.enable)
+    {
+        classifier = create_classifier(&g_config.cascade, publish_results, NULL);
+        if (classifier == NULL)
         {
-            continue;
+            printf("create_classifier fail, cascade disabled\n");
         }
-        else
+    }
+    if (tracker != NULL && g_config.tracking.redetect)
+    {
+        roi_detector = (roi_detector_t *)malloc(sizeof(roi_detector_t));
+        if (roi_detector == NULL || init_roi_detector(roi_detector, &rknn_app_ctx, g_config.preprocess.threads) != 0)
         {
-            long start_time = getCurrentTimeMsec();
-            image_buffer_t *src_img = frame_stack.top();
-            frame_stack.pop();
-
-            // uint8_t *rgb_buffer = (uint8_t *)malloc(v4l2_ctx->width * v4l2_ctx->height * 3);
+            printf("init_roi_detector fail, redetect disabled\n");
+            free(roi_detector);
+            roi_detector = NULL;
+        }
+    }
+    if (g_config.tiling.enable)
+    {
+        tiler = (tiled_detector_t *)malloc(sizeof(tiled_detector_t));
+        if (tiler == NULL || init_tiled_detector(tiler, &rknn_app_ctx, &g_config.tiling, g_config.preprocess.threads) != 0)
+        {
+            printf("init_tiled_detector fail, detect on the whole frame\n");
+            free(tiler);
+            tiler = NULL;
+        }
+    }
 
-            // yuyv_to_rgb(src_img.buf, rgb_buffer, src_img.img_width, src_img.img_height);
-            // save_image(rgb_buffer,src_img.img_width * src_img.img_height * 3, "rgb_buffer");
-            // int rga_buffer_model_input_size = rknn_app_ctx.model_width * rknn_app_ctx.model_height * get_bpp_from_format(RK_FORMAT_RGB_888);
+    detect_channel = create_frame_channel("detect", g_config.inference.stage.queue_depth, g_config.inference.stage.policy);
+    if (detect_channel == NULL)
+    {
+        printf("create_frame_channel fail!\n");
+        goto out;
+    }
+    if (g_config.encode.enable && g_config.encode.url[0] != '\0')
+    {
+#ifdef ENABLE_STREAMING
+        encode_channel = create_frame_channel("encode", g_config.encode.stage.queue_depth, g_config.encode.stage.policy);
+        encode_started = pthread_create(&encode_thread, NULL, StartEncode, NULL) == 0;
+#else
+        printf("built without ENABLE_STREAMING, %s ignored\n", g_config.encode.url);
+#endif
+    }
+    if (infer_client == NULL && tiler == NULL)
+    {
+        // the full frame letterbox comes with the capture, the ring and tiles are still filled here
+        model_output = 0;
+        bundle_max_shape.width = rknn_app_ctx.model_width;
+        bundle_max_shape.height = rknn_app_ctx.model_height;
+        for (int i = 0; i < rknn_app_ctx.num_shapes; i++)
+        {
+            yolov5_shape_t *shape = &rknn_app_ctx.shapes[i];
+            if (shape->width * shape->height > bundle_max_shape.width * bundle_max_shape.height)
+            {
+                bundle_max_shape = *shape;
+            }
+        }
+        publish_input_shape();
+    }
+    read_started = pthread_create(&read_thread, NULL, StartStream, NULL) == 0;
+    for (int i = 0; i < 2; i++)
+    {
+        if (infer_client != NULL)
+        {
+            // written by the RGA straight into the shared ring
+            memset(&inputs[i], 0, sizeof(yolov5_input_t));
+            inputs[i].job.fence_fd = -1;
+            inputs[i].job.core = -1;
+            infer_client_slot_image(infer_client, i, &inputs[i].img);
+        }
+        else
+        {
+            init_yolov5_input(&rknn_app_ctx, &inputs[i]);
+        }
+    }
+    inputs[0].plan.num_threads = g_config.preprocess.threads;
+    inputs[1].plan.num_threads = g_config.preprocess.threads;
+    if (infer_client != NULL || tiler != NULL || roi_detector != NULL)
+    {
+        input_shape_locked = true;
+    }
+    init_load_shedder(&shedder, &g_config.shedder);
+    while (g_flag_run)
+    {
+        if (g_reload_requested)
+        {
+            g_reload_requested = 0;
+            if (reloader != NULL)
+            {
+                start_reload();
+            }
+        }
+        rknn_app_context_t next_model;
+        if (reloader != NULL && model_reloader_take(reloader, &next_model))
+        {
+            if (input_pending)
+            {
+                // the prepared slot runs on the model it was letterboxed for
+                ret = flush_pending_input(inputs, input_frames, input_admit_ms, &cur_input, &input_pending, &shedder,
+                                          tracker);
+                if (ret != 0)
+                {
+                    model_reloader_retire(reloader, &next_model);
+                    goto out;
+                }
+            }
+            if (swap_model(&next_model, inputs) != 0)
+            {
+                goto out;
+            }
+        }
 
-            // uint8_t *rga_buffer_model_input = (uint8_t *)malloc(rga_buffer_model_input_size);
+        // a prepared slot must not wait for the next capture, only poll then
+        int timeout_ms = input_pending ? 0 : -1;
+        if (classifier != NULL)
+        {
+            // nor a partial classifier batch past its deadline
+            int wait_ms = classifier_wait_ms(classifier, frame_clock_ms());
+            if (wait_ms >= 0 && (timeout_ms < 0 || wait_ms < timeout_ms))
+            {
+                timeout_ms = wait_ms;
+            }
+            classifier_poll(classifier, frame_clock_ms());
+        }
+        frame_t *frame = frame_channel_pop(detect_channel, timeout_ms);
+        if (frame == NULL && !input_pending)
+        {
+            if (classifier != NULL && classifier_wait_ms(classifier, frame_clock_ms()) >= 0)
+            {
+                continue;
+            }
+            break;
+        }
+        if (frame == NULL)
+        {
+            // nothing new to overlap with, run the slot prepared last
+            ret = flush_pending_input(inputs, input_frames, input_admit_ms, &cur_input, &input_pending, &shedder,
+                                      tracker);
+            if (ret != 0)
+            {
+                goto out;
+            }
+            continue;
+        }
 
-            // rgb24_resize(rgb_buffer, rga_buffer_model_input, src_img.img_width, src_img.img_height, rknn_app_ctx.model_width, rknn_app_ctx.model_height);
+        // static scene: the last detections still hold
+        bool detect = motion_detect(&motion, &frame->img) != 0;
+        if (!detect && ++motion_skipped % 100 == 0)
+        {
+            printf("motion gate skipped %llu frames\n", (unsigned long long)motion_skipped);
+        }
+        if (detect && tracker != NULL)
+        {
+            detect = tracker_want_detection(tracker) != 0;
+        }
+        int64_t now_ms = frame_clock_ms();
+        if (detect && !load_shedder_admit(&shedder, frame->capture_ms, now_ms))
+        {
+            detect = false;
+        }
+        if (!detect)
+        {
+            if (tracker != NULL && input_pending)
+            {
+                // the tracker takes frames in capture order, the prepared one goes first
+                ret = flush_pending_input(inputs, input_frames, input_admit_ms, &cur_input, &input_pending, &shedder,
+                                          tracker);
+                if (ret != 0)
+                {
+                    frame_unref(frame);
+                    goto out;
+                }
+            }
+            publish_without_inference(frame, tracker);
+            continue;
+        }
 
-            ret = inference_yolov5_model(&rknn_app_ctx, src_img, &od_results);
-            long end_time = getCurrentTimeMsec();
-            printf("infernece_once=%ldms\n", end_time - start_time);
+        if (tiler != NULL)
+        {
+            // tiles pipeline among themselves, frames run one after the other
+            ret = run_tiled(tiler, frame, now_ms, &shedder, tracker);
             if (ret != 0)
             {
-                printf("init_yolov5_model fail! ret=%d\n", ret);
                 goto out;
             }
+            continue;
+        }
 
-            // 画框和概率
-            char text[256];
-            for (int i = 0; i < od_results.count; i++)
+        yolov5_shape_t shape;
+        if (!input_shape_locked && rknn_app_ctx.num_shapes > 1 &&
+            pick_yolov5_input_shape(&rknn_app_ctx, frame->img.width, frame->img.height,
+                                    shedder.stats.resolution_level, &shape) == 0 &&
+            (shape.width != rknn_app_ctx.model_width || shape.height != rknn_app_ctx.model_height))
+        {
+            if (input_pending)
             {
-                object_detect_result *det_result = &(od_results.results[i]);
-                printf("%s @ (%d %d %d %d) %.3f\n", coco_cls_to_name(det_result->cls_id),
-                       det_result->box.left, det_result->box.top,
-                       det_result->box.right, det_result->box.bottom,
-                       det_result->prop);
-                // int x1 = det_result->box.left;
-                // int y1 = det_result->box.top;
-                // int x2 = det_result->box.right;
-                // int y2 = det_result->box.bottom;
-
-                // draw_rectangle(&src_image, x1, y1, x2 - x1, y2 - y1, COLOR_BLUE, 3);
+                // the prepared slot runs on the shape it was letterboxed for
+                ret = flush_pending_input(inputs, input_frames, input_admit_ms, &cur_input, &input_pending, &shedder,
+                                          tracker);
+                if (ret != 0)
+                {
+                    frame_unref(frame);
+                    goto out;
+                }
+            }
+            if (apply_input_shape(&shape, inputs) != 0)
+            {
+                printf("input shape %dx%d not applied, %dx%d kept\n", shape.width, shape.height,
+                       rknn_app_ctx.model_width, rknn_app_ctx.model_height);
+                input_shape_locked = true;
+            }
+        }
 
-                // sprintf(text, "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
-                // draw_text(&src_image, text, x1, y1 - 20, COLOR_RED, 10);
+        if (bundle_model_input(frame) != NULL)
+        {
+            if (input_pending)
+            {
+                // frames run in capture order, the prepared one goes first
+                ret = flush_pending_input(inputs, input_frames, input_admit_ms, &cur_input, &input_pending, &shedder,
+                                          tracker);
+                if (ret != 0)
+                {
+                    frame_unref(frame);
+                    goto out;
+                }
+            }
+            ret = run_bundle(frame, now_ms, &shedder, tracker);
+            if (ret != 0)
+            {
+                goto out;
             }
+            continue;
+        }
+
+        // the frame stays referenced until the RGA has read it and the results are attached
+        ret = prepare_yolov5_input(&rknn_app_ctx, &frame->img, &inputs[cur_input]);
+        if (ret != 0)
+        {
+            frame_unref(frame);
+            continue;
+        }
+        input_frames[cur_input] = frame;
+        input_admit_ms[cur_input] = now_ms;
+        cur_input ^= 1;
+        if (!input_pending)
+        {
+            input_pending = true;
+            continue;
+        }
+
+        ret = run_input(&inputs[cur_input], cur_input, input_frames[cur_input], input_admit_ms[cur_input], &shedder, tracker);
+        input_frames[cur_input] = NULL;
+        if (ret != 0)
+        {
+            goto out;
         }
     }
 out:
+    if (infer_client != NULL)
+    {
+        // ring memory, unmapped with the client
+        inputs[0].img.virt_addr = NULL;
+        inputs[1].img.virt_addr = NULL;
+    }
+    release_yolov5_input(&inputs[0]);
+    release_yolov5_input(&inputs[1]);
+    release_motion_detector(&motion);
+    destroy_tracker(tracker);
+    destroy_classifier(classifier);
+    destroy_model_reloader(reloader);
+    if (roi_detector != NULL)
+    {
+        release_roi_detector(roi_detector);
+        free(roi_detector);
+    }
+    if (tiler != NULL)
+    {
+        release_tiled_detector(tiler);
+        free(tiler);
+    }
+    frame_unref(input_frames[0]);
+    frame_unref(input_frames[1]);
     deinit_post_process();
-    pthread_join(read_thread, NULL);
+    // capture leaves its loop within a select timeout, the encoder once its channel is drained
+    g_flag_run = 0;
+    if (detect_channel != NULL)
+    {
+        frame_channel_close(detect_channel);
+    }
+    if (encode_channel != NULL)
+    {
+        frame_channel_close(encode_channel);
+    }
+    if (encode_started)
+    {
+        pthread_join(encode_thread, NULL);
+    }
+    if (read_started)
+    {
+        pthread_join(read_thread, NULL);
+    }
+    destroy_frame_channel(detect_channel);
+    destroy_frame_channel(encode_channel);
+    release_capture_pyramids(g_config.source.pool_size);
+    destroy_frame_pool(frame_pool);
     ret = release_yolov5_model(&rknn_app_ctx);
     if (ret != 0)
     {
         printf("release_yolov5_model fail! ret=%d\n", ret);
     }
+    if (model_switch != NULL)
+    {
+        // owns the internal memory the large model ran on
+        release_model_switch(model_switch);
+        free(model_switch);
+    }
+    infer_client_close(infer_client);
+    npu_sched_deinit();
     return 0;
 }
@@ -0,0 +1,255 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "frame_pool.h"
+#include "model_reload.h"
+#include "npu_scheduler.h"
+
+// a warm up run waits that long at most for the pipeline to leave the NPU
+#define WARMUP_MAX_YIELD_MS 50
+
+struct model_reloader_t {
+    std::mutex mutex;
+    std::condition_variable cond;
+    pthread_t thread;
+    bool stop;
+    int warmup_runs;
+    int npu_id;
+
+    // one load at a time: requested, then loading, then ready until taken
+    bool requested;
+    bool loading;
+    bool ready;
+    char model_path[MODEL_RELOAD_PATH_MAX];
+    float box_threshold;
+    float nms_threshold;
+    int float_outputs;
+    uint32_t init_flags;
+    rknn_app_context_t next;
+    std::vector<rknn_app_context_t> retired;
+};
+
+static int warmup(struct model_reloader_t *reloader, rknn_app_context_t *app_ctx)
+{
+    yolov5_input_t input;
+    if (init_yolov5_input(app_ctx, &input) != 0)
+    {
+        return -1;
+    }
+    input.job.core = -1;
+    // letterbox gray, what the border of every real frame looks like
+    memset(input.img.virt_addr, 114, input.img.size);
+    letterbox_t letterbox = {0, 0, 1.0f};
+    int ret = 0;
+    for (int i = 0; i < reloader->warmup_runs && ret == 0; i++)
+    {
+        int64_t start_ms = frame_clock_ms();
+        while (npu_sched_should_yield(reloader->npu_id) && frame_clock_ms() - start_ms < WARMUP_MAX_YIELD_MS)
+        {
+            usleep(1000);
+        }
+        object_detect_result_list results;
+        int64_t run_ms = frame_clock_ms();
+        ret = inference_yolov5_input_with_letterbox(app_ctx, &input, &letterbox, &results) < 0 ? -1 : 0;
+        printf("model warm up %d/%d %lldms\n", i + 1, reloader->warmup_runs,
+               (long long)(frame_clock_ms() - run_ms));
+    }
+    release_yolov5_input(&input);
+    return ret;
+}
+
+// a context of shared internal memory gets its own for the warm up, until the shared one is attached
+static int alloc_warmup_mem(rknn_app_context_t *app_ctx)
+{
+    rknn_mem_size mem_size;
+    memset(&mem_size, 0, sizeof(mem_size));
+    int ret = rknn_query(app_ctx->rknn_ctx, RKNN_QUERY_MEM_SIZE, &mem_size, sizeof(mem_size));
+    if (ret != RKNN_SUCC)
+    {
+        printf("rknn_query mem size fail! ret=%d\n", ret);
+        return -1;
+    }
+    app_ctx->own_internal_mem = rknn_create_mem(app_ctx->rknn_ctx, mem_size.total_internal_size);
+    if (app_ctx->own_internal_mem == NULL)
+    {
+        printf("rknn_create_mem size %u fail!\n", mem_size.total_internal_size);
+        return -1;
+    }
+    if (rknn_set_internal_mem(app_ctx->rknn_ctx, app_ctx->own_internal_mem) != RKNN_SUCC)
+    {
+        printf("rknn_set_internal_mem fail!\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void *reload_thread(void *arg)
+{
+    struct model_reloader_t *reloader = (struct model_reloader_t *)arg;
+    std::unique_lock<std::mutex> lock(reloader->mutex);
+    while (true)
+    {
+        reloader->cond.wait(lock, [reloader] {
+            return reloader->stop || reloader->requested || !reloader->retired.empty();
+        });
+
+        // the old contexts go first, their memory is what the new one needs
+        while (!reloader->retired.empty())
+        {
+            rknn_app_context_t old = reloader->retired.back();
+            reloader->retired.pop_back();
+            lock.unlock();
+            release_yolov5_model(&old);
+            lock.lock();
+        }
+        if (reloader->stop)
+        {
+            break;
+        }
+        if (!reloader->requested)
+        {
+            continue;
+        }
+        reloader->requested = false;
+        reloader->loading = true;
+        rknn_app_context_t app_ctx;
+        memset(&app_ctx, 0, sizeof(rknn_app_context_t));
+        app_ctx.model_path = reloader->model_path;
+        app_ctx.box_threshold = reloader->box_threshold;
+        app_ctx.nms_threshold = reloader->nms_threshold;
+        app_ctx.float_outputs = reloader->float_outputs;
+        app_ctx.init_flags = reloader->init_flags;
+        app_ctx.npu_id = reloader->npu_id;
+        lock.unlock();
+
+        int64_t start_ms = frame_clock_ms();
+        int ret = init_yolov5_model(&app_ctx);
+        // the shared internal memory is busy with the running models, the warm up runs on a copy
+        if (ret == 0 && (app_ctx.init_flags & RKNN_FLAG_MEM_ALLOC_OUTSIDE))
+        {
+            ret = alloc_warmup_mem(&app_ctx);
+        }
+        if (ret == 0)
+        {
+            ret = warmup(reloader, &app_ctx);
+        }
+        if (ret != 0)
+        {
+            printf("reload %s fail, the running model is kept\n", app_ctx.model_path);
+            release_yolov5_model(&app_ctx);
+        }
+        else
+        {
+            printf("model %s ready in %lldms\n", app_ctx.model_path, (long long)(frame_clock_ms() - start_ms));
+        }
+
+        lock.lock();
+        reloader->loading = false;
+        if (ret == 0)
+        {
+            reloader->next = app_ctx;
+            reloader->ready = true;
+        }
+    }
+    return NULL;
+}
+
+struct model_reloader_t *create_model_reloader(int warmup_runs)
+{
+    model_reloader_t *reloader = new model_reloader_t();
+    reloader->stop = false;
+    reloader->warmup_runs = warmup_runs;
+    reloader->requested = false;
+    reloader->loading = false;
+    reloader->ready = false;
+    memset(&reloader->next, 0, sizeof(rknn_app_context_t));
+    npu_model_desc_t desc = {"reload", NPU_PRIORITY_LOW, 0, NULL, NULL};
+    reloader->npu_id = npu_sched_register(&desc);
+    if (reloader->npu_id < 0)
+    {
+        reloader->npu_id = 0;
+    }
+    if (pthread_create(&reloader->thread, NULL, reload_thread, reloader) != 0)
+    {
+        printf("model reload thread create fail\n");
+        delete reloader;
+        return NULL;
+    }
+    return reloader;
+}
+
+void destroy_model_reloader(struct model_reloader_t *reloader)
+{
+    if (reloader == NULL)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(reloader->mutex);
+        reloader->stop = true;
+    }
+    reloader->cond.notify_one();
+    // a load in progress is finished first
+    pthread_join(reloader->thread, NULL);
+    for (size_t i = 0; i < reloader->retired.size(); i++)
+    {
+        release_yolov5_model(&reloader->retired[i]);
+    }
+    if (reloader->ready)
+    {
+        release_yolov5_model(&reloader->next);
+    }
+    delete reloader;
+}
+
+int model_reloader_request(struct model_reloader_t *reloader, const char *model_path, float box_threshold,
+                           float nms_threshold, int float_outputs, uint32_t init_flags)
+{
+    {
+        std::lock_guard<std::mutex> lock(reloader->mutex);
+        if (reloader->requested || reloader->loading || reloader->ready)
+        {
+            printf("model reload already in progress\n");
+            return -1;
+        }
+        snprintf(reloader->model_path, MODEL_RELOAD_PATH_MAX, "%s", model_path);
+        reloader->box_threshold = box_threshold;
+        reloader->nms_threshold = nms_threshold;
+        reloader->float_outputs = float_outputs;
+        reloader->init_flags = init_flags;
+        reloader->requested = true;
+    }
+    printf("reload model %s\n", model_path);
+    reloader->cond.notify_one();
+    return 0;
+}
+
+int model_reloader_take(struct model_reloader_t *reloader, rknn_app_context_t *app_ctx)
+{
+    std::lock_guard<std::mutex> lock(reloader->mutex);
+    if (!reloader->ready)
+    {
+        return 0;
+    }
+    *app_ctx = reloader->next;
+    memset(&reloader->next, 0, sizeof(rknn_app_context_t));
+    reloader->ready = false;
+    return 1;
+}
+
+void model_reloader_retire(struct model_reloader_t *reloader, rknn_app_context_t *app_ctx)
+{
+    {
+        std::lock_guard<std::mutex> lock(reloader->mutex);
+        reloader->retired.push_back(*app_ctx);
+    }
+    memset(app_ctx, 0, sizeof(rknn_app_context_t));
+    reloader->cond.notify_one();
+}
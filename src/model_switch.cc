@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "model_switch.h"
+
+#define MODEL_SWITCH_EWMA 0.2f
+
+void default_model_switch_config(model_switch_config_t *config)
+{
+    memset(config, 0, sizeof(model_switch_config_t));
+    config->enable = 0;
+    snprintf(config->small_model_path, MODEL_SWITCH_PATH_MAX, "./model/yolov5n.rknn");
+    config->high_util = 0.9f;
+    config->low_util = 0.6f;
+    config->queue_ratio = 0.5f;
+    config->complex_detections = 20;
+    config->min_dwell_ms = 5000;
+    config->window_ms = 1000;
+    config->share_memory = 1;
+}
+
+static int internal_size(rknn_app_context_t *app_ctx, uint32_t *size)
+{
+    rknn_mem_size mem_size;
+    memset(&mem_size, 0, sizeof(mem_size));
+    int ret = rknn_query(app_ctx->rknn_ctx, RKNN_QUERY_MEM_SIZE, &mem_size, sizeof(mem_size));
+    if (ret != RKNN_SUCC)
+    {
+        printf("rknn_query mem size fail! ret=%d\n", ret);
+        return -1;
+    }
+    *size = mem_size.total_internal_size;
+    return 0;
+}
+
+// one internal memory of the larger size, created with the small context that lives as long as the switch
+static int share_internal_mem(model_switch_t *sw)
+{
+    uint32_t large_size, small_size;
+    if (internal_size(sw->large, &large_size) != 0 || internal_size(&sw->small, &small_size) != 0)
+    {
+        return -1;
+    }
+    uint32_t size = large_size > small_size ? large_size : small_size;
+    sw->internal_mem = rknn_create_mem(sw->small.rknn_ctx, size);
+    if (sw->internal_mem == NULL)
+    {
+        printf("rknn_create_mem size %u fail!\n", size);
+        return -1;
+    }
+    if (rknn_set_internal_mem(sw->large->rknn_ctx, sw->internal_mem) != RKNN_SUCC ||
+        rknn_set_internal_mem(sw->small.rknn_ctx, sw->internal_mem) != RKNN_SUCC)
+    {
+        printf("rknn_set_internal_mem fail!\n");
+        return -1;
+    }
+    printf("model switch internal memory %u bytes shared, %u + %u apart\n", size, large_size, small_size);
+    return 0;
+}
+
+int init_model_switch(model_switch_t *sw, const model_switch_config_t *config, rknn_app_context_t *large)
+{
+    memset(sw, 0, sizeof(model_switch_t));
+    sw->config = *config;
+    sw->large = large;
+    sw->small.model_path = sw->config.small_model_path;
+    sw->small.box_threshold = large->box_threshold;
+    sw->small.nms_threshold = large->nms_threshold;
+    sw->small.float_outputs = large->float_outputs;
+    uint32_t flags = config->share_memory ? RKNN_FLAG_MEM_ALLOC_OUTSIDE : 0;
+    large->init_flags = flags;
+    sw->small.init_flags = flags;
+
+    int ret = init_yolov5_model(large);
+    if (ret == 0)
+    {
+        ret = init_yolov5_model(&sw->small);
+    }
+    if (ret == 0 && (sw->small.model_width != large->model_width || sw->small.model_height != large->model_height ||
+                     sw->small.model_channel != large->model_channel))
+    {
+        printf("small model input %dx%d differs from %dx%d\n", sw->small.model_width, sw->small.model_height,
+               large->model_width, large->model_height);
+        ret = -1;
+    }
+    if (ret == 0 && config->share_memory)
+    {
+        ret = share_internal_mem(sw);
+    }
+    if (ret != 0)
+    {
+        release_yolov5_model(large);
+        release_model_switch(sw);
+        large->init_flags = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void release_model_switch(model_switch_t *sw)
+{
+    if (sw->internal_mem != NULL)
+    {
+        rknn_destroy_mem(sw->small.rknn_ctx, sw->internal_mem);
+        sw->internal_mem = NULL;
+    }
+    release_yolov5_model(&sw->small);
+}
+
+int model_switch_attach(model_switch_t *sw, rknn_app_context_t *app_ctx)
+{
+    if (sw->internal_mem == NULL)
+    {
+        return 0;
+    }
+    uint32_t size;
+    if (internal_size(app_ctx, &size) != 0)
+    {
+        return -1;
+    }
+    if (size > sw->internal_mem->size)
+    {
+        printf("model %s needs %u bytes of internal memory, %u shared\n", app_ctx->model_path, size,
+               sw->internal_mem->size);
+        return -1;
+    }
+    if (rknn_set_internal_mem(app_ctx->rknn_ctx, sw->internal_mem) != RKNN_SUCC)
+    {
+        printf("rknn_set_internal_mem fail!\n");
+        return -1;
+    }
+    // the warm up memory is no longer used
+    if (app_ctx->own_internal_mem != NULL)
+    {
+        rknn_destroy_mem(app_ctx->rknn_ctx, app_ctx->own_internal_mem);
+        app_ctx->own_internal_mem = NULL;
+    }
+    return 0;
+}
+
+rknn_app_context_t *model_switch_active(model_switch_t *sw)
+{
+    return sw->use_small ? &sw->small : sw->large;
+}
+
+static void decide(model_switch_t *sw, int64_t now_ms)
+{
+    model_switch_config_t *config = &sw->config;
+    float queued_ratio = sw->window_frames > 0 ? (float)sw->window_queued / sw->window_frames : 0;
+    if (now_ms - sw->switched_ms < config->min_dwell_ms)
+    {
+        return;
+    }
+
+    int use_small = sw->use_small;
+    if (!sw->use_small)
+    {
+        bool loaded = sw->util >= config->high_util || queued_ratio >= config->queue_ratio;
+        // crowded scenes lose the most with the small model, it only goes when nothing else keeps up
+        bool complex = sw->det_avg >= config->complex_detections;
+        use_small = loaded && (!complex || sw->util >= 0.98f);
+    }
+    else if (sw->run_ms[0] > 0 && sw->run_ms[1] > 0)
+    {
+        float expected = sw->util * sw->run_ms[0] / sw->run_ms[1];
+        use_small = !(expected < config->low_util && queued_ratio == 0);
+    }
+    if (use_small != sw->use_small)
+    {
+        printf("model switch to %s util %.2f queued %.2f detections %.1f run %.1f/%.1fms\n",
+               use_small ? "small" : "large", sw->util, queued_ratio, sw->det_avg, sw->run_ms[0], sw->run_ms[1]);
+        sw->use_small = use_small;
+        sw->switched_ms = now_ms;
+        sw->switches++;
+    }
+}
+
+void model_switch_update(model_switch_t *sw, float run_ms, int queued, int detections, int64_t now_ms)
+{
+    float *avg = &sw->run_ms[sw->use_small ? 1 : 0];
+    *avg = *avg > 0 ? *avg + MODEL_SWITCH_EWMA * (run_ms - *avg) : run_ms;
+    sw->det_avg += MODEL_SWITCH_EWMA * (detections - sw->det_avg);
+    if (sw->window_start_ms == 0)
+    {
+        sw->window_start_ms = now_ms;
+    }
+    sw->window_busy_ms += run_ms;
+    sw->window_frames++;
+    sw->window_queued += queued > 0;
+
+    int64_t elapsed = now_ms - sw->window_start_ms;
+    if (elapsed < sw->config.window_ms)
+    {
+        return;
+    }
+    // share of the wall time the detector kept the NPU
+    sw->util = (float)(sw->window_busy_ms / elapsed);
+    decide(sw, now_ms);
+    sw->window_start_ms = now_ms;
+    sw->window_busy_ms = 0;
+    sw->window_frames = 0;
+    sw->window_queued = 0;
+}
@@ -1,21 +1,25 @@
 #include "mpp.h"
-static void mpp_close(MppContext* ctx);
-static void init_mpp(MppContext *mpp_enc_data);
-static _Bool write_header(MppContext *mpp_enc_data,SpsHeader *sps_header);
-static _Bool process_image(uint8_t *p, int size,MppContext *mpp_enc_data);
+static void mpp_close(void *data);
+static void init_mpp(void *data);
+static _Bool write_header(void *data,SpsHeader *sps_header);
+static _Bool process_image(uint8_t *p, int size,void *data);
+static _Bool encode_frame(MppBuffer buf,MppContext *mpp_enc_data);
 
 MppContext * alloc_mpp_context()
 {
         MppContext *ctx = (MppContext *)malloc(sizeof(MppContext));
+        memset(ctx, 0, sizeof(MppContext));
         ctx->init_mpp = init_mpp;
         ctx->close = mpp_close;
         ctx->write_header = write_header;
         ctx->process_image = process_image;
+        ctx->fmt = MPP_FMT_YUV422_YUYV;
         return ctx;
 }
 
-static void mpp_close(MppContext* ctx)
+static void mpp_close(void *data)
 {
+        MppContext *ctx = (MppContext *)data;
         MPP_RET ret = MPP_OK;
         ret = ctx->mpi->reset(ctx->ctx);
         if (ret)
@@ -38,14 +42,20 @@ static void mpp_close(MppContext* ctx)
     
 }
 
-static void init_mpp(MppContext *mpp_enc_data)
+static void init_mpp(void *data)
 {
+        MppContext *mpp_enc_data = (MppContext *)data;
         MPP_RET ret = MPP_OK;
         mpp_enc_data->type = MPP_VIDEO_CodingAVC;
-        mpp_enc_data->fmt = MPP_FMT_YUV422_YUYV;
-        mpp_enc_data->hor_stride = MPP_ALIGN(mpp_enc_data->width, 16);
-        mpp_enc_data->ver_stride = MPP_ALIGN(mpp_enc_data->height, 16);
-        mpp_enc_data->frame_size = mpp_enc_data->hor_stride * mpp_enc_data->ver_stride * 2;
+        /* keep the producer layout when it is given, frames then need no repacking */
+        if (mpp_enc_data->hor_stride < mpp_enc_data->width)
+                mpp_enc_data->hor_stride = MPP_ALIGN(mpp_enc_data->width, 16);
+        if (mpp_enc_data->ver_stride < mpp_enc_data->height)
+                mpp_enc_data->ver_stride = MPP_ALIGN(mpp_enc_data->height, 16);
+        if (mpp_enc_data->fmt == MPP_FMT_YUV420SP)
+                mpp_enc_data->frame_size = mpp_enc_data->hor_stride * mpp_enc_data->ver_stride * 3 / 2;
+        else
+                mpp_enc_data->frame_size = mpp_enc_data->hor_stride * mpp_enc_data->ver_stride * 2;
 
         ret = mpp_buffer_get(NULL, &(mpp_enc_data->frm_buf), mpp_enc_data->frame_size);
 	if (ret)
@@ -118,10 +128,10 @@ static void init_mpp(MppContext *mpp_enc_data)
 	/* fix input / output frame rate */
 	mpp_enc_data->rc_cfg.fps_in_flex      = 0;
 	mpp_enc_data->rc_cfg.fps_in_num       = mpp_enc_data->fps;
-	mpp_enc_data->rc_cfg.fps_in_denom    = 1;
+	mpp_enc_data->rc_cfg.fps_in_denorm   = 1;
 	mpp_enc_data->rc_cfg.fps_out_flex     = 0;
 	mpp_enc_data->rc_cfg.fps_out_num      = mpp_enc_data->fps;
-	mpp_enc_data->rc_cfg.fps_out_denom   = 1;
+	mpp_enc_data->rc_cfg.fps_out_denorm  = 1;
 	mpp_enc_data->rc_cfg.gop              = mpp_enc_data->gop;
 	mpp_enc_data->rc_cfg.skip_cnt         = 0;
 
@@ -194,7 +204,7 @@ static void init_mpp(MppContext *mpp_enc_data)
 
 	
 
-	return 0;
+	return;
 
 MPP_INIT_OUT:
 
@@ -213,8 +223,9 @@ MPP_INIT_OUT:
         printf("init mpp failed!\n");
 }
 
-static _Bool write_header(MppContext *mpp_enc_data,SpsHeader *sps_header)
+static _Bool write_header(void *data,SpsHeader *sps_header)
 {
+        MppContext *mpp_enc_data = (MppContext *)data;
         int ret;
         if (mpp_enc_data->type == MPP_VIDEO_CodingAVC)
 	{
@@ -240,15 +251,39 @@ static _Bool write_header(MppContext *mpp_enc_data,SpsHeader *sps_header)
         return 1;
 }
 
-static _Bool process_image(uint8_t *p, int size,MppContext *mpp_enc_data)
-{   
+static _Bool process_image(uint8_t *p, int size,void *data)
+{
+	MppContext *mpp_enc_data = (MppContext *)data;
+	uint8_t *buf = (uint8_t *)mpp_buffer_get_ptr(mpp_enc_data->frm_buf);
+	int nv12 = mpp_enc_data->fmt == MPP_FMT_YUV420SP;
+	size_t pitch = mpp_enc_data->hor_stride * (nv12 ? 1 : 2);
+	size_t packed_pitch = mpp_enc_data->width * (nv12 ? 1 : 2);
+	RK_U32 rows = nv12 ? mpp_enc_data->height * 3 / 2 : mpp_enc_data->height;
+
+	if ((pitch != packed_pitch || mpp_enc_data->ver_stride != mpp_enc_data->height) &&
+	    size == packed_pitch * rows)
+	{
+		/* packed rows into the padded frame, one row at a time, chroma after ver_stride luma rows */
+		for (RK_U32 y = 0; y < rows; y++)
+		{
+			RK_U32 dst_y = y < mpp_enc_data->height ? y : y - mpp_enc_data->height + mpp_enc_data->ver_stride;
+			memcpy(buf + dst_y * pitch, p + y * packed_pitch, packed_pitch);
+		}
+	}
+	else
+	{
+		/* already laid out with hor_stride */
+		memcpy(buf, p, size < mpp_enc_data->frame_size ? size : mpp_enc_data->frame_size);
+	}
+	return encode_frame(mpp_enc_data->frm_buf, mpp_enc_data);
+}
+
+static _Bool encode_frame(MppBuffer buf,MppContext *mpp_enc_data)
+{
 	MPP_RET ret = MPP_OK;
 	MppFrame frame = NULL;
 	MppPacket packet = NULL;
 
-	void *buf = mpp_buffer_get_ptr(mpp_enc_data->frm_buf);
-	//TODO: improve performance here?
-	memcpy(buf, p, size);
 	ret = mpp_frame_init(&frame);
 	if (ret)
 	{
@@ -261,7 +296,7 @@ static _Bool process_image(uint8_t *p, int size,MppContext *mpp_enc_data)
 	mpp_frame_set_hor_stride(frame, mpp_enc_data->hor_stride);
 	mpp_frame_set_ver_stride(frame, mpp_enc_data->ver_stride);
 	mpp_frame_set_fmt(frame, mpp_enc_data->fmt);
-	mpp_frame_set_buffer(frame, mpp_enc_data->frm_buf);
+	mpp_frame_set_buffer(frame, buf);
 	mpp_frame_set_eos(frame, mpp_enc_data->frm_eos);
 
 	ret = mpp_enc_data->mpi->encode_put_frame(mpp_enc_data->ctx, frame);
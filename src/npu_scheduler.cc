@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include "frame_pool.h"
+#include "npu_scheduler.h"
+
+typedef struct {
+    std::string name;
+    npu_model_desc_t desc;
+    npu_model_stats_t stats;
+    int waiting;
+    int64_t window_start_ms;
+    double window_used_ms;
+} npu_model_t;
+
+static std::mutex sched_mutex;
+static std::condition_variable sched_cond;
+static npu_model_t sched_models[NPU_SCHED_MAX_MODELS + 1];
+static int sched_num_models;
+static int sched_slots;
+static int sched_free_slots;
+static int sched_report_sec;
+static int64_t sched_last_report_ms;
+
+static const char *priority_name(npu_priority_t priority)
+{
+    switch (priority)
+    {
+    case NPU_PRIORITY_HIGH:
+        return "high";
+    case NPU_PRIORITY_NORMAL:
+        return "normal";
+    default:
+        return "low";
+    }
+}
+
+int npu_sched_init(int slots, int report_sec)
+{
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    if (slots <= 0)
+    {
+        printf("npu scheduler needs at least one slot\n");
+        return -1;
+    }
+    sched_num_models = 0;
+    sched_slots = slots;
+    sched_free_slots = slots;
+    sched_report_sec = report_sec;
+    sched_last_report_ms = frame_clock_ms();
+    return 0;
+}
+
+int npu_sched_register(const npu_model_desc_t *desc)
+{
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    if (sched_slots == 0 || sched_num_models >= NPU_SCHED_MAX_MODELS)
+    {
+        printf("npu scheduler not initialized or full\n");
+        return -1;
+    }
+    // id 0 is the unscheduled model
+    int id = ++sched_num_models;
+    npu_model_t *model = &sched_models[id];
+    model->name = desc->name != NULL ? desc->name : "model";
+    model->desc = *desc;
+    model->desc.name = model->name.c_str();
+    memset(&model->stats, 0, sizeof(npu_model_stats_t));
+    model->waiting = 0;
+    model->window_start_ms = frame_clock_ms();
+    model->window_used_ms = 0;
+    printf("npu model %d %s priority=%s budget=%dms/s\n", id, model->name.c_str(), priority_name(desc->priority),
+           desc->budget_ms);
+    return id;
+}
+
+// a model of higher priority is waiting in the scheduler or has work queued outside
+static int higher_waiting(const npu_model_t *model)
+{
+    for (int i = 1; i <= sched_num_models; i++)
+    {
+        const npu_model_t *other = &sched_models[i];
+        if (other == model || other->desc.priority >= model->desc.priority)
+        {
+            continue;
+        }
+        if (other->waiting > 0 || (other->desc.has_work != NULL && other->desc.has_work(other->desc.arg)))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// only models blocked in npu_sched_run hold a slot back, work outside does not
+static int higher_blocked(const npu_model_t *model)
+{
+    for (int i = 1; i <= sched_num_models; i++)
+    {
+        const npu_model_t *other = &sched_models[i];
+        if (other != model && other->desc.priority < model->desc.priority && other->waiting > 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void print_stats_locked()
+{
+    for (int i = 1; i <= sched_num_models; i++)
+    {
+        const npu_model_t *model = &sched_models[i];
+        const npu_model_stats_t *s = &model->stats;
+        double runs = s->runs > 0 ? (double)s->runs : 1.0;
+        printf("npu %-10s %-6s runs=%llu rejected=%llu yields=%llu queue avg=%.2fms max=%.2fms "
+               "exec avg=%.2fms max=%.2fms\n",
+               model->name.c_str(), priority_name(model->desc.priority), s->runs, s->rejected, s->yields,
+               s->queue_ms_total / runs, s->queue_ms_max, s->exec_ms_total / runs, s->exec_ms_max);
+    }
+}
+
+void npu_sched_dump()
+{
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    print_stats_locked();
+}
+
+void npu_sched_deinit()
+{
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    print_stats_locked();
+    sched_num_models = 0;
+    sched_slots = 0;
+    sched_free_slots = 0;
+}
+
+static double elapsed_ms(const struct timespec *begin, const struct timespec *end)
+{
+    return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+int npu_sched_run(int id, rknn_context ctx, rknn_run_extend *extend)
+{
+    if (id <= 0)
+    {
+        return rknn_run(ctx, extend);
+    }
+    struct timespec queued, granted, done;
+    clock_gettime(CLOCK_MONOTONIC, &queued);
+    {
+        std::unique_lock<std::mutex> lock(sched_mutex);
+        npu_model_t *model = &sched_models[id];
+        model->waiting++;
+        sched_cond.wait(lock, [model] { return sched_free_slots > 0 && !higher_blocked(model); });
+        model->waiting--;
+        sched_free_slots--;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &granted);
+    int ret = rknn_run(ctx, extend);
+    clock_gettime(CLOCK_MONOTONIC, &done);
+
+    {
+        std::lock_guard<std::mutex> lock(sched_mutex);
+        sched_free_slots++;
+        npu_model_t *model = &sched_models[id];
+        double queue_ms = elapsed_ms(&queued, &granted);
+        double exec_ms = elapsed_ms(&granted, &done);
+        model->stats.runs++;
+        model->stats.queue_ms_total += queue_ms;
+        model->stats.exec_ms_total += exec_ms;
+        if (queue_ms > model->stats.queue_ms_max)
+        {
+            model->stats.queue_ms_max = queue_ms;
+        }
+        if (exec_ms > model->stats.exec_ms_max)
+        {
+            model->stats.exec_ms_max = exec_ms;
+        }
+        model->window_used_ms += exec_ms;
+        int64_t now_ms = frame_clock_ms();
+        if (sched_report_sec > 0 && now_ms - sched_last_report_ms >= sched_report_sec * 1000LL)
+        {
+            sched_last_report_ms = now_ms;
+            print_stats_locked();
+        }
+    }
+    sched_cond.notify_all();
+    return ret;
+}
+
+int npu_sched_admit(int id)
+{
+    if (id <= 0)
+    {
+        return 1;
+    }
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    npu_model_t *model = &sched_models[id];
+    if (model->desc.budget_ms <= 0)
+    {
+        return 1;
+    }
+    int64_t now_ms = frame_clock_ms();
+    if (now_ms - model->window_start_ms >= 1000)
+    {
+        model->window_start_ms = now_ms;
+        model->window_used_ms = 0;
+    }
+    if (model->window_used_ms < model->desc.budget_ms)
+    {
+        return 1;
+    }
+    model->stats.rejected++;
+    return 0;
+}
+
+int npu_sched_should_yield(int id)
+{
+    if (id <= 0)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    npu_model_t *model = &sched_models[id];
+    if (!higher_waiting(model))
+    {
+        return 0;
+    }
+    model->stats.yields++;
+    return 1;
+}
+
+int npu_sched_get_stats(int id, npu_model_stats_t *stats)
+{
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    if (id <= 0 || id > sched_num_models)
+    {
+        return -1;
+    }
+    *stats = sched_models[id].stats;
+    return 0;
+}
@@ -0,0 +1,589 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipeline_config.h"
+#include "yolov5.h"
+
+static void default_stage(stage_config_t *stage, int queue_depth, frame_channel_policy_t policy)
+{
+    stage->threads = 0;
+    stage->queue_depth = queue_depth;
+    stage->policy = policy;
+}
+
+void default_pipeline_config(pipeline_config_t *config)
+{
+    memset(config, 0, sizeof(pipeline_config_t));
+    snprintf(config->source.device, PIPELINE_PATH_MAX, "/dev/video0");
+    config->source.width = 640;
+    config->source.height = 480;
+    config->source.format = IMAGE_FORMAT_YUYV_422;
+    config->source.pool_size = 8;
+
+    config->preprocess.threads = 0;
+
+    // the detector takes one frame at a time, a newer capture replaces a waiting one
+    default_stage(&config->inference.stage, 1, FRAME_CHANNEL_DROP_OLDEST);
+    snprintf(config->inference.model_path, PIPELINE_PATH_MAX, "./model/yolov5s.rknn");
+    snprintf(config->inference.label_path, PIPELINE_PATH_MAX, "./model/coco_80_labels_list.txt");
+    config->inference.box_threshold = BOX_THRESH;
+    config->inference.nms_threshold = NMS_THRESH;
+    config->inference.reload_warmup = 3;
+
+    // the encoder keeps every frame it can, when it falls behind new captures are skipped
+    default_stage(&config->encode.stage, 2, FRAME_CHANNEL_DROP_NEWEST);
+    config->encode.enable = 1;
+    config->encode.fps = 30;
+    config->encode.gop = 60;
+    config->encode.bitrate = 0;
+    config->encode.overlay = 1;
+
+    config->preview.enable = 0;
+    config->preview.width = 320;
+    config->preview.height = 180;
+    config->preview.format = IMAGE_FORMAT_RGB888;
+
+    default_load_shedder_config(&config->shedder);
+    default_motion_config(&config->motion);
+    default_tracking_config(&config->tracking);
+    default_tiling_config(&config->tiling);
+    default_classifier_config(&config->cascade);
+
+    config->npu.slots = 1;
+    config->npu.report_sec = 10;
+    config->npu.detector_priority = NPU_PRIORITY_HIGH;
+
+    default_model_switch_config(&config->switching);
+}
+
+static char *trim(char *str)
+{
+    while (isspace((unsigned char)*str))
+    {
+        str++;
+    }
+    char *end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1]))
+    {
+        end--;
+    }
+    *end = '\0';
+    return str;
+}
+
+static int parse_int(const char *value, int *out)
+{
+    char *end;
+    long v = strtol(value, &end, 0);
+    if (end == value || *end != '\0')
+    {
+        return -1;
+    }
+    *out = (int)v;
+    return 0;
+}
+
+static int parse_float(const char *value, float *out)
+{
+    char *end;
+    float v = strtof(value, &end);
+    if (end == value || *end != '\0')
+    {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static int parse_string(const char *value, char *out)
+{
+    if (strlen(value) >= PIPELINE_PATH_MAX)
+    {
+        return -1;
+    }
+    strcpy(out, value);
+    return 0;
+}
+
+static int parse_policy(const char *value, frame_channel_policy_t *out)
+{
+    if (strcmp(value, "drop_oldest") == 0)
+    {
+        *out = FRAME_CHANNEL_DROP_OLDEST;
+    }
+    else if (strcmp(value, "drop_newest") == 0)
+    {
+        *out = FRAME_CHANNEL_DROP_NEWEST;
+    }
+    else if (strcmp(value, "block") == 0)
+    {
+        *out = FRAME_CHANNEL_BLOCK;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_format(const char *value, image_format_t *out)
+{
+    if (strcmp(value, "yuyv") == 0)
+    {
+        *out = IMAGE_FORMAT_YUYV_422;
+    }
+    else if (strcmp(value, "nv12") == 0)
+    {
+        *out = IMAGE_FORMAT_YUV420SP_NV12;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// formats of a pyramid output
+static int parse_output_format(const char *value, image_format_t *out)
+{
+    if (strcmp(value, "rgb") == 0)
+    {
+        *out = IMAGE_FORMAT_RGB888;
+    }
+    else if (strcmp(value, "nv12") == 0)
+    {
+        *out = IMAGE_FORMAT_YUV420SP_NV12;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_priority(const char *value, npu_priority_t *out)
+{
+    if (strcmp(value, "high") == 0)
+    {
+        *out = NPU_PRIORITY_HIGH;
+    }
+    else if (strcmp(value, "normal") == 0)
+    {
+        *out = NPU_PRIORITY_NORMAL;
+    }
+    else if (strcmp(value, "low") == 0)
+    {
+        *out = NPU_PRIORITY_LOW;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// auto or WxH
+static int parse_shape(const char *value, int *width, int *height)
+{
+    if (strcmp(value, "auto") == 0)
+    {
+        *width = 0;
+        *height = 0;
+        return 0;
+    }
+    char end;
+    if (sscanf(value, "%dx%d%c", width, height, &end) != 2 || *width <= 0 || *height <= 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// x, y, w, h appended to the regions
+static int parse_region(const char *value, tiling_config_t *tiling)
+{
+    int x, y, w, h;
+    char tail;
+    if (sscanf(value, "%d , %d , %d , %d %c", &x, &y, &w, &h, &tail) != 4 || w <= 0 || h <= 0 ||
+        tiling->num_regions >= TILING_MAX_REGIONS)
+    {
+        return -1;
+    }
+    image_rect_t *region = &tiling->regions[tiling->num_regions++];
+    region->left = x;
+    region->top = y;
+    region->right = x + w - 1;
+    region->bottom = y + h - 1;
+    return 0;
+}
+
+// 1: not a stage key
+static int set_stage_key(stage_config_t *stage, const char *key, const char *value)
+{
+    if (strcmp(key, "threads") == 0)
+        return parse_int(value, &stage->threads);
+    if (strcmp(key, "queue_depth") == 0)
+        return parse_int(value, &stage->queue_depth) != 0 || stage->queue_depth <= 0 ? -1 : 0;
+    if (strcmp(key, "policy") == 0)
+        return parse_policy(value, &stage->policy);
+    return 1;
+}
+
+// 1: unknown key
+static int set_key(pipeline_config_t *config, const char *section, const char *key, const char *value)
+{
+    if (strcmp(section, "source") == 0)
+    {
+        if (strcmp(key, "device") == 0)
+            return parse_string(value, config->source.device);
+        if (strcmp(key, "width") == 0)
+            return parse_int(value, &config->source.width);
+        if (strcmp(key, "height") == 0)
+            return parse_int(value, &config->source.height);
+        if (strcmp(key, "format") == 0)
+            return parse_format(value, &config->source.format);
+        if (strcmp(key, "pool_size") == 0)
+            return parse_int(value, &config->source.pool_size);
+        return 1;
+    }
+    if (strcmp(section, "preprocess") == 0)
+    {
+        if (strcmp(key, "threads") == 0)
+            return parse_int(value, &config->preprocess.threads);
+        return 1;
+    }
+    if (strcmp(section, "inference") == 0)
+    {
+        if (strcmp(key, "model") == 0)
+            return parse_string(value, config->inference.model_path);
+        if (strcmp(key, "labels") == 0)
+            return parse_string(value, config->inference.label_path);
+        if (strcmp(key, "box_threshold") == 0)
+            return parse_float(value, &config->inference.box_threshold);
+        if (strcmp(key, "nms_threshold") == 0)
+            return parse_float(value, &config->inference.nms_threshold);
+        if (strcmp(key, "server") == 0)
+            return parse_string(value, config->inference.server);
+        if (strcmp(key, "reload_warmup") == 0)
+            return parse_int(value, &config->inference.reload_warmup);
+        if (strcmp(key, "input_shape") == 0)
+            return parse_shape(value, &config->inference.input_width, &config->inference.input_height);
+        if (strcmp(key, "float_outputs") == 0)
+            return parse_int(value, &config->inference.float_outputs);
+        if (strcmp(key, "record") == 0)
+            return parse_string(value, config->inference.record_path);
+        // no CPU work of its own, the detector thread runs it
+        if (strcmp(key, "threads") == 0)
+            return 1;
+        return set_stage_key(&config->inference.stage, key, value);
+    }
+    if (strcmp(section, "overlay") == 0)
+    {
+        if (strcmp(key, "enable") == 0)
+            return parse_int(value, &config->encode.overlay);
+        return 1;
+    }
+    if (strcmp(section, "encode") == 0)
+    {
+        if (strcmp(key, "enable") == 0)
+            return parse_int(value, &config->encode.enable);
+        if (strcmp(key, "fps") == 0)
+            return parse_int(value, &config->encode.fps);
+        if (strcmp(key, "gop") == 0)
+            return parse_int(value, &config->encode.gop);
+        if (strcmp(key, "bitrate") == 0)
+            return parse_int(value, &config->encode.bitrate);
+        return set_stage_key(&config->encode.stage, key, value);
+    }
+    if (strcmp(section, "preview") == 0)
+    {
+        if (strcmp(key, "enable") == 0)
+            return parse_int(value, &config->preview.enable);
+        if (strcmp(key, "width") == 0)
+            return parse_int(value, &config->preview.width) != 0 || config->preview.width <= 0 ? -1 : 0;
+        if (strcmp(key, "height") == 0)
+            return parse_int(value, &config->preview.height) != 0 || config->preview.height <= 0 ? -1 : 0;
+        if (strcmp(key, "format") == 0)
+            return parse_output_format(value, &config->preview.format);
+        return 1;
+    }
+    if (strcmp(section, "shedder") == 0)
+    {
+        if (strcmp(key, "enable") == 0)
+            return parse_int(value, &config->shedder.enable);
+        if (strcmp(key, "max_latency_ms") == 0)
+            return parse_int(value, &config->shedder.max_latency_ms);
+        if (strcmp(key, "window") == 0)
+            return parse_int(value, &config->shedder.window);
+        if (strcmp(key, "overload_ratio") == 0)
+            return parse_float(value, &config->shedder.overload_ratio);
+        if (strcmp(key, "headroom_ratio") == 0)
+            return parse_float(value, &config->shedder.headroom_ratio);
+        if (strcmp(key, "max_rate_divisor") == 0)
+            return parse_int(value, &config->shedder.max_rate_divisor);
+        if (strcmp(key, "resolution_levels") == 0)
+            return parse_int(value, &config->shedder.resolution_levels);
+        return 1;
+    }
+    if (strcmp(section, "motion") == 0)
+    {
+        if (strcmp(key, "enable") == 0)
+            return parse_int(value, &config->motion.enable);
+        if (strcmp(key, "scale") == 0)
+            return parse_int(value, &config->motion.scale);
+        if (strcmp(key, "tile_size") == 0)
+            return parse_int(value, &config->motion.tile_size);
+        if (strcmp(key, "threshold") == 0)
+            return parse_int(value, &config->motion.threshold);
+        if (strcmp(key, "min_tiles") == 0)
+            return parse_int(value, &config->motion.min_tiles);
+        if (strcmp(key, "bg_shift") == 0)
+            return parse_int(value, &config->motion.bg_shift);
+        if (strcmp(key, "max_skip") == 0)
+            return parse_int(value, &config->motion.max_skip);
+        return 1;
+    }
+    if (strcmp(section, "tracking") == 0)
+    {
+        if (strcmp(key, "enable") == 0)
+            return parse_int(value, &config->tracking.enable);
+        if (strcmp(key, "detect_interval") == 0)
+            return parse_int(value, &config->tracking.detect_interval);
+        if (strcmp(key, "adaptive") == 0)
+            return parse_int(value, &config->tracking.adaptive);
+        if (strcmp(key, "max_drift") == 0)
+            return parse_float(value, &config->tracking.max_drift);
+        if (strcmp(key, "min_confidence") == 0)
+            return parse_float(value, &config->tracking.min_confidence);
+        if (strcmp(key, "track_buffer") == 0)
+            return parse_int(value, &config->tracking.track_buffer);
+        if (strcmp(key, "redetect") == 0)
+            return parse_int(value, &config->tracking.redetect);
+        if (strcmp(key, "redetect_max_rois") == 0)
+            return parse_int(value, &config->tracking.redetect_max_rois);
+        if (strcmp(key, "redetect_min_height") == 0)
+            return parse_int(value, &config->tracking.redetect_min_height);
+        if (strcmp(key, "redetect_lost_frames") == 0)
+            return parse_int(value, &config->tracking.redetect_lost_frames);
+        return 1;
+    }
+    if (strcmp(section, "tiling") == 0)
+    {
+        if (strcmp(key, "enable") == 0)
+            return parse_int(value, &config->tiling.enable);
+        if (strcmp(key, "overlap") == 0)
+            return parse_int(value, &config->tiling.overlap);
+        if (strcmp(key, "full_frame") == 0)
+            return parse_int(value, &config->tiling.full_frame);
+        if (strcmp(key, "nms_threshold") == 0)
+            return parse_float(value, &config->tiling.nms_threshold);
+        if (strcmp(key, "ios_threshold") == 0)
+            return parse_float(value, &config->tiling.ios_threshold);
+        if (strcmp(key, "region") == 0)
+            return parse_region(value, &config->tiling);
+        return 1;
+    }
+    if (strcmp(section, "cascade") == 0)
+    {
+        if (strcmp(key, "enable") == 0)
+            return parse_int(value, &config->cascade.enable);
+        if (strcmp(key, "model") == 0)
+            return parse_string(value, config->cascade.model_path);
+        if (strcmp(key, "labels") == 0)
+            return parse_string(value, config->cascade.label_path);
+        if (strcmp(key, "batch_size") == 0)
+            return parse_int(value, &config->cascade.batch_size);
+        if (strcmp(key, "max_wait_ms") == 0)
+            return parse_int(value, &config->cascade.max_wait_ms);
+        if (strcmp(key, "det_class") == 0)
+            return parse_int(value, &config->cascade.det_class);
+        if (strcmp(key, "min_size") == 0)
+            return parse_int(value, &config->cascade.min_size);
+        if (strcmp(key, "priority") == 0)
+            return parse_priority(value, &config->cascade.priority);
+        if (strcmp(key, "budget_ms") == 0)
+            return parse_int(value, &config->cascade.budget_ms);
+        return 1;
+    }
+    if (strcmp(section, "switching") == 0)
+    {
+        if (strcmp(key, "enable") == 0)
+            return parse_int(value, &config->switching.enable);
+        if (strcmp(key, "small_model") == 0)
+            return parse_string(value, config->switching.small_model_path);
+        if (strcmp(key, "high_util") == 0)
+            return parse_float(value, &config->switching.high_util);
+        if (strcmp(key, "low_util") == 0)
+            return parse_float(value, &config->switching.low_util);
+        if (strcmp(key, "queue_ratio") == 0)
+            return parse_float(value, &config->switching.queue_ratio);
+        if (strcmp(key, "complex_detections") == 0)
+            return parse_int(value, &config->switching.complex_detections);
+        if (strcmp(key, "min_dwell_ms") == 0)
+            return parse_int(value, &config->switching.min_dwell_ms);
+        if (strcmp(key, "window_ms") == 0)
+            return parse_int(value, &config->switching.window_ms);
+        if (strcmp(key, "share_memory") == 0)
+            return parse_int(value, &config->switching.share_memory);
+        return 1;
+    }
+    if (strcmp(section, "npu") == 0)
+    {
+        if (strcmp(key, "slots") == 0)
+            return parse_int(value, &config->npu.slots) != 0 || config->npu.slots <= 0 ? -1 : 0;
+        if (strcmp(key, "report_sec") == 0)
+            return parse_int(value, &config->npu.report_sec);
+        if (strcmp(key, "detector_priority") == 0)
+            return parse_priority(value, &config->npu.detector_priority);
+        return 1;
+    }
+    if (strcmp(section, "sink") == 0)
+    {
+        if (strcmp(key, "url") == 0)
+            return parse_string(value, config->encode.url);
+        return 1;
+    }
+    return 1;
+}
+
+int load_pipeline_config(const char *path, pipeline_config_t *config)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        printf("open config %s fail!\n", path);
+        return -1;
+    }
+
+    char line[512];
+    char section[64] = "";
+    int line_no = 0;
+    int ret = 0;
+    while (ret == 0 && fgets(line, sizeof(line), fp) != NULL)
+    {
+        line_no++;
+        // whole line comments only, values such as urls may hold ; or #
+        char *str = trim(line);
+        if (*str == '\0' || *str == ';' || *str == '#')
+        {
+            continue;
+        }
+        if (*str == '[')
+        {
+            char *end = strchr(str, ']');
+            if (end == NULL || end - str - 1 >= (int)sizeof(section))
+            {
+                printf("%s:%d: bad section\n", path, line_no);
+                ret = -1;
+                break;
+            }
+            *end = '\0';
+            strcpy(section, trim(str + 1));
+            continue;
+        }
+        char *eq = strchr(str, '=');
+        if (eq == NULL)
+        {
+            printf("%s:%d: expected key = value\n", path, line_no);
+            ret = -1;
+            break;
+        }
+        *eq = '\0';
+        char *key = trim(str);
+        char *value = trim(eq + 1);
+        int r = set_key(config, section, key, value);
+        if (r > 0)
+        {
+            printf("%s:%d: unknown key [%s] %s\n", path, line_no, section, key);
+            ret = -1;
+        }
+        else if (r < 0)
+        {
+            printf("%s:%d: bad value for [%s] %s: %s\n", path, line_no, section, key, value);
+            ret = -1;
+        }
+    }
+    fclose(fp);
+    return ret;
+}
+
+static const char *policy_name(frame_channel_policy_t policy)
+{
+    switch (policy)
+    {
+    case FRAME_CHANNEL_DROP_OLDEST:
+        return "drop_oldest";
+    case FRAME_CHANNEL_DROP_NEWEST:
+        return "drop_newest";
+    case FRAME_CHANNEL_BLOCK:
+        return "block";
+    default:
+        return "unknown";
+    }
+}
+
+static void dump_stage(const char *name, const stage_config_t *stage)
+{
+    printf("  %-10s threads=%d queue_depth=%d policy=%s\n", name, stage->threads, stage->queue_depth,
+           policy_name(stage->policy));
+}
+
+void dump_pipeline_config(const pipeline_config_t *config)
+{
+    printf("pipeline config:\n");
+    printf("  source     %s %dx%d format=%d pool_size=%d\n", config->source.device, config->source.width,
+           config->source.height, config->source.format, config->source.pool_size);
+    printf("  preprocess threads=%d\n", config->preprocess.threads);
+    printf("  inference  queue_depth=%d policy=%s\n", config->inference.stage.queue_depth,
+           policy_name(config->inference.stage.policy));
+    printf("             model=%s labels=%s box_threshold=%.2f nms_threshold=%.2f server=%s reload_warmup=%d "
+           "input_shape=%dx%d float_outputs=%d record=%s\n",
+           config->inference.model_path, config->inference.label_path, config->inference.box_threshold,
+           config->inference.nms_threshold, config->inference.server, config->inference.reload_warmup,
+           config->inference.input_width, config->inference.input_height, config->inference.float_outputs,
+           config->inference.record_path);
+    dump_stage("encode", &config->encode.stage);
+    printf("             enable=%d fps=%d gop=%d bitrate=%d overlay=%d url=%s\n", config->encode.enable,
+           config->encode.fps, config->encode.gop, config->encode.bitrate, config->encode.overlay, config->encode.url);
+    printf("  preview    enable=%d %dx%d format=%d\n", config->preview.enable, config->preview.width,
+           config->preview.height, config->preview.format);
+    printf("  shedder    enable=%d max_latency_ms=%d window=%d overload_ratio=%.2f headroom_ratio=%.2f "
+           "max_rate_divisor=%d resolution_levels=%d\n",
+           config->shedder.enable, config->shedder.max_latency_ms, config->shedder.window,
+           config->shedder.overload_ratio, config->shedder.headroom_ratio, config->shedder.max_rate_divisor,
+           config->shedder.resolution_levels);
+    printf("  motion     enable=%d scale=%d tile_size=%d threshold=%d min_tiles=%d bg_shift=%d max_skip=%d\n",
+           config->motion.enable, config->motion.scale, config->motion.tile_size, config->motion.threshold,
+           config->motion.min_tiles, config->motion.bg_shift, config->motion.max_skip);
+    printf("  tracking   enable=%d detect_interval=%d adaptive=%d max_drift=%.2f min_confidence=%.2f "
+           "track_buffer=%d\n",
+           config->tracking.enable, config->tracking.detect_interval, config->tracking.adaptive,
+           config->tracking.max_drift, config->tracking.min_confidence, config->tracking.track_buffer);
+    printf("             redetect=%d redetect_max_rois=%d redetect_min_height=%d redetect_lost_frames=%d\n",
+           config->tracking.redetect, config->tracking.redetect_max_rois, config->tracking.redetect_min_height,
+           config->tracking.redetect_lost_frames);
+    printf("  tiling     enable=%d overlap=%d full_frame=%d nms_threshold=%.2f ios_threshold=%.2f\n",
+           config->tiling.enable, config->tiling.overlap, config->tiling.full_frame, config->tiling.nms_threshold,
+           config->tiling.ios_threshold);
+    for (int i = 0; i < config->tiling.num_regions; i++)
+    {
+        const image_rect_t *region = &config->tiling.regions[i];
+        printf("             region=%d,%d,%d,%d\n", region->left, region->top, region->right - region->left + 1,
+               region->bottom - region->top + 1);
+    }
+    printf("  cascade    enable=%d model=%s labels=%s batch_size=%d max_wait_ms=%d det_class=%d min_size=%d\n",
+           config->cascade.enable, config->cascade.model_path, config->cascade.label_path,
+           config->cascade.batch_size, config->cascade.max_wait_ms, config->cascade.det_class,
+           config->cascade.min_size);
+    printf("             priority=%d budget_ms=%d\n", config->cascade.priority, config->cascade.budget_ms);
+    printf("  switching  enable=%d small_model=%s high_util=%.2f low_util=%.2f queue_ratio=%.2f\n",
+           config->switching.enable, config->switching.small_model_path, config->switching.high_util,
+           config->switching.low_util, config->switching.queue_ratio);
+    printf("             complex_detections=%d min_dwell_ms=%d window_ms=%d share_memory=%d\n",
+           config->switching.complex_detections, config->switching.min_dwell_ms, config->switching.window_ms,
+           config->switching.share_memory);
+    printf("  npu        slots=%d report_sec=%d detector_priority=%d\n", config->npu.slots, config->npu.report_sec,
+           config->npu.detector_priority);
+}
@@ -22,6 +22,10 @@
 
 #include <set>
 #include <vector>
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define POSTPROCESS_NEON 1
+#endif
 #define LABEL_NALE_TXT_PATH "./model/coco_80_labels_list.txt"
 
 static char *labels[OBJ_CLASS_NUM];
@@ -264,9 +268,10 @@ static int process_u8(uint8_t *input, int *anchor, int grid_h, int grid_w, int h
     return validCount;
 }
 
+// cells: anchor * grid_len + cell of each box, for heads that carry more per box
 static int process_i8(int8_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
                       std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold,
-                      int32_t zp, float scale)
+                      int32_t zp, float scale, std::vector<int> *cells = NULL)
 {
     int validCount = 0;
     int grid_len = grid_h * grid_w;
@@ -309,6 +314,10 @@ static int process_i8(int8_t *input, int *anchor, int grid_h, int grid_w, int he
                         objProbs.push_back((deqnt_affine_to_f32(maxClassProbs, zp, scale)) * (deqnt_affine_to_f32(box_confidence, zp, scale)));
                         classId.push_back(maxClassId);
                         validCount++;
+                        if (cells != NULL)
+                        {
+                            cells->push_back(a * grid_len + i * grid_w + j);
+                        }
                         boxes.push_back(box_x);
                         boxes.push_back(box_y);
                         boxes.push_back(box_w);
@@ -387,7 +396,8 @@ static int process_i8_rv1106(int8_t *input, int *anchor, int grid_h, int grid_w,
 }
 
 static int process_fp32(float *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-                        std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold)
+                        std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold,
+                        std::vector<int> *cells = NULL)
 {
     int validCount = 0;
     int grid_len = grid_h * grid_w;
@@ -430,6 +440,10 @@ static int process_fp32(float *input, int *anchor, int grid_h, int grid_w, int h
                         objProbs.push_back(maxClassProbs * box_confidence);
                         classId.push_back(maxClassId);
                         validCount++;
+                        if (cells != NULL)
+                        {
+                            cells->push_back(a * grid_len + i * grid_w + j);
+                        }
                         boxes.push_back(box_x);
                         boxes.push_back(box_y);
                         boxes.push_back(box_w);
@@ -442,16 +456,149 @@ static int process_fp32(float *input, int *anchor, int grid_h, int grid_w, int h
     return validCount;
 }
 
-int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter_box, float conf_threshold, float nms_threshold, object_detect_result_list *od_results)
+// IEEE half to float, what want_float would have done in the runtime
+static inline float half_to_float(uint16_t h)
 {
-#if defined(RV1106_1103) 
-    rknn_tensor_mem **_outputs = (rknn_tensor_mem **)outputs;
+#ifdef POSTPROCESS_NEON
+    __fp16 f;
+    memcpy(&f, &h, sizeof(f));
+    return f;
 #else
-    rknn_output *_outputs = (rknn_output *)outputs;
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mant << 13);
+    }
+    else if (exp != 0)
+    {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    }
+    else if (mant == 0)
+    {
+        bits = sign;
+    }
+    else
+    {
+        // subnormal, normalized for the wider exponent
+        exp = 113;
+        while (!(mant & 0x400))
+        {
+            mant <<= 1;
+            exp--;
+        }
+        bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
 #endif
-    std::vector<float> filterBoxes;
-    std::vector<float> objProbs;
-    std::vector<int> classId;
+}
+
+// one cell of one anchor, same decode as process_fp32; 1: box kept
+static int decode_fp16_cell(const uint16_t *input, const int *anchor, int a, int pos, int grid_w, int grid_len, int stride,
+                            std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId,
+                            float threshold, std::vector<int> *cells)
+{
+    const uint16_t *in_ptr = input + (PROP_BOX_SIZE * a) * grid_len + pos;
+    float box_confidence = half_to_float(in_ptr[4 * grid_len]);
+    if (box_confidence < threshold)
+    {
+        return 0;
+    }
+    int i = pos / grid_w;
+    int j = pos % grid_w;
+    float box_x = half_to_float(in_ptr[0]) * 2.0 - 0.5;
+    float box_y = half_to_float(in_ptr[grid_len]) * 2.0 - 0.5;
+    float box_w = half_to_float(in_ptr[2 * grid_len]) * 2.0;
+    float box_h = half_to_float(in_ptr[3 * grid_len]) * 2.0;
+    box_x = (box_x + j) * (float)stride;
+    box_y = (box_y + i) * (float)stride;
+    box_w = box_w * box_w * (float)anchor[a * 2];
+    box_h = box_h * box_h * (float)anchor[a * 2 + 1];
+    box_x -= (box_w / 2.0);
+    box_y -= (box_h / 2.0);
+
+    float maxClassProbs = half_to_float(in_ptr[5 * grid_len]);
+    int maxClassId = 0;
+    for (int k = 1; k < OBJ_CLASS_NUM; ++k)
+    {
+        float prob = half_to_float(in_ptr[(5 + k) * grid_len]);
+        if (prob > maxClassProbs)
+        {
+            maxClassId = k;
+            maxClassProbs = prob;
+        }
+    }
+    if (maxClassProbs <= threshold)
+    {
+        return 0;
+    }
+    objProbs.push_back(maxClassProbs * box_confidence);
+    classId.push_back(maxClassId);
+    boxes.push_back(box_x);
+    boxes.push_back(box_y);
+    boxes.push_back(box_w);
+    boxes.push_back(box_h);
+    if (cells != NULL)
+    {
+        cells->push_back(a * grid_len + pos);
+    }
+    return 1;
+}
+
+// native fp16 outputs, half the bytes of the fp32 ones and no conversion pass in the runtime
+static int process_fp16(uint16_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
+                        std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold,
+                        std::vector<int> *cells = NULL)
+{
+    int validCount = 0;
+    int grid_len = grid_h * grid_w;
+
+    for (int a = 0; a < 3; a++)
+    {
+        int pos = 0;
+#ifdef POSTPROCESS_NEON
+        // the confidence plane is contiguous, 8 cells are tested at once and nearly all fail
+        const uint16_t *conf = input + (PROP_BOX_SIZE * a + 4) * grid_len;
+        float32x4_t thres = vdupq_n_f32(threshold);
+        for (; pos + 8 <= grid_len; pos += 8)
+        {
+            float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(conf + pos));
+            uint32x4_t lo = vcgeq_f32(vcvt_f32_f16(vget_low_f16(h)), thres);
+            uint32x4_t hi = vcgeq_f32(vcvt_high_f32_f16(h), thres);
+            if (vmaxvq_u32(vorrq_u32(lo, hi)) == 0)
+            {
+                continue;
+            }
+            for (int k = pos; k < pos + 8; k++)
+            {
+                validCount += decode_fp16_cell(input, anchor, a, k, grid_w, grid_len, stride, boxes, objProbs, classId,
+                                               threshold, cells);
+            }
+        }
+#endif
+        for (; pos < grid_len; pos++)
+        {
+            validCount += decode_fp16_cell(input, anchor, a, pos, grid_w, grid_len, stride, boxes, objProbs, classId,
+                                           threshold, cells);
+        }
+    }
+    return validCount;
+}
+
+// YOLOv5 head: 3 levels of [anchors * (5 + classes), h, w]
+static int match_yolov5(const rknn_app_context_t *app_ctx)
+{
+    return app_ctx->io_num.n_output == 3;
+}
+
+static int decode_yolov5(const rknn_app_context_t *app_ctx, void **buffers, float conf_threshold,
+                         std::vector<float> &filterBoxes, std::vector<float> &objProbs, std::vector<int> &classId,
+                         std::vector<float> &extras)
+{
     int validCount = 0;
     int stride = 0;
     int grid_h = 0;
@@ -459,8 +606,6 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
     int model_in_w = app_ctx->model_width;
     int model_in_h = app_ctx->model_height;
 
-    memset(od_results, 0, sizeof(object_detect_result_list));
-
     for (int i = 0; i < 3; i++)
     {
 
@@ -470,7 +615,7 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
         stride = model_in_h / grid_h;
         //RV1106 only support i8
         if (app_ctx->is_quant) {
-            validCount += process_i8_rv1106((int8_t *)(_outputs[i]->virt_addr), (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
+            validCount += process_i8_rv1106((int8_t *)buffers[i], (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
                                      classId, conf_threshold, app_ctx->output_attrs[i].zp, app_ctx->output_attrs[i].scale);
         }
 #elif defined(RKNPU1)
@@ -480,12 +625,12 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
         stride = model_in_h / grid_h;
         if (app_ctx->is_quant)
         {
-            validCount += process_u8((uint8_t *)_outputs[i].buf, (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
+            validCount += process_u8((uint8_t *)buffers[i], (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
                                      classId, conf_threshold, app_ctx->output_attrs[i].zp, app_ctx->output_attrs[i].scale);
         }
         else
         {
-            validCount += process_fp32((float *)_outputs[i].buf, (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
+            validCount += process_fp32((float *)buffers[i], (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
                                        classId, conf_threshold);
         }
 #else
@@ -494,16 +639,678 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
         stride = model_in_h / grid_h;
         if (app_ctx->is_quant)
         {
-            validCount += process_i8((int8_t *)_outputs[i].buf, (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
+            validCount += process_i8((int8_t *)buffers[i], (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
                                      classId, conf_threshold, app_ctx->output_attrs[i].zp, app_ctx->output_attrs[i].scale);
         }
+        else if (app_ctx->is_fp16)
+        {
+            validCount += process_fp16((uint16_t *)buffers[i], (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
+                                       classId, conf_threshold);
+        }
         else
         {
-            validCount += process_fp32((float *)_outputs[i].buf, (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
+            validCount += process_fp32((float *)buffers[i], (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
                                        classId, conf_threshold);
         }
 #endif
     }
+    return validCount;
+}
+
+#define DFL_MAX_LEN 32
+
+static void tensor_chw(const rknn_tensor_attr *attr, int *c, int *h, int *w)
+{
+#if defined(RKNPU1)
+    // NCHW reversed: WHCN
+    *w = attr->dims[0];
+    *h = attr->dims[1];
+    *c = attr->dims[2];
+#else
+    *c = attr->dims[1];
+    *h = attr->dims[2];
+    *w = attr->dims[3];
+#endif
+}
+
+// tensor elements as float, and the scores compared in the tensor type: int8 against the quantized threshold
+static inline float tensor_f32(const int8_t *p, int i, const rknn_tensor_attr *attr)
+{
+    return deqnt_affine_to_f32(p[i], attr->zp, attr->scale);
+}
+static inline float tensor_f32(const uint16_t *p, int i, const rknn_tensor_attr *attr) { return half_to_float(p[i]); }
+static inline float tensor_f32(const float *p, int i, const rknn_tensor_attr *attr) { return p[i]; }
+
+static inline int8_t tensor_value(const int8_t *p, int i) { return p[i]; }
+static inline float tensor_value(const uint16_t *p, int i) { return half_to_float(p[i]); }
+static inline float tensor_value(const float *p, int i) { return p[i]; }
+
+static inline int8_t tensor_threshold(const int8_t *p, float f, const rknn_tensor_attr *attr)
+{
+    return qnt_f32_to_affine(f, attr->zp, attr->scale);
+}
+static inline float tensor_threshold(const uint16_t *p, float f, const rknn_tensor_attr *attr) { return f; }
+static inline float tensor_threshold(const float *p, float f, const rknn_tensor_attr *attr) { return f; }
+
+#ifdef POSTPROCESS_NEON
+// expf of 4 lanes, cephes polynomial after x = n * ln2 + r, within a few ulp on [-87, 88]
+static inline float32x4_t exp_f32x4(float32x4_t x)
+{
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-87.0f)), vdupq_n_f32(88.0f));
+    float32x4_t n = vrndnq_f32(vmulq_n_f32(x, 1.44269504088896341f));
+    float32x4_t r = vfmsq_f32(x, n, vdupq_n_f32(0.693359375f));
+    r = vfmsq_f32(r, n, vdupq_n_f32(-2.12194440e-4f));
+    float32x4_t p = vdupq_n_f32(1.9875691500e-4f);
+    p = vfmaq_f32(vdupq_n_f32(1.3981999507e-3f), p, r);
+    p = vfmaq_f32(vdupq_n_f32(8.3334519073e-3f), p, r);
+    p = vfmaq_f32(vdupq_n_f32(4.1665795894e-2f), p, r);
+    p = vfmaq_f32(vdupq_n_f32(1.6666665459e-1f), p, r);
+    p = vfmaq_f32(vdupq_n_f32(5.0000001201e-1f), p, r);
+    p = vfmaq_f32(vaddq_f32(r, vdupq_n_f32(1.0f)), p, vmulq_f32(r, r));
+    int32x4_t e = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23);
+    return vmulq_f32(p, vreinterpretq_f32_s32(e));
+}
+#endif
+
+// distance of each box side in cells: expectation over the dfl_len bins of its softmax
+static void compute_dfl(const float *bins, int dfl_len, float *dist)
+{
+    for (int b = 0; b < 4; b++)
+    {
+        const float *in = bins + b * dfl_len;
+        int i = 0;
+#ifdef POSTPROCESS_NEON
+        if (dfl_len % 4 == 0)
+        {
+            float32x4_t vmax = vld1q_f32(in);
+            for (i = 4; i < dfl_len; i += 4)
+            {
+                vmax = vmaxq_f32(vmax, vld1q_f32(in + i));
+            }
+            float32x4_t max_val = vdupq_n_f32(vmaxvq_f32(vmax));
+            float32x4_t sum = vdupq_n_f32(0);
+            float32x4_t acc = vdupq_n_f32(0);
+            const float lane_index[4] = {0, 1, 2, 3};
+            float32x4_t index = vld1q_f32(lane_index);
+            for (i = 0; i < dfl_len; i += 4)
+            {
+                float32x4_t e = exp_f32x4(vsubq_f32(vld1q_f32(in + i), max_val));
+                sum = vaddq_f32(sum, e);
+                acc = vfmaq_f32(acc, e, index);
+                index = vaddq_f32(index, vdupq_n_f32(4));
+            }
+            dist[b] = vaddvq_f32(acc) / vaddvq_f32(sum);
+            continue;
+        }
+#endif
+        float max_val = in[0];
+        for (i = 1; i < dfl_len; i++)
+        {
+            max_val = fmaxf(max_val, in[i]);
+        }
+        float sum = 0;
+        float acc = 0;
+        for (i = 0; i < dfl_len; i++)
+        {
+            float e = expf(in[i] - max_val);
+            sum += e;
+            acc += e * i;
+        }
+        dist[b] = acc / sum;
+    }
+}
+
+template <typename T>
+static int process_yolov8_level(const T *box, const rknn_tensor_attr *box_attr, const T *score,
+                                const rknn_tensor_attr *score_attr, const T *score_sum, const rknn_tensor_attr *sum_attr,
+                                int grid_h, int grid_w, int stride, int dfl_len, int num_class,
+                                std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId,
+                                float threshold)
+{
+    int validCount = 0;
+    int grid_len = grid_h * grid_w;
+    auto score_thres = tensor_threshold(score, threshold, score_attr);
+    auto sum_thres = score_sum != NULL ? tensor_threshold(score_sum, threshold, sum_attr) : score_thres;
+    float bins[4 * DFL_MAX_LEN];
+
+    for (int i = 0; i < grid_h; i++)
+    {
+        for (int j = 0; j < grid_w; j++)
+        {
+            int offset = i * grid_w + j;
+            // the scores of all classes add up under the threshold, none of them is over it
+            if (score_sum != NULL && tensor_value(score_sum, offset) < sum_thres)
+            {
+                continue;
+            }
+            int max_class = -1;
+            auto max_score = score_thres;
+            for (int c = 0; c < num_class; c++)
+            {
+                auto s = tensor_value(score, c * grid_len + offset);
+                if (s > max_score)
+                {
+                    max_score = s;
+                    max_class = c;
+                }
+            }
+            if (max_class < 0)
+            {
+                continue;
+            }
+
+            for (int k = 0; k < 4 * dfl_len; k++)
+            {
+                bins[k] = tensor_f32(box, k * grid_len + offset, box_attr);
+            }
+            float dist[4];
+            compute_dfl(bins, dfl_len, dist);
+            float x1 = (-dist[0] + j + 0.5f) * stride;
+            float y1 = (-dist[1] + i + 0.5f) * stride;
+            float x2 = (dist[2] + j + 0.5f) * stride;
+            float y2 = (dist[3] + i + 0.5f) * stride;
+            boxes.push_back(x1);
+            boxes.push_back(y1);
+            boxes.push_back(x2 - x1);
+            boxes.push_back(y2 - y1);
+            objProbs.push_back(tensor_f32(score, max_class * grid_len + offset, score_attr));
+            classId.push_back(max_class);
+            validCount++;
+        }
+    }
+    return validCount;
+}
+
+// YOLOv8 head: 3 levels of box [4 * dfl_len, h, w], score [classes, h, w] and optionally score sum [1, h, w]
+static int match_yolov8(const rknn_app_context_t *app_ctx)
+{
+#if defined(RV1106_1103)
+    // NC1HWC2 outputs, not handled
+    return 0;
+#else
+    int n_output = app_ctx->io_num.n_output;
+    if (n_output != 6 && n_output != 9)
+    {
+        return 0;
+    }
+    int c, h, w;
+    tensor_chw(&app_ctx->output_attrs[0], &c, &h, &w);
+    return c % 4 == 0 && c / 4 <= DFL_MAX_LEN;
+#endif
+}
+
+static int decode_yolov8(const rknn_app_context_t *app_ctx, void **buffers, float conf_threshold,
+                         std::vector<float> &filterBoxes, std::vector<float> &objProbs, std::vector<int> &classId,
+                         std::vector<float> &extras)
+{
+    int validCount = 0;
+    int pair = app_ctx->io_num.n_output / 3;
+    for (int i = 0; i < 3; i++)
+    {
+        const rknn_tensor_attr *box_attr = &app_ctx->output_attrs[i * pair];
+        const rknn_tensor_attr *score_attr = &app_ctx->output_attrs[i * pair + 1];
+        const rknn_tensor_attr *sum_attr = pair == 3 ? &app_ctx->output_attrs[i * pair + 2] : NULL;
+        void *box = buffers[i * pair];
+        void *score = buffers[i * pair + 1];
+        void *score_sum = pair == 3 ? buffers[i * pair + 2] : NULL;
+        int box_c, grid_h, grid_w, num_class, h, w;
+        tensor_chw(box_attr, &box_c, &grid_h, &grid_w);
+        tensor_chw(score_attr, &num_class, &h, &w);
+        // the labels stop at OBJ_CLASS_NUM
+        num_class = num_class < OBJ_CLASS_NUM ? num_class : OBJ_CLASS_NUM;
+        int stride = app_ctx->model_height / grid_h;
+        int dfl_len = box_c / 4;
+        if (app_ctx->is_quant)
+        {
+            validCount += process_yolov8_level((int8_t *)box, box_attr, (int8_t *)score, score_attr, (int8_t *)score_sum,
+                                               sum_attr, grid_h, grid_w, stride, dfl_len, num_class, filterBoxes,
+                                               objProbs, classId, conf_threshold);
+        }
+        else if (app_ctx->is_fp16)
+        {
+            validCount += process_yolov8_level((uint16_t *)box, box_attr, (uint16_t *)score, score_attr,
+                                               (uint16_t *)score_sum, sum_attr, grid_h, grid_w, stride, dfl_len,
+                                               num_class, filterBoxes, objProbs, classId, conf_threshold);
+        }
+        else
+        {
+            validCount += process_yolov8_level((float *)box, box_attr, (float *)score, score_attr, (float *)score_sum,
+                                               sum_attr, grid_h, grid_w, stride, dfl_len, num_class, filterBoxes,
+                                               objProbs, classId, conf_threshold);
+        }
+    }
+    return validCount;
+}
+
+#define SEG_MASK_NUM 32
+
+static float output_f32(const rknn_app_context_t *app_ctx, void *buf, int index, const rknn_tensor_attr *attr)
+{
+    if (app_ctx->is_quant)
+    {
+        return tensor_f32((int8_t *)buf, index, attr);
+    }
+    if (app_ctx->is_fp16)
+    {
+        return tensor_f32((uint16_t *)buf, index, attr);
+    }
+    return tensor_f32((float *)buf, index, attr);
+}
+
+// YOLOv5-seg head: per level box [3 * (5 + classes), h, w] then mask coefficients [3 * 32, h, w], prototypes
+// [32, ph, pw] last; the coefficients of each candidate ride along as its extras
+static int match_yolov5_seg(const rknn_app_context_t *app_ctx)
+{
+#if defined(RV1106_1103) || defined(RKNPU1)
+    return 0;
+#else
+    if (app_ctx->io_num.n_output != 7)
+    {
+        return 0;
+    }
+    int coeff_c, proto_c, h, w;
+    tensor_chw(&app_ctx->output_attrs[1], &coeff_c, &h, &w);
+    tensor_chw(&app_ctx->output_attrs[6], &proto_c, &h, &w);
+    return coeff_c == 3 * SEG_MASK_NUM && proto_c == SEG_MASK_NUM;
+#endif
+}
+
+static int decode_yolov5_seg(const rknn_app_context_t *app_ctx, void **buffers, float conf_threshold,
+                             std::vector<float> &filterBoxes, std::vector<float> &objProbs, std::vector<int> &classId,
+                             std::vector<float> &extras)
+{
+    int validCount = 0;
+    int model_in_w = app_ctx->model_width;
+    int model_in_h = app_ctx->model_height;
+    std::vector<int> cells;
+
+    for (int i = 0; i < 3; i++)
+    {
+        const rknn_tensor_attr *box_attr = &app_ctx->output_attrs[i * 2];
+        const rknn_tensor_attr *coeff_attr = &app_ctx->output_attrs[i * 2 + 1];
+        int box_c, grid_h, grid_w;
+        tensor_chw(box_attr, &box_c, &grid_h, &grid_w);
+        int grid_len = grid_h * grid_w;
+        int stride = model_in_h / grid_h;
+        cells.clear();
+        if (app_ctx->is_quant)
+        {
+            validCount += process_i8((int8_t *)buffers[i * 2], (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride,
+                                     filterBoxes, objProbs, classId, conf_threshold, box_attr->zp, box_attr->scale, &cells);
+        }
+        else if (app_ctx->is_fp16)
+        {
+            validCount += process_fp16((uint16_t *)buffers[i * 2], (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w,
+                                       stride, filterBoxes, objProbs, classId, conf_threshold, &cells);
+        }
+        else
+        {
+            validCount += process_fp32((float *)buffers[i * 2], (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w,
+                                       stride, filterBoxes, objProbs, classId, conf_threshold, &cells);
+        }
+        for (size_t k = 0; k < cells.size(); k++)
+        {
+            int a = cells[k] / grid_len;
+            int pos = cells[k] % grid_len;
+            for (int m = 0; m < SEG_MASK_NUM; m++)
+            {
+                extras.push_back(output_f32(app_ctx, buffers[i * 2 + 1], (a * SEG_MASK_NUM + m) * grid_len + pos, coeff_attr));
+            }
+        }
+    }
+    return validCount;
+}
+
+// mask logits of one object on a crop of the prototypes, coefficients times prototypes with the
+// columns in blocks of 8 held in registers over the 32 channels
+
+// int16 weights: the coefficients over 12 bits, 32 products with the 9 bit prototypes stay in int32; one
+// positive scale for the whole object keeps the sign and the interpolation of the logits
+static void mask_gemm_i8(const int8_t *proto, int32_t zp, int proto_w, int grid_len, const float *coeff, int x0, int y0,
+                         int crop_w, int crop_h, float *out)
+{
+    float max_abs = 0;
+    for (int m = 0; m < SEG_MASK_NUM; m++)
+    {
+        max_abs = fmaxf(max_abs, fabsf(coeff[m]));
+    }
+    if (max_abs == 0)
+    {
+        memset(out, 0, crop_w * crop_h * sizeof(float));
+        return;
+    }
+    int16_t w[SEG_MASK_NUM];
+    for (int m = 0; m < SEG_MASK_NUM; m++)
+    {
+        w[m] = (int16_t)lrintf(coeff[m] * 2047.0f / max_abs);
+    }
+    for (int y = 0; y < crop_h; y++)
+    {
+        const int8_t *row = proto + (y0 + y) * proto_w + x0;
+        float *dst = out + y * crop_w;
+        int x = 0;
+#ifdef POSTPROCESS_NEON
+        int16x8_t vzp = vdupq_n_s16(zp);
+        for (; x + 8 <= crop_w; x += 8)
+        {
+            int32x4_t acc_lo = vdupq_n_s32(0);
+            int32x4_t acc_hi = vdupq_n_s32(0);
+            for (int m = 0; m < SEG_MASK_NUM; m++)
+            {
+                int16x8_t v = vsubq_s16(vmovl_s8(vld1_s8(row + m * grid_len + x)), vzp);
+                acc_lo = vmlal_n_s16(acc_lo, vget_low_s16(v), w[m]);
+                acc_hi = vmlal_n_s16(acc_hi, vget_high_s16(v), w[m]);
+            }
+            vst1q_f32(dst + x, vcvtq_f32_s32(acc_lo));
+            vst1q_f32(dst + x + 4, vcvtq_f32_s32(acc_hi));
+        }
+#endif
+        for (; x < crop_w; x++)
+        {
+            int32_t acc = 0;
+            for (int m = 0; m < SEG_MASK_NUM; m++)
+            {
+                acc += w[m] * (row[m * grid_len + x] - zp);
+            }
+            dst[x] = acc;
+        }
+    }
+}
+
+static void mask_gemm_f16(const uint16_t *proto, int proto_w, int grid_len, const float *coeff, int x0, int y0,
+                          int crop_w, int crop_h, float *out)
+{
+    for (int y = 0; y < crop_h; y++)
+    {
+        const uint16_t *row = proto + (y0 + y) * proto_w + x0;
+        float *dst = out + y * crop_w;
+        int x = 0;
+#ifdef POSTPROCESS_NEON
+        for (; x + 8 <= crop_w; x += 8)
+        {
+            float32x4_t acc_lo = vdupq_n_f32(0);
+            float32x4_t acc_hi = vdupq_n_f32(0);
+            for (int m = 0; m < SEG_MASK_NUM; m++)
+            {
+                float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(row + m * grid_len + x));
+                acc_lo = vfmaq_n_f32(acc_lo, vcvt_f32_f16(vget_low_f16(h)), coeff[m]);
+                acc_hi = vfmaq_n_f32(acc_hi, vcvt_high_f32_f16(h), coeff[m]);
+            }
+            vst1q_f32(dst + x, acc_lo);
+            vst1q_f32(dst + x + 4, acc_hi);
+        }
+#endif
+        for (; x < crop_w; x++)
+        {
+            float acc = 0;
+            for (int m = 0; m < SEG_MASK_NUM; m++)
+            {
+                acc += coeff[m] * half_to_float(row[m * grid_len + x]);
+            }
+            dst[x] = acc;
+        }
+    }
+}
+
+static void mask_gemm_f32(const float *proto, int proto_w, int grid_len, const float *coeff, int x0, int y0, int crop_w,
+                          int crop_h, float *out)
+{
+    for (int y = 0; y < crop_h; y++)
+    {
+        const float *row = proto + (y0 + y) * proto_w + x0;
+        float *dst = out + y * crop_w;
+        int x = 0;
+#ifdef POSTPROCESS_NEON
+        for (; x + 8 <= crop_w; x += 8)
+        {
+            float32x4_t acc_lo = vdupq_n_f32(0);
+            float32x4_t acc_hi = vdupq_n_f32(0);
+            for (int m = 0; m < SEG_MASK_NUM; m++)
+            {
+                acc_lo = vfmaq_n_f32(acc_lo, vld1q_f32(row + m * grid_len + x), coeff[m]);
+                acc_hi = vfmaq_n_f32(acc_hi, vld1q_f32(row + m * grid_len + x + 4), coeff[m]);
+            }
+            vst1q_f32(dst + x, acc_lo);
+            vst1q_f32(dst + x + 4, acc_hi);
+        }
+#endif
+        for (; x < crop_w; x++)
+        {
+            float acc = 0;
+            for (int m = 0; m < SEG_MASK_NUM; m++)
+            {
+                acc += coeff[m] * row[m * grid_len + x];
+            }
+            dst[x] = acc;
+        }
+    }
+}
+
+// prototype coordinate of each source pixel along one axis, relative to the crop and clamped inside it
+static void mask_taps(int start, int count, float scale, float pad, float cells_per_px, int crop_origin, int crop_len,
+                      std::vector<int> &index, std::vector<float> &weight)
+{
+    index.resize(count);
+    weight.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        float u = ((start + i + 0.5f) * scale + pad) * cells_per_px - 0.5f - crop_origin;
+        u = fminf(fmaxf(u, 0.0f), (float)(crop_len - 1));
+        index[i] = (int)u;
+        weight[i] = u - index[i];
+    }
+}
+
+static void mask_push_run(seg_mask_list_t *masks, int k, uint32_t run)
+{
+    if (masks == NULL || masks->run_count[k] < 0)
+    {
+        return;
+    }
+    if (masks->used >= SEG_MAX_RUNS)
+    {
+        // pool full, this mask is dropped and its area kept
+        masks->used -= masks->run_count[k];
+        masks->run_count[k] = -1;
+        return;
+    }
+    masks->runs[masks->used++] = run;
+    masks->run_count[k]++;
+}
+
+// logits upsampled to the source pixels of the box, object where they are over 0 (sigmoid over 0.5)
+static int mask_encode(const float *logits, int crop_w, int crop_h, int crop_x, int crop_y, float cells_x, float cells_y,
+                       const image_rect_t *box, const letterbox_t *letter_box, seg_mask_list_t *masks, int k)
+{
+    int box_w = box->right - box->left;
+    int box_h = box->bottom - box->top;
+    std::vector<int> col_index, row_index;
+    std::vector<float> col_weight, row_weight;
+    mask_taps(box->left, box_w, letter_box->scale, letter_box->x_pad, cells_x, crop_x, crop_w, col_index, col_weight);
+    mask_taps(box->top, box_h, letter_box->scale, letter_box->y_pad, cells_y, crop_y, crop_h, row_index, row_weight);
+    std::vector<float> row(crop_w);
+
+    int area = 0;
+    bool inside = false;
+    uint32_t run = 0;
+    for (int y = 0; y < box_h; y++)
+    {
+        // vertical taps once per crop column, the horizontal ones per pixel
+        const float *a = logits + row_index[y] * crop_w;
+        const float *b = row_index[y] + 1 < crop_h ? a + crop_w : a;
+        float wy = row_weight[y];
+        for (int c = 0; c < crop_w; c++)
+        {
+            row[c] = a[c] + wy * (b[c] - a[c]);
+        }
+        for (int x = 0; x < box_w; x++)
+        {
+            int c = col_index[x];
+            float right = c + 1 < crop_w ? row[c + 1] : row[c];
+            bool object = row[c] + col_weight[x] * (right - row[c]) > 0;
+            if (object != inside)
+            {
+                mask_push_run(masks, k, run);
+                inside = object;
+                run = 0;
+            }
+            run++;
+            area += object;
+        }
+    }
+    mask_push_run(masks, k, run);
+    return area;
+}
+
+static void assemble_yolov5_seg(const rknn_app_context_t *app_ctx, void **buffers, const float *extras,
+                                const int *candidates, const letterbox_t *letter_box,
+                                object_detect_result_list *od_results)
+{
+    const rknn_tensor_attr *proto_attr = &app_ctx->output_attrs[6];
+    void *proto = buffers[6];
+    int proto_c, proto_h, proto_w;
+    tensor_chw(proto_attr, &proto_c, &proto_h, &proto_w);
+    int grid_len = proto_h * proto_w;
+    // prototype cells per model input pixel
+    float cells_x = (float)proto_w / app_ctx->model_width;
+    float cells_y = (float)proto_h / app_ctx->model_height;
+    seg_mask_list_t *masks = app_ctx->masks;
+    std::vector<float> logits;
+
+    for (int k = 0; k < od_results->count; k++)
+    {
+        object_detect_result *res = &od_results->results[k];
+        if (masks != NULL)
+        {
+            masks->count = k + 1;
+            masks->run_start[k] = masks->used;
+            masks->run_count[k] = 0;
+        }
+        if (res->box.right <= res->box.left || res->box.bottom <= res->box.top)
+        {
+            continue;
+        }
+        // the box in prototype cells, one more on each side for the bilinear taps
+        float x0 = (res->box.left * letter_box->scale + letter_box->x_pad) * cells_x;
+        float y0 = (res->box.top * letter_box->scale + letter_box->y_pad) * cells_y;
+        float x1 = (res->box.right * letter_box->scale + letter_box->x_pad) * cells_x;
+        float y1 = (res->box.bottom * letter_box->scale + letter_box->y_pad) * cells_y;
+        int crop_x = clamp(floorf(x0) - 1, 0, proto_w - 1);
+        int crop_y = clamp(floorf(y0) - 1, 0, proto_h - 1);
+        int crop_w = clamp(ceilf(x1) + 1, crop_x + 1, proto_w) - crop_x;
+        int crop_h = clamp(ceilf(y1) + 1, crop_y + 1, proto_h) - crop_y;
+        logits.resize(crop_w * crop_h);
+
+        const float *coeff = extras + candidates[k] * SEG_MASK_NUM;
+        if (app_ctx->is_quant)
+        {
+            mask_gemm_i8((int8_t *)proto, proto_attr->zp, proto_w, grid_len, coeff, crop_x, crop_y, crop_w, crop_h,
+                         logits.data());
+        }
+        else if (app_ctx->is_fp16)
+        {
+            mask_gemm_f16((uint16_t *)proto, proto_w, grid_len, coeff, crop_x, crop_y, crop_w, crop_h, logits.data());
+        }
+        else
+        {
+            mask_gemm_f32((float *)proto, proto_w, grid_len, coeff, crop_x, crop_y, crop_w, crop_h, logits.data());
+        }
+        res->mask_area = mask_encode(logits.data(), crop_w, crop_h, crop_x, crop_y, cells_x, cells_y, &res->box,
+                                     letter_box, masks, k);
+    }
+}
+
+static const post_decoder_t yolov5_decoder = {"yolov5", match_yolov5, decode_yolov5, NULL};
+static const post_decoder_t yolov8_decoder = {"yolov8", match_yolov8, decode_yolov8, NULL};
+static const post_decoder_t yolov5_seg_decoder = {"yolov5-seg", match_yolov5_seg, decode_yolov5_seg,
+                                                  assemble_yolov5_seg};
+static const post_decoder_t *decoders[POST_MAX_DECODERS] = {&yolov5_decoder, &yolov8_decoder, &yolov5_seg_decoder};
+static int num_decoders = 3;
+
+int register_post_decoder(const post_decoder_t *decoder)
+{
+    if (num_decoders >= POST_MAX_DECODERS)
+    {
+        printf("too many post decoders, %s not registered\n", decoder->name);
+        return -1;
+    }
+    // tried first, it can take over the layout of a built in one
+    for (int i = num_decoders; i > 0; i--)
+    {
+        decoders[i] = decoders[i - 1];
+    }
+    decoders[0] = decoder;
+    num_decoders++;
+    return 0;
+}
+
+const post_decoder_t *find_post_decoder(const rknn_app_context_t *app_ctx)
+{
+    for (int i = 0; i < num_decoders; i++)
+    {
+        if (decoders[i]->match(app_ctx))
+        {
+            return decoders[i];
+        }
+    }
+    return NULL;
+}
+
+int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter_box, float conf_threshold, float nms_threshold, object_detect_result_list *od_results)
+{
+#if defined(RV1106_1103) 
+    rknn_tensor_mem **_outputs = (rknn_tensor_mem **)outputs;
+#else
+    rknn_output *_outputs = (rknn_output *)outputs;
+#endif
+    post_outputs_t buffers;
+    buffers.count = app_ctx->io_num.n_output < POST_MAX_OUTPUTS ? app_ctx->io_num.n_output : POST_MAX_OUTPUTS;
+    for (int i = 0; i < buffers.count; i++)
+    {
+#if defined(RV1106_1103) 
+        buffers.buf[i] = _outputs[i]->virt_addr;
+        buffers.size[i] = _outputs[i]->size;
+#else
+        buffers.buf[i] = _outputs[i].buf;
+        buffers.size[i] = _outputs[i].size;
+#endif
+    }
+    if (app_ctx->record_path != NULL)
+    {
+        save_post_outputs(app_ctx->record_path, app_ctx, &buffers);
+        app_ctx->record_path = NULL;
+    }
+    return post_process_buffers(app_ctx, buffers.buf, letter_box, conf_threshold, nms_threshold, od_results);
+}
+
+int post_process_buffers(rknn_app_context_t *app_ctx, void **buffers, letterbox_t *letter_box, float conf_threshold,
+                         float nms_threshold, object_detect_result_list *od_results)
+{
+    std::vector<float> filterBoxes;
+    std::vector<float> objProbs;
+    std::vector<int> classId;
+    std::vector<float> extras;
+    std::vector<int> kept;
+    int model_in_w = app_ctx->model_width;
+    int model_in_h = app_ctx->model_height;
+
+    memset(od_results, 0, sizeof(object_detect_result_list));
+    if (app_ctx->masks != NULL)
+    {
+        app_ctx->masks->count = 0;
+        app_ctx->masks->used = 0;
+    }
+
+    if (app_ctx->decoder == NULL)
+    {
+        app_ctx->decoder = find_post_decoder(app_ctx);
+        if (app_ctx->decoder == NULL)
+        {
+            printf("no post decoder for %d outputs\n", app_ctx->io_num.n_output);
+            return -1;
+        }
+    }
+    int validCount = app_ctx->decoder->decode(app_ctx, buffers, conf_threshold, filterBoxes, objProbs, classId, extras);
 
     // no object detect
     if (validCount <= 0)
@@ -549,19 +1356,133 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
         od_results->results[last_count].box.bottom = (int)(clamp(y2, 0, model_in_h) / letter_box->scale);
         od_results->results[last_count].prop = obj_conf;
         od_results->results[last_count].cls_id = id;
+        kept.push_back(n);
         last_count++;
     }
     od_results->count = last_count;
+
+    // masks and the like only for the boxes that made it through NMS
+    if (app_ctx->decoder->assemble != NULL && last_count > 0)
+    {
+        app_ctx->decoder->assemble(app_ctx, buffers, extras.data(), kept.data(), letter_box, od_results);
+    }
     return 0;
 }
 
-int init_post_process()
+#define POST_RECORD_MAGIC 0x52505052 // "RPPR"
+
+typedef struct {
+    uint32_t magic;
+    int32_t model_width;
+    int32_t model_height;
+    int32_t is_quant;
+    int32_t is_fp16;
+    int32_t count;
+} post_record_header_t;
+
+int save_post_outputs(const char *path, const rknn_app_context_t *app_ctx, const post_outputs_t *outputs)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        printf("open %s fail!\n", path);
+        return -1;
+    }
+    post_record_header_t header = {POST_RECORD_MAGIC, app_ctx->model_width, app_ctx->model_height, app_ctx->is_quant,
+                                   app_ctx->is_fp16, outputs->count};
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (int i = 0; ok && i < outputs->count; i++)
+    {
+        ok = fwrite(&app_ctx->output_attrs[i], sizeof(rknn_tensor_attr), 1, fp) == 1 &&
+             fwrite(&outputs->size[i], sizeof(uint32_t), 1, fp) == 1 &&
+             fwrite(outputs->buf[i], 1, outputs->size[i], fp) == outputs->size[i];
+    }
+    fclose(fp);
+    if (!ok)
+    {
+        printf("write %s fail!\n", path);
+        return -1;
+    }
+    printf("post process outputs recorded to %s\n", path);
+    return 0;
+}
+
+int load_post_outputs(const char *path, rknn_app_context_t *app_ctx, post_outputs_t *outputs)
+{
+    memset(outputs, 0, sizeof(post_outputs_t));
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        printf("open %s fail!\n", path);
+        return -1;
+    }
+    post_record_header_t header;
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 && header.magic == POST_RECORD_MAGIC && header.count > 0 &&
+              header.count <= POST_MAX_OUTPUTS;
+    if (ok)
+    {
+        app_ctx->model_width = header.model_width;
+        app_ctx->model_height = header.model_height;
+        app_ctx->is_quant = header.is_quant;
+        app_ctx->is_fp16 = header.is_fp16;
+        app_ctx->io_num.n_output = header.count;
+        app_ctx->output_attrs = (rknn_tensor_attr *)calloc(header.count, sizeof(rknn_tensor_attr));
+        ok = app_ctx->output_attrs != NULL;
+    }
+    // the decoders index the tensors by their attrs, a size that does not match would read past them
+    uint32_t elem_size = header.is_quant ? 1 : (header.is_fp16 ? 2 : 4);
+    for (int i = 0; ok && i < header.count; i++)
+    {
+        uint32_t size;
+        rknn_tensor_attr *attr = &app_ctx->output_attrs[i];
+        ok = fread(attr, sizeof(rknn_tensor_attr), 1, fp) == 1 && fread(&size, sizeof(uint32_t), 1, fp) == 1;
+        if (ok && (uint64_t)attr->n_elems * elem_size != size)
+        {
+            printf("%s: output %d holds %u bytes, %u elements of %u bytes expected\n", path, i, size, attr->n_elems,
+                   elem_size);
+            ok = false;
+        }
+        if (ok)
+        {
+            outputs->buf[i] = malloc(size);
+            outputs->size[i] = size;
+            outputs->count = i + 1;
+            ok = outputs->buf[i] != NULL && fread(outputs->buf[i], 1, size, fp) == size;
+        }
+    }
+    fclose(fp);
+    if (!ok)
+    {
+        printf("%s is not a post process record\n", path);
+        free_post_outputs(app_ctx, outputs);
+        return -1;
+    }
+    return 0;
+}
+
+void free_post_outputs(rknn_app_context_t *app_ctx, post_outputs_t *outputs)
+{
+    for (int i = 0; i < outputs->count; i++)
+    {
+        free(outputs->buf[i]);
+        outputs->buf[i] = NULL;
+    }
+    outputs->count = 0;
+    free(app_ctx->output_attrs);
+    app_ctx->output_attrs = NULL;
+}
+
+int init_post_process(const char *label_path)
 {
     int ret = 0;
-    ret = loadLabelName(LABEL_NALE_TXT_PATH, labels);
+    if (label_path == NULL)
+    {
+        label_path = LABEL_NALE_TXT_PATH;
+    }
+    ret = loadLabelName(label_path, labels);
     if (ret < 0)
     {
-        printf("Load %s failed!\n", LABEL_NALE_TXT_PATH);
+        printf("Load %s failed!\n", label_path);
         return -1;
     }
     return 0;
@@ -594,87 +1515,3 @@ void deinit_post_process()
         }
     }
 }
-
-void yuyv_to_rgb(unsigned char *yuv, unsigned char *rgb, int width, int height)
-{
-    unsigned int i;
-    unsigned char *y0 = yuv + 0;
-    unsigned char *u0 = yuv + 1;
-    unsigned char *y1 = yuv + 2;
-    unsigned char *v0 = yuv + 3;
-
-    unsigned char *r0 = rgb + 0;
-    unsigned char *g0 = rgb + 1;
-    unsigned char *b0 = rgb + 2;
-    unsigned char *r1 = rgb + 3;
-    unsigned char *g1 = rgb + 4;
-    unsigned char *b1 = rgb + 5;
-
-    float rt0 = 0, gt0 = 0, bt0 = 0, rt1 = 0, gt1 = 0, bt1 = 0;
-
-    for (i = 0; i <= (width * height) / 2; i++)
-    {
-        bt0 = 1.164 * (*y0 - 16) + 2.018 * (*u0 - 128);
-        gt0 = 1.164 * (*y0 - 16) - 0.813 * (*v0 - 128) - 0.394 * (*u0 - 128);
-        rt0 = 1.164 * (*y0 - 16) + 1.596 * (*v0 - 128);
-
-        bt1 = 1.164 * (*y1 - 16) + 2.018 * (*u0 - 128);
-        gt1 = 1.164 * (*y1 - 16) - 0.813 * (*v0 - 128) - 0.394 * (*u0 - 128);
-        rt1 = 1.164 * (*y1 - 16) + 1.596 * (*v0 - 128);
-
-        if (rt0 > 250)
-            rt0 = 255;
-        if (rt0 < 0)
-            rt0 = 0;
-
-        if (gt0 > 250)
-            gt0 = 255;
-        if (gt0 < 0)
-            gt0 = 0;
-
-        if (bt0 > 250)
-            bt0 = 255;
-        if (bt0 < 0)
-            bt0 = 0;
-
-        if (rt1 > 250)
-            rt1 = 255;
-        if (rt1 < 0)
-            rt1 = 0;
-
-        if (gt1 > 250)
-            gt1 = 255;
-        if (gt1 < 0)
-            gt1 = 0;
-
-        if (bt1 > 250)
-            bt1 = 255;
-        if (bt1 < 0)
-            bt1 = 0;
-
-        *r0 = (unsigned char)rt0;
-        *g0 = (unsigned char)gt0;
-        *b0 = (unsigned char)bt0;
-
-        *r1 = (unsigned char)rt1;
-        *g1 = (unsigned char)gt1;
-        *b1 = (unsigned char)bt1;
-
-        yuv = yuv + 4;
-        rgb = rgb + 6;
-        if (yuv == NULL)
-            break;
-
-        y0 = yuv;
-        u0 = yuv + 1;
-        y1 = yuv + 2;
-        v0 = yuv + 3;
-
-        r0 = rgb + 0;
-        g0 = rgb + 1;
-        b0 = rgb + 2;
-        r1 = rgb + 3;
-        g1 = rgb + 4;
-        b1 = rgb + 5;
-    }
-}
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+
+#include "im2d.h"
+#include "rga.h"
+
+#include "rga_job.h"
+#include "rga_scheduler.h"
+
+int rga_import_image(image_buffer_t *image, int format)
+{
+    im_handle_param_t param;
+    param.width = get_image_width_stride(image);
+    param.height = get_image_height_stride(image);
+    param.format = format;
+    if (image->fd > 0)
+    {
+        return importbuffer_fd(image->fd, &param);
+    }
+    return importbuffer_virtualaddr(image->virt_addr, &param);
+}
+
+static void release_job(rga_job_t *job)
+{
+    if (job->fence_fd >= 0)
+    {
+        close(job->fence_fd);
+        job->fence_fd = -1;
+    }
+    if (job->src_handle > 0)
+    {
+        releasebuffer_handle(job->src_handle);
+        job->src_handle = 0;
+    }
+    if (job->dst_handle > 0)
+    {
+        releasebuffer_handle(job->dst_handle);
+        job->dst_handle = 0;
+    }
+    if (job->core >= 0)
+    {
+        rga_scheduler_release(job->core);
+        job->core = -1;
+    }
+}
+
+static int convert_image_rga_async(image_buffer_t *src_img, image_buffer_t *dst_img, image_rect_t *src_box,
+                                   image_rect_t *dst_box, char color, int fill_pad, rga_job_t *job)
+{
+    int srcFmt = get_rga_fmt(src_img->format);
+    int dstFmt = get_rga_fmt(dst_img->format);
+    if (srcFmt < 0 || dstFmt < 0)
+    {
+        return -1;
+    }
+
+    im_rect srect = {0, 0, src_img->width, src_img->height};
+    im_rect drect = {0, 0, dst_img->width, dst_img->height};
+    im_rect prect;
+    memset(&prect, 0, sizeof(im_rect));
+    if (src_box != NULL)
+    {
+        srect.x = src_box->left;
+        srect.y = src_box->top;
+        srect.width = src_box->right - src_box->left + 1;
+        srect.height = src_box->bottom - src_box->top + 1;
+    }
+    if (dst_box != NULL)
+    {
+        drect.x = dst_box->left;
+        drect.y = dst_box->top;
+        drect.width = dst_box->right - dst_box->left + 1;
+        drect.height = dst_box->bottom - dst_box->top + 1;
+    }
+
+    rga_sched_request_t request;
+    request.src_format = src_img->format;
+    request.dst_format = dst_img->format;
+    request.src_width = srect.width;
+    request.src_height = srect.height;
+    request.dst_width = drect.width;
+    request.dst_height = drect.height;
+    int im_core = rga_scheduler_acquire(&request, &job->core);
+    if (im_core < 0)
+    {
+        printf("no rga core supports fmt %d->%d %dx%d->%dx%d\n", src_img->format, dst_img->format,
+               srect.width, srect.height, drect.width, drect.height);
+        return -1;
+    }
+
+    job->src_handle = rga_import_image(src_img, srcFmt);
+    job->dst_handle = rga_import_image(dst_img, dstFmt);
+    if (job->src_handle <= 0 || job->dst_handle <= 0)
+    {
+        printf("rga import handle error src=%d dst=%d\n", job->src_handle, job->dst_handle);
+        release_job(job);
+        return -1;
+    }
+    rga_buffer_t rga_buf_src = wrapbuffer_handle(job->src_handle, src_img->width, src_img->height, srcFmt,
+                                                 get_image_width_stride(src_img), get_image_height_stride(src_img));
+    rga_buffer_t rga_buf_dst = wrapbuffer_handle(job->dst_handle, dst_img->width, dst_img->height, dstFmt,
+                                                 get_image_width_stride(dst_img), get_image_height_stride(dst_img));
+    rga_buffer_t pat;
+    memset(&pat, 0, sizeof(rga_buffer_t));
+
+    im_opt_t opt;
+    memset(&opt, 0, sizeof(im_opt_t));
+    opt.core = im_core;
+
+    // fill and scale are queued in one job so the RGA orders them itself
+    im_job_handle_t job_handle = imbeginJob();
+    if (job_handle <= 0)
+    {
+        printf("imbeginJob fail\n");
+        release_job(job);
+        return -1;
+    }
+
+    IM_STATUS ret_rga = IM_STATUS_SUCCESS;
+    if (fill_pad && (drect.width != dst_img->width || drect.height != dst_img->height))
+    {
+        im_rect dst_whole_rect = {0, 0, dst_img->width, dst_img->height};
+        uint32_t imcolor;
+        char *p_imcolor = (char *)&imcolor;
+        p_imcolor[0] = color;
+        p_imcolor[1] = color;
+        p_imcolor[2] = color;
+        p_imcolor[3] = color;
+        if (rga_scheduler_core_can_fill(job->core))
+        {
+            ret_rga = imfillTask(job_handle, rga_buf_dst, dst_whole_rect, imcolor);
+        }
+        else
+        {
+            ret_rga = IM_STATUS_NOT_SUPPORTED;
+        }
+        if (ret_rga <= 0)
+        {
+            // RGA can not fill, pad on cpu before the scale is queued
+            if (dst_img->virt_addr != NULL)
+            {
+                memset(dst_img->virt_addr, color, get_image_size(dst_img));
+            }
+            else
+            {
+                printf("Warning: Can not fill color on target image\n");
+            }
+        }
+    }
+
+    ret_rga = improcessTask(job_handle, rga_buf_src, rga_buf_dst, pat, srect, drect, prect, &opt, 0);
+    if (ret_rga <= 0)
+    {
+        printf("Error on improcessTask STATUS=%d\n", ret_rga);
+        printf("RGA error message: %s\n", imStrError((IM_STATUS)ret_rga));
+        imcancelJob(job_handle);
+        release_job(job);
+        return -1;
+    }
+
+    ret_rga = imendJob(job_handle, IM_ASYNC, -1, &job->fence_fd);
+    if (ret_rga <= 0)
+    {
+        printf("Error on imendJob STATUS=%d\n", ret_rga);
+        job->fence_fd = -1;
+        release_job(job);
+        return -1;
+    }
+    return 0;
+}
+
+static void reset_job(rga_job_t *job)
+{
+    memset(job, 0, sizeof(rga_job_t));
+    job->fence_fd = -1;
+    job->core = -1;
+}
+
+int convert_image_async(image_buffer_t *src_image, image_buffer_t *dst_image, image_rect_t *src_box, image_rect_t *dst_box,
+                        char color, rga_job_t *job)
+{
+    reset_job(job);
+    int ret = convert_image_rga_async(src_image, dst_image, src_box, dst_box, color, 1, job);
+    if (ret != 0)
+    {
+        // already completed when we return, fence_fd stays -1
+        ret = convert_image(src_image, dst_image, src_box, dst_box, color);
+    }
+    job->status = ret;
+    return ret;
+}
+
+int convert_image_with_letterbox_plan_async(image_buffer_t *src_image, image_buffer_t *dst_image, letterbox_plan_t *plan,
+                                            rga_job_t *job)
+{
+    reset_job(job);
+    if (!letterbox_plan_match(plan, src_image, dst_image))
+    {
+        printf("letterbox plan does not match image %dx%d->%dx%d\n",
+               src_image->width, src_image->height, dst_image->width, dst_image->height);
+        return -1;
+    }
+    if (dst_image->virt_addr == NULL && dst_image->fd <= 0)
+    {
+        printf("letterbox target image is not allocated\n");
+        return -1;
+    }
+
+    int fill_pad = letterbox_plan_begin_fill(plan, dst_image);
+    int ret = convert_image_rga_async(src_image, dst_image, &plan->src_box, &plan->dst_box, plan->color, fill_pad, job);
+    if (ret != 0)
+    {
+        if (fill_pad)
+        {
+            plan->pad_filled = 0;
+        }
+        ret = convert_image_with_letterbox_plan(src_image, dst_image, plan);
+    }
+    job->status = ret;
+    return ret;
+}
+
+int rga_job_wait(rga_job_t *job, int timeout_ms)
+{
+    if (job->fence_fd >= 0)
+    {
+        struct pollfd pfd;
+        pfd.fd = job->fence_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret;
+        do
+        {
+            ret = poll(&pfd, 1, timeout_ms);
+        } while (ret < 0 && errno == EINTR);
+        if (ret == 0)
+        {
+            return 1;
+        }
+        if (ret < 0 || (pfd.revents & (POLLERR | POLLNVAL)))
+        {
+            printf("rga fence %d wait error: %s\n", job->fence_fd, strerror(errno));
+            job->status = -1;
+        }
+    }
+    release_job(job);
+    return job->status;
+}
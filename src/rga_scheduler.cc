@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <mutex>
+
+#include "im2d.h"
+
+#include "rga_scheduler.h"
+
+#define FMT_BIT(fmt) (1 << (fmt))
+
+typedef struct {
+    const char *name;
+    int im_core;
+    unsigned int src_formats;
+    unsigned int dst_formats;
+    int can_fill;
+    int min_width;
+    int min_height;
+    // scale limit, both directions
+    int max_scale;
+} rga_core_caps_t;
+
+// Format and size limits from the RGA user guide, RGA3 has no color fill,
+// no gray format and no packed YUV output.
+static const rga_core_caps_t core_caps[RGA_SCHED_CORE_NUM] = {
+    {"rga3_core0", IM_SCHEDULER_RGA3_CORE0,
+     FMT_BIT(IMAGE_FORMAT_RGB888) | FMT_BIT(IMAGE_FORMAT_RGBA8888) | FMT_BIT(IMAGE_FORMAT_YUV420SP_NV12) |
+         FMT_BIT(IMAGE_FORMAT_YUV420SP_NV21) | FMT_BIT(IMAGE_FORMAT_YUYV_422),
+     FMT_BIT(IMAGE_FORMAT_RGB888) | FMT_BIT(IMAGE_FORMAT_RGBA8888) | FMT_BIT(IMAGE_FORMAT_YUV420SP_NV12) |
+         FMT_BIT(IMAGE_FORMAT_YUV420SP_NV21),
+     0, 68, 2, 8},
+    {"rga3_core1", IM_SCHEDULER_RGA3_CORE1,
+     FMT_BIT(IMAGE_FORMAT_RGB888) | FMT_BIT(IMAGE_FORMAT_RGBA8888) | FMT_BIT(IMAGE_FORMAT_YUV420SP_NV12) |
+         FMT_BIT(IMAGE_FORMAT_YUV420SP_NV21) | FMT_BIT(IMAGE_FORMAT_YUYV_422),
+     FMT_BIT(IMAGE_FORMAT_RGB888) | FMT_BIT(IMAGE_FORMAT_RGBA8888) | FMT_BIT(IMAGE_FORMAT_YUV420SP_NV12) |
+         FMT_BIT(IMAGE_FORMAT_YUV420SP_NV21),
+     0, 68, 2, 8},
+    {"rga2_core0", IM_SCHEDULER_RGA2_CORE0,
+     0xffffffff,
+     0xffffffff,
+     1, 2, 2, 16},
+};
+
+#if defined(TARGET_SOC_RK3588)
+static const int first_core = RGA_SCHED_RGA3_CORE0;
+#else
+static const int first_core = RGA_SCHED_RGA2_CORE0;
+#endif
+
+static std::mutex sched_mutex;
+static int queue_depth[RGA_SCHED_CORE_NUM];
+static unsigned long long job_count[RGA_SCHED_CORE_NUM];
+static int last_core = -1;
+
+static int core_supports(const rga_core_caps_t *caps, const rga_sched_request_t *req)
+{
+    if (!(caps->src_formats & FMT_BIT(req->src_format)) || !(caps->dst_formats & FMT_BIT(req->dst_format)))
+    {
+        return 0;
+    }
+    if (req->src_width < caps->min_width || req->src_height < caps->min_height ||
+        req->dst_width < caps->min_width || req->dst_height < caps->min_height)
+    {
+        return 0;
+    }
+    if (req->src_width > req->dst_width * caps->max_scale || req->dst_width > req->src_width * caps->max_scale ||
+        req->src_height > req->dst_height * caps->max_scale || req->dst_height > req->src_height * caps->max_scale)
+    {
+        return 0;
+    }
+    return 1;
+}
+
+static int core_supports_all(const rga_core_caps_t *caps, const rga_sched_request_t *requests, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (!core_supports(caps, &requests[i]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int rga_scheduler_acquire(const rga_sched_request_t *request, int *core)
+{
+    return rga_scheduler_acquire_batch(request, 1, core);
+}
+
+int rga_scheduler_acquire_batch(const rga_sched_request_t *requests, int count, int *core)
+{
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    int best = -1;
+    int span = RGA_SCHED_CORE_NUM - first_core;
+    // start after the last used core so equal depths rotate
+    int start = last_core < first_core ? 0 : last_core - first_core + 1;
+    for (int n = 0; n < span; n++)
+    {
+        int i = first_core + (start + n) % span;
+        if (!core_supports_all(&core_caps[i], requests, count))
+        {
+            continue;
+        }
+        if (best < 0 || queue_depth[i] < queue_depth[best])
+        {
+            best = i;
+        }
+    }
+    if (best < 0)
+    {
+        *core = -1;
+        return -1;
+    }
+    queue_depth[best]++;
+    job_count[best]++;
+    last_core = best;
+    *core = best;
+    // single core SoC, keep the driver default
+    if (first_core == RGA_SCHED_RGA2_CORE0)
+    {
+        return 0;
+    }
+    return core_caps[best].im_core;
+}
+
+void rga_scheduler_release(int core)
+{
+    if (core < 0 || core >= RGA_SCHED_CORE_NUM)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    if (queue_depth[core] > 0)
+    {
+        queue_depth[core]--;
+    }
+}
+
+int rga_scheduler_core_can_fill(int core)
+{
+    if (core < 0 || core >= RGA_SCHED_CORE_NUM)
+    {
+        return 1;
+    }
+    return core_caps[core].can_fill;
+}
+
+int rga_scheduler_queue_depth(int core)
+{
+    if (core < 0 || core >= RGA_SCHED_CORE_NUM)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    return queue_depth[core];
+}
+
+void rga_scheduler_dump()
+{
+    std::lock_guard<std::mutex> lock(sched_mutex);
+    for (int i = first_core; i < RGA_SCHED_CORE_NUM; i++)
+    {
+        printf("%s: depth=%d jobs=%llu\n", core_caps[i].name, queue_depth[i], job_count[i]);
+    }
+}
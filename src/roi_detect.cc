@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "roi_detect.h"
+
+#define ROI_BG_COLOR 114
+
+int init_roi_detector(roi_detector_t *det, rknn_app_context_t *app_ctx, int num_threads)
+{
+    memset(det, 0, sizeof(roi_detector_t));
+    det->num_threads = num_threads;
+    det->inputs[0].job.fence_fd = -1;
+    det->inputs[1].job.fence_fd = -1;
+    if (init_yolov5_input(app_ctx, &det->inputs[0]) != 0 || init_yolov5_input(app_ctx, &det->inputs[1]) != 0)
+    {
+        release_roi_detector(det);
+        return -1;
+    }
+    return 0;
+}
+
+void release_roi_detector(roi_detector_t *det)
+{
+    release_yolov5_input(&det->inputs[0]);
+    release_yolov5_input(&det->inputs[1]);
+    release_letterbox_plan(&det->plans[0]);
+    release_letterbox_plan(&det->plans[1]);
+}
+
+int roi_detector_crop_size(roi_detector_t *det, rknn_app_context_t *app_ctx, int width, int height, int *roi_width,
+                           int *roi_height)
+{
+    if (width != det->width || height != det->height)
+    {
+        det->width = 0;
+        det->height = 0;
+        det->roi_width = std::min(app_ctx->model_width, width) & ~1;
+        det->roi_height = std::min(app_ctx->model_height, height) & ~1;
+        image_rect_t crop = {0, 0, det->roi_width - 1, det->roi_height - 1};
+        for (int i = 0; i < 2; i++)
+        {
+            det->plans[i].num_threads = det->num_threads;
+            if (init_letterbox_plan_crop(&det->plans[i], width, height, &crop, app_ctx->model_width,
+                                         app_ctx->model_height, ROI_BG_COLOR) != 0)
+            {
+                return -1;
+            }
+        }
+        det->width = width;
+        det->height = height;
+    }
+    *roi_width = det->roi_width;
+    *roi_height = det->roi_height;
+    return 0;
+}
+
+static int prepare_roi(roi_detector_t *det, rknn_app_context_t *app_ctx, image_buffer_t *img, const image_rect_t *roi,
+                       int slot)
+{
+    if (roi->left < 0 || roi->top < 0 || roi->right - roi->left + 1 != det->roi_width ||
+        roi->bottom - roi->top + 1 != det->roi_height || roi->right >= img->width || roi->bottom >= img->height)
+    {
+        printf("roi (%d %d %d %d) is not a %dx%d crop of the frame\n", roi->left, roi->top, roi->right, roi->bottom,
+               det->roi_width, det->roi_height);
+        return -1;
+    }
+    // same geometry for every crop, only the source moves
+    letterbox_plan_t *plan = &det->plans[slot];
+    plan->src_box = *roi;
+    return prepare_yolov5_input_with_plan(app_ctx, img, plan, &det->inputs[slot]);
+}
+
+static float box_iou(const image_rect_t *a, const image_rect_t *b)
+{
+    int w = std::min(a->right, b->right) - std::max(a->left, b->left) + 1;
+    int h = std::min(a->bottom, b->bottom) - std::max(a->top, b->top) + 1;
+    if (w <= 0 || h <= 0)
+    {
+        return 0.f;
+    }
+    float inter = (float)w * h;
+    float area_a = (float)(a->right - a->left + 1) * (a->bottom - a->top + 1);
+    float area_b = (float)(b->right - b->left + 1) * (b->bottom - b->top + 1);
+    return inter / (area_a + area_b - inter);
+}
+
+// a detection seen by an earlier crop is kept with the higher score
+static void add_result(object_detect_result_list *od_results, const object_detect_result *res, float nms_threshold)
+{
+    for (int i = 0; i < od_results->count; i++)
+    {
+        object_detect_result *other = &od_results->results[i];
+        if (other->cls_id == res->cls_id && box_iou(&other->box, &res->box) > nms_threshold)
+        {
+            if (res->prop > other->prop)
+            {
+                *other = *res;
+            }
+            return;
+        }
+    }
+    if (od_results->count < OBJ_NUMB_MAX_SIZE)
+    {
+        od_results->results[od_results->count++] = *res;
+    }
+}
+
+int detect_rois(roi_detector_t *det, rknn_app_context_t *app_ctx, image_buffer_t *img, const image_rect_t *rois,
+                int num_rois, object_detect_result_list *od_results)
+{
+    memset(od_results, 0, sizeof(object_detect_result_list));
+    if (num_rois <= 0)
+    {
+        return 0;
+    }
+    if (img->width != det->width || img->height != det->height)
+    {
+        printf("roi detector is set for %dx%d frames, got %dx%d\n", det->width, det->height, img->width, img->height);
+        return -1;
+    }
+    const float nms_threshold = app_ctx->nms_threshold > 0 ? app_ctx->nms_threshold : NMS_THRESH;
+
+    object_detect_result_list roi_results;
+    int ret = prepare_roi(det, app_ctx, img, &rois[0], 0);
+    for (int i = 0; i < num_rois && ret == 0; i++)
+    {
+        // the RGA reads the next crop while the NPU runs this one
+        if (i + 1 < num_rois)
+        {
+            ret = prepare_roi(det, app_ctx, img, &rois[i + 1], (i + 1) & 1);
+            if (ret != 0)
+            {
+                break;
+            }
+        }
+        ret = inference_yolov5_input_with_letterbox(app_ctx, &det->inputs[i & 1], &det->plans[i & 1].letterbox,
+                                                    &roi_results);
+        for (int j = 0; ret == 0 && j < roi_results.count; j++)
+        {
+            object_detect_result res = roi_results.results[j];
+            res.box.left += rois[i].left;
+            res.box.top += rois[i].top;
+            res.box.right += rois[i].left;
+            res.box.bottom += rois[i].top;
+            add_result(od_results, &res, nms_threshold);
+        }
+    }
+    // the image must not be read after return
+    rga_job_wait(&det->inputs[0].job, -1);
+    rga_job_wait(&det->inputs[1].job, -1);
+    return ret == 0 ? 0 : -1;
+}
@@ -28,7 +28,7 @@ int write_frame(uint8_t*data,int size)
         return 0;
 }
 
-int init_rtmp_streamer(char* stream,uint8_t *data,uint32_t size)
+int init_rtmp_streamer(char* stream,uint8_t *data,uint32_t size,int width,int height)
 {
         int ret;
         av_register_all();
@@ -59,8 +59,8 @@ int init_rtmp_streamer(char* stream,uint8_t *data,uint32_t size)
         o_codec_ctx->codec_type = AVMEDIA_TYPE_VIDEO;
         o_codec_ctx->codec_tag = 0;
         o_codec_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
-        o_codec_ctx->width = 640;
-        o_codec_ctx->height = 480;
+        o_codec_ctx->width = width;
+        o_codec_ctx->height = height;
         o_codec_ctx->extradata = data;
         o_codec_ctx->extradata_size = size;
                 
@@ -86,8 +86,7 @@ end:
         if (ofmt_ctx && !(ofmt_ctx->oformat->flags & AVFMT_NOFILE))
                 avio_close(ofmt_ctx->pb);
         avformat_free_context(ofmt_ctx);
-        if (ret < 0 && ret != AVERROR_EOF) {
-                printf( "Error occurred.\n");
-                return -1;
-        }
+        ofmt_ctx = NULL;
+        printf( "Error occurred.\n");
+        return -1;
 }
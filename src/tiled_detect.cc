@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "tiled_detect.h"
+
+#define TILE_BG_COLOR 114
+// a box this close to a seam was cut by it
+#define TILE_SEAM_MARGIN 2
+
+typedef struct {
+    image_rect_t box;
+    float prop;
+    int cls_id;
+    int tile;
+    int partial;
+    int removed;
+} tile_det_t;
+
+void default_tiling_config(tiling_config_t *config)
+{
+    memset(config, 0, sizeof(tiling_config_t));
+    config->enable = 0;
+    config->overlap = 64;
+    config->full_frame = 1;
+    config->nms_threshold = 0;
+    config->ios_threshold = 0.6f;
+    config->num_regions = 0;
+}
+
+int init_tiled_detector(tiled_detector_t *det, rknn_app_context_t *app_ctx, const tiling_config_t *config,
+                        int num_threads)
+{
+    memset(det, 0, sizeof(tiled_detector_t));
+    det->config = *config;
+    det->num_threads = num_threads;
+    det->inputs[0].job.fence_fd = -1;
+    det->inputs[1].job.fence_fd = -1;
+    if (init_yolov5_input(app_ctx, &det->inputs[0]) != 0 || init_yolov5_input(app_ctx, &det->inputs[1]) != 0)
+    {
+        release_tiled_detector(det);
+        return -1;
+    }
+    return 0;
+}
+
+static void release_tiles(tiled_detector_t *det)
+{
+    for (int i = 0; i < det->num_tiles; i++)
+    {
+        release_letterbox_plan(&det->tiles[i].plan);
+    }
+    memset(det->tiles, 0, sizeof(det->tiles));
+    det->num_tiles = 0;
+}
+
+void release_tiled_detector(tiled_detector_t *det)
+{
+    release_yolov5_input(&det->inputs[0]);
+    release_yolov5_input(&det->inputs[1]);
+    release_tiles(det);
+}
+
+// tile starts over [begin, end], the last tile ends on end, all even for YUV420SP
+static int split_axis(int begin, int end, int tile, int overlap, int *starts, int max_count)
+{
+    int len = end - begin + 1;
+    if (len <= tile)
+    {
+        starts[0] = begin;
+        return 1;
+    }
+    int step = tile - overlap;
+    if (step <= 0)
+    {
+        step = tile / 2;
+    }
+    int count = (len - tile + step - 1) / step + 1;
+    if (count > max_count)
+    {
+        return -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        starts[i] = (begin + (int)((long long)i * (len - tile) / (count - 1))) & ~1;
+    }
+    starts[count - 1] = end - tile + 1;
+    return count;
+}
+
+static int add_tile(tiled_detector_t *det, rknn_app_context_t *app_ctx, const image_rect_t *crop,
+                    const image_rect_t *region)
+{
+    if (det->num_tiles >= TILING_MAX_TILES)
+    {
+        printf("tiling needs more than %d tiles\n", TILING_MAX_TILES);
+        return -1;
+    }
+    tile_t *tile = &det->tiles[det->num_tiles];
+    tile->crop = *crop;
+    tile->plan.num_threads = det->num_threads;
+    if (init_letterbox_plan_crop(&tile->plan, det->width, det->height, crop, app_ctx->model_width,
+                                 app_ctx->model_height, TILE_BG_COLOR) != 0)
+    {
+        return -1;
+    }
+    tile->seam_left = crop->left > region->left;
+    tile->seam_top = crop->top > region->top;
+    tile->seam_right = crop->right < region->right;
+    tile->seam_bottom = crop->bottom < region->bottom;
+    det->num_tiles++;
+    return 0;
+}
+
+static int build_layout(tiled_detector_t *det, rknn_app_context_t *app_ctx, int width, int height)
+{
+    release_tiles(det);
+    det->width = width;
+    det->height = height;
+
+    image_rect_t frame = {0, 0, width - 1, height - 1};
+    if (det->config.full_frame && add_tile(det, app_ctx, &frame, &frame) != 0)
+    {
+        return -1;
+    }
+
+    int num_regions = det->config.num_regions > 0 ? det->config.num_regions : 1;
+    for (int r = 0; r < num_regions; r++)
+    {
+        image_rect_t region = det->config.num_regions > 0 ? det->config.regions[r] : frame;
+        // clipped to the frame, on even pixels
+        region.left = std::max(region.left, 0) & ~1;
+        region.top = std::max(region.top, 0) & ~1;
+        region.right = ((std::min(region.right, width - 1) + 1) & ~1) - 1;
+        region.bottom = ((std::min(region.bottom, height - 1) + 1) & ~1) - 1;
+        if (region.right <= region.left || region.bottom <= region.top)
+        {
+            printf("tiling region %d is out of the %dx%d frame\n", r, width, height);
+            continue;
+        }
+
+        int xs[TILING_MAX_TILES];
+        int ys[TILING_MAX_TILES];
+        int nx = split_axis(region.left, region.right, app_ctx->model_width, det->config.overlap, xs, TILING_MAX_TILES);
+        int ny = split_axis(region.top, region.bottom, app_ctx->model_height, det->config.overlap, ys, TILING_MAX_TILES);
+        if (nx < 0 || ny < 0)
+        {
+            printf("tiling region %d needs more than %d tiles\n", r, TILING_MAX_TILES);
+            return -1;
+        }
+        for (int y = 0; y < ny; y++)
+        {
+            for (int x = 0; x < nx; x++)
+            {
+                image_rect_t crop;
+                crop.left = xs[x];
+                crop.top = ys[y];
+                crop.right = std::min(xs[x] + app_ctx->model_width - 1, region.right);
+                crop.bottom = std::min(ys[y] + app_ctx->model_height - 1, region.bottom);
+                if (add_tile(det, app_ctx, &crop, &region) != 0)
+                {
+                    return -1;
+                }
+            }
+        }
+    }
+    printf("tiling %dx%d into %d tiles\n", width, height, det->num_tiles);
+    return det->num_tiles > 0 ? 0 : -1;
+}
+
+static int rect_area(const image_rect_t *r)
+{
+    if (r->right < r->left || r->bottom < r->top)
+    {
+        return 0;
+    }
+    return (r->right - r->left + 1) * (r->bottom - r->top + 1);
+}
+
+static image_rect_t rect_intersect(const image_rect_t *a, const image_rect_t *b)
+{
+    image_rect_t r;
+    r.left = std::max(a->left, b->left);
+    r.top = std::max(a->top, b->top);
+    r.right = std::min(a->right, b->right);
+    r.bottom = std::min(a->bottom, b->bottom);
+    return r;
+}
+
+static float rect_iou(const image_rect_t *a, const image_rect_t *b)
+{
+    image_rect_t i = rect_intersect(a, b);
+    int inter = rect_area(&i);
+    int uni = rect_area(a) + rect_area(b) - inter;
+    return uni <= 0 ? 0.f : (float)inter / uni;
+}
+
+// intersection over the smaller box, both clipped to what the two tiles see
+static float shared_view_ios(const tile_det_t *a, const tile_det_t *b, const image_rect_t *view)
+{
+    image_rect_t ca = rect_intersect(&a->box, view);
+    image_rect_t cb = rect_intersect(&b->box, view);
+    int area_a = rect_area(&ca);
+    int area_b = rect_area(&cb);
+    if (area_a == 0 || area_b == 0)
+    {
+        return 0.f;
+    }
+    image_rect_t i = rect_intersect(&ca, &cb);
+    return (float)rect_area(&i) / std::min(area_a, area_b);
+}
+
+static void merge_detections(tiled_detector_t *det, std::vector<tile_det_t> &dets, float nms_threshold,
+                             object_detect_result_list *od_results)
+{
+    std::sort(dets.begin(), dets.end(), [](const tile_det_t &a, const tile_det_t &b) { return a.prop > b.prop; });
+    for (size_t i = 0; i < dets.size(); i++)
+    {
+        tile_det_t *a = &dets[i];
+        if (a->removed)
+        {
+            continue;
+        }
+        for (size_t j = i + 1; j < dets.size(); j++)
+        {
+            tile_det_t *b = &dets[j];
+            if (b->removed || b->cls_id != a->cls_id)
+            {
+                continue;
+            }
+            int same = rect_iou(&a->box, &b->box) > nms_threshold;
+            if (!same && a->tile != b->tile)
+            {
+                image_rect_t view = rect_intersect(&det->tiles[a->tile].crop, &det->tiles[b->tile].crop);
+                same = rect_area(&view) > 0 && shared_view_ios(a, b, &view) > det->config.ios_threshold;
+            }
+            if (!same)
+            {
+                continue;
+            }
+            b->removed = 1;
+            if (a->partial || b->partial)
+            {
+                // parts of one object seen by neighbour tiles
+                a->box.left = std::min(a->box.left, b->box.left);
+                a->box.top = std::min(a->box.top, b->box.top);
+                a->box.right = std::max(a->box.right, b->box.right);
+                a->box.bottom = std::max(a->box.bottom, b->box.bottom);
+                a->partial = a->partial && b->partial;
+            }
+        }
+    }
+
+    memset(od_results, 0, sizeof(object_detect_result_list));
+    for (size_t i = 0; i < dets.size() && od_results->count < OBJ_NUMB_MAX_SIZE; i++)
+    {
+        if (dets[i].removed)
+        {
+            continue;
+        }
+        object_detect_result *res = &od_results->results[od_results->count++];
+        res->box = dets[i].box;
+        res->prop = dets[i].prop;
+        res->cls_id = dets[i].cls_id;
+    }
+}
+
+static void add_tile_results(tiled_detector_t *det, int t, object_detect_result_list *tile_results,
+                             std::vector<tile_det_t> &dets)
+{
+    const tile_t *tile = &det->tiles[t];
+    for (int i = 0; i < tile_results->count; i++)
+    {
+        tile_det_t d;
+        d.box = tile_results->results[i].box;
+        d.box.left += tile->crop.left;
+        d.box.top += tile->crop.top;
+        d.box.right += tile->crop.left;
+        d.box.bottom += tile->crop.top;
+        d.prop = tile_results->results[i].prop;
+        d.cls_id = tile_results->results[i].cls_id;
+        d.tile = t;
+        d.partial = (tile->seam_left && d.box.left <= tile->crop.left + TILE_SEAM_MARGIN) ||
+                    (tile->seam_top && d.box.top <= tile->crop.top + TILE_SEAM_MARGIN) ||
+                    (tile->seam_right && d.box.right >= tile->crop.right - TILE_SEAM_MARGIN) ||
+                    (tile->seam_bottom && d.box.bottom >= tile->crop.bottom - TILE_SEAM_MARGIN);
+        d.removed = 0;
+        dets.push_back(d);
+    }
+}
+
+static int prepare_tile(tiled_detector_t *det, rknn_app_context_t *app_ctx, image_buffer_t *img, int t)
+{
+    // both inputs take turns between tiles of different pads, fill it every time
+    det->tiles[t].plan.pad_filled = 0;
+    return prepare_yolov5_input_with_plan(app_ctx, img, &det->tiles[t].plan, &det->inputs[t & 1]);
+}
+
+int tiled_detect(tiled_detector_t *det, rknn_app_context_t *app_ctx, image_buffer_t *img,
+                 object_detect_result_list *od_results)
+{
+    if (img->width != det->width || img->height != det->height || det->num_tiles == 0)
+    {
+        if (build_layout(det, app_ctx, img->width, img->height) != 0)
+        {
+            release_tiles(det);
+            return -1;
+        }
+    }
+
+    std::vector<tile_det_t> dets;
+    object_detect_result_list tile_results;
+    int ret = prepare_tile(det, app_ctx, img, 0);
+    for (int t = 0; t < det->num_tiles && ret == 0; t++)
+    {
+        // the RGA crops the next tile while the NPU runs this one
+        if (t + 1 < det->num_tiles)
+        {
+            ret = prepare_tile(det, app_ctx, img, t + 1);
+            if (ret != 0)
+            {
+                break;
+            }
+        }
+        ret = inference_yolov5_input_with_letterbox(app_ctx, &det->inputs[t & 1], &det->tiles[t].plan.letterbox,
+                                                    &tile_results);
+        if (ret == 0)
+        {
+            add_tile_results(det, t, &tile_results, dets);
+        }
+    }
+    // the image must not be read after return
+    rga_job_wait(&det->inputs[0].job, -1);
+    rga_job_wait(&det->inputs[1].job, -1);
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    float nms_threshold = det->config.nms_threshold > 0 ? det->config.nms_threshold
+                          : app_ctx->nms_threshold > 0 ? app_ctx->nms_threshold
+                                                       : NMS_THRESH;
+    merge_detections(det, dets, nms_threshold, od_results);
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "BYTETracker.h"
+#include "tracking.h"
+
+struct tracker_t {
+    tracking_config_t config;
+    BYTETracker *tracker;
+    int fps;
+    long long frame_count;
+    int interval;
+    int since_detection;
+};
+
+void default_tracking_config(tracking_config_t *config)
+{
+    config->enable = 0;
+    config->detect_interval = 3;
+    config->adaptive = 1;
+    config->max_drift = 0.25f;
+    config->min_confidence = 0.5f;
+    config->track_buffer = 30;
+    config->redetect = 0;
+    config->redetect_max_rois = 4;
+    config->redetect_min_height = 32;
+    config->redetect_lost_frames = 15;
+}
+
+struct tracker_t *create_tracker(const tracking_config_t *config, int fps)
+{
+    tracker_t *tracker = new tracker_t();
+    tracker->config = *config;
+    if (tracker->config.detect_interval < 1)
+    {
+        tracker->config.detect_interval = 1;
+    }
+    tracker->tracker = new BYTETracker(fps, config->track_buffer);
+    tracker->fps = fps;
+    tracker->frame_count = 0;
+    tracker->interval = 1;
+    // the first frame is always detected
+    tracker->since_detection = 1;
+    return tracker;
+}
+
+void destroy_tracker(struct tracker_t *tracker)
+{
+    if (tracker == NULL)
+    {
+        return;
+    }
+    delete tracker->tracker;
+    delete tracker;
+}
+
+int tracker_want_detection(struct tracker_t *tracker)
+{
+    if (tracker->since_detection >= tracker->interval)
+    {
+        tracker->since_detection = 1;
+        return 1;
+    }
+    tracker->since_detection++;
+    return 0;
+}
+
+static void tracks_to_results(const vector<STrack> &tracks, int predicted, object_detect_result_list *results)
+{
+    int count = 0;
+    for (size_t i = 0; i < tracks.size() && count < OBJ_NUMB_MAX_SIZE; i++)
+    {
+        const vector<float> &tlwh = tracks[i].tlwh;
+        object_detect_result *det = &results->results[count++];
+        det->box.left = (int)tlwh[0];
+        det->box.top = (int)tlwh[1];
+        det->box.right = (int)(tlwh[0] + tlwh[2]);
+        det->box.bottom = (int)(tlwh[1] + tlwh[3]);
+        det->prop = tracks[i].score;
+        det->cls_id = tracks[i].label;
+        det->track_id = tracks[i].track_id;
+        det->predicted = predicted;
+    }
+    results->count = count;
+}
+
+// frames until a track may have moved max_drift of its height, or an unsure one needs checking
+static int next_interval(const tracking_config_t *config, const vector<STrack> &tracks)
+{
+    if (!config->adaptive)
+    {
+        return config->detect_interval;
+    }
+    float max_speed = 0;
+    for (size_t i = 0; i < tracks.size(); i++)
+    {
+        const STrack &track = tracks[i];
+        if (track.score < config->min_confidence)
+        {
+            return 1;
+        }
+        float h = track.mean[3];
+        if (h <= 0)
+        {
+            continue;
+        }
+        float speed = sqrtf(track.mean[4] * track.mean[4] + track.mean[5] * track.mean[5]) / h;
+        if (speed > max_speed)
+        {
+            max_speed = speed;
+        }
+    }
+    if (max_speed <= 0)
+    {
+        return config->detect_interval;
+    }
+    int interval = (int)(config->max_drift / max_speed);
+    if (interval < 1)
+    {
+        interval = 1;
+    }
+    return interval < config->detect_interval ? interval : config->detect_interval;
+}
+
+static int track_is_weak(const tracking_config_t *config, const STrack &track)
+{
+    return track.score < config->min_confidence || track.tlwh[3] < config->redetect_min_height;
+}
+
+static int rect_contains(const image_rect_t *rect, const vector<float> &tlwh)
+{
+    return tlwh[0] >= rect->left && tlwh[1] >= rect->top && tlwh[0] + tlwh[2] <= rect->right &&
+           tlwh[1] + tlwh[3] <= rect->bottom;
+}
+
+int tracker_select_rois(struct tracker_t *tracker, int width, int height, int roi_width, int roi_height,
+                        image_rect_t *rois, int max_rois)
+{
+    const tracking_config_t *config = &tracker->config;
+    if (!config->redetect || roi_width > width || roi_height > height)
+    {
+        return 0;
+    }
+    if (max_rois > config->redetect_max_rois)
+    {
+        max_rois = config->redetect_max_rois;
+    }
+
+    // lost tracks first, they are the ones about to be dropped
+    vector<const STrack *> candidates;
+    const vector<STrack> &lost = tracker->tracker->get_lost_stracks();
+    int frame_id = tracker->tracker->get_frame_id();
+    for (size_t i = 0; i < lost.size(); i++)
+    {
+        if (frame_id - lost[i].frame_id <= config->redetect_lost_frames)
+        {
+            candidates.push_back(&lost[i]);
+        }
+    }
+    const vector<STrack> &tracked = tracker->tracker->get_tracked_stracks();
+    for (size_t i = 0; i < tracked.size(); i++)
+    {
+        if (tracked[i].is_activated && track_is_weak(config, tracked[i]))
+        {
+            candidates.push_back(&tracked[i]);
+        }
+    }
+
+    int count = 0;
+    for (size_t i = 0; i < candidates.size() && count < max_rois; i++)
+    {
+        const vector<float> &tlwh = candidates[i]->tlwh;
+        int covered = 0;
+        for (int r = 0; r < count && !covered; r++)
+        {
+            covered = rect_contains(&rois[r], tlwh);
+        }
+        if (covered)
+        {
+            continue;
+        }
+        int left = (int)(tlwh[0] + tlwh[2] / 2) - roi_width / 2;
+        int top = (int)(tlwh[1] + tlwh[3] / 2) - roi_height / 2;
+        left = std::max(0, std::min(left, width - roi_width)) & ~1;
+        top = std::max(0, std::min(top, height - roi_height)) & ~1;
+        image_rect_t *roi = &rois[count++];
+        roi->left = left;
+        roi->top = top;
+        roi->right = left + roi_width - 1;
+        roi->bottom = top + roi_height - 1;
+    }
+    return count;
+}
+
+static void results_to_objects(const object_detect_result_list *results, vector<Object> &objects)
+{
+    for (int i = 0; i < results->count; i++)
+    {
+        const object_detect_result *det = &results->results[i];
+        Rect<float> rect(det->box.left, det->box.top, det->box.right - det->box.left, det->box.bottom - det->box.top);
+        const char *name = coco_cls_to_name(det->cls_id);
+        objects.push_back(Object(rect, det->cls_id, det->prop, name != NULL ? name : ""));
+    }
+}
+
+int tracker_update(struct tracker_t *tracker, object_detect_result_list *results,
+                   const object_detect_result_list *roi_results)
+{
+    vector<Object> objects;
+    vector<Object> roi_objects;
+    results_to_objects(results, objects);
+    if (roi_results != NULL)
+    {
+        results_to_objects(roi_results, roi_objects);
+    }
+    vector<STrack> tracks = tracker->tracker->update(objects, tracker->fps, ++tracker->frame_count, roi_objects);
+    tracks_to_results(tracks, 0, results);
+    tracker->interval = next_interval(&tracker->config, tracks);
+    return tracker->interval;
+}
+
+void tracker_predict(struct tracker_t *tracker, object_detect_result_list *results)
+{
+    vector<STrack> tracks = tracker->tracker->predict();
+    tracker->frame_count++;
+    tracks_to_results(tracks, 1, results);
+}
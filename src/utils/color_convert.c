@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define COLOR_CONVERT_NEON 1
+#endif
+
+#include "color_convert.h"
+#include "image_utils.h"
+#include "row_parallel.h"
+
+// BT.601 limited range in 6 bit fixed point, same rounding on NEON and C:
+// R = (74 * (Y - 16) + 102 * V' + 32) >> 6
+// G = (74 * (Y - 16) -  25 * U' - 52 * V' + 32) >> 6
+// B = (74 * (Y - 16) + 129 * U' + 32) >> 6
+#define YC 74
+#define VR 102
+#define UG 25
+#define VG 52
+#define UB 129
+
+static inline unsigned char clamp_u8(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static inline void yuv_to_rgb_pixel(int y, int u, int v, unsigned char *rgb)
+{
+    int yy = (y - 16) * YC;
+    u -= 128;
+    v -= 128;
+    rgb[0] = clamp_u8((yy + VR * v + 32) >> 6);
+    rgb[1] = clamp_u8((yy - UG * u - VG * v + 32) >> 6);
+    rgb[2] = clamp_u8((yy + UB * u + 32) >> 6);
+}
+
+#ifdef COLOR_CONVERT_NEON
+typedef struct {
+    int16x8_t rv;
+    int16x8_t guv;
+    int16x8_t bu;
+} chroma_neon_t;
+
+static inline chroma_neon_t chroma_neon(uint8x8_t u, uint8x8_t v)
+{
+    int16x8_t uu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u)), vdupq_n_s16(128));
+    int16x8_t vv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v)), vdupq_n_s16(128));
+    chroma_neon_t c;
+    c.rv = vmulq_n_s16(vv, VR);
+    c.guv = vaddq_s16(vmulq_n_s16(uu, UG), vmulq_n_s16(vv, VG));
+    c.bu = vmulq_n_s16(uu, UB);
+    return c;
+}
+
+// 8 pixels sharing the chroma of c, saturating adds only clip values that are out of range anyway
+static inline uint8x8x3_t yuv_to_rgb_neon(uint8x8_t y, chroma_neon_t c)
+{
+    int16x8_t yy = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y)), vdupq_n_s16(16)), YC);
+    uint8x8x3_t rgb;
+    rgb.val[0] = vqrshrun_n_s16(vqaddq_s16(yy, c.rv), 6);
+    rgb.val[1] = vqrshrun_n_s16(vqsubq_s16(yy, c.guv), 6);
+    rgb.val[2] = vqrshrun_n_s16(vqaddq_s16(yy, c.bu), 6);
+    return rgb;
+}
+
+// interleave even and odd pixels back and store 16 RGB pixels
+static inline void store_rgb16_neon(unsigned char *dst, uint8x8x3_t even, uint8x8x3_t odd)
+{
+    uint8x8x2_t r = vzip_u8(even.val[0], odd.val[0]);
+    uint8x8x2_t g = vzip_u8(even.val[1], odd.val[1]);
+    uint8x8x2_t b = vzip_u8(even.val[2], odd.val[2]);
+    uint8x8x3_t lo;
+    uint8x8x3_t hi;
+    lo.val[0] = r.val[0];
+    lo.val[1] = g.val[0];
+    lo.val[2] = b.val[0];
+    hi.val[0] = r.val[1];
+    hi.val[1] = g.val[1];
+    hi.val[2] = b.val[1];
+    vst3_u8(dst, lo);
+    vst3_u8(dst + 24, hi);
+}
+#endif
+
+static void yuyv_row_to_rgb(const unsigned char *src, unsigned char *dst, int width)
+{
+    int x = 0;
+#ifdef COLOR_CONVERT_NEON
+    for (; x + 16 <= width; x += 16)
+    {
+        // Y0 U Y1 V
+        uint8x8x4_t p = vld4_u8(src + x * 2);
+        chroma_neon_t c = chroma_neon(p.val[1], p.val[3]);
+        store_rgb16_neon(dst + x * 3, yuv_to_rgb_neon(p.val[0], c), yuv_to_rgb_neon(p.val[2], c));
+    }
+#endif
+    for (; x + 2 <= width; x += 2)
+    {
+        const unsigned char *p = src + x * 2;
+        yuv_to_rgb_pixel(p[0], p[1], p[3], dst + x * 3);
+        yuv_to_rgb_pixel(p[2], p[1], p[3], dst + x * 3 + 3);
+    }
+}
+
+static void nv12_row_to_rgb(const unsigned char *y, const unsigned char *uv, unsigned char *dst, int width)
+{
+    int x = 0;
+#ifdef COLOR_CONVERT_NEON
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x8x2_t yy = vld2_u8(y + x);
+        uint8x8x2_t c = vld2_u8(uv + x);
+        chroma_neon_t ch = chroma_neon(c.val[0], c.val[1]);
+        store_rgb16_neon(dst + x * 3, yuv_to_rgb_neon(yy.val[0], ch), yuv_to_rgb_neon(yy.val[1], ch));
+    }
+#endif
+    for (; x + 2 <= width; x += 2)
+    {
+        yuv_to_rgb_pixel(y[x], uv[x], uv[x + 1], dst + x * 3);
+        yuv_to_rgb_pixel(y[x + 1], uv[x], uv[x + 1], dst + x * 3 + 3);
+    }
+}
+
+static void yuyv_rows_to_nv12(const unsigned char *src0, const unsigned char *src1, unsigned char *y0,
+                              unsigned char *y1, unsigned char *uv, int width)
+{
+    int x = 0;
+#ifdef COLOR_CONVERT_NEON
+    for (; x + 32 <= width; x += 32)
+    {
+        uint8x16x4_t a = vld4q_u8(src0 + x * 2);
+        uint8x16x4_t b = vld4q_u8(src1 + x * 2);
+        uint8x16x2_t ya;
+        uint8x16x2_t yb;
+        uint8x16x2_t c;
+        ya.val[0] = a.val[0];
+        ya.val[1] = a.val[2];
+        yb.val[0] = b.val[0];
+        yb.val[1] = b.val[2];
+        c.val[0] = vrhaddq_u8(a.val[1], b.val[1]);
+        c.val[1] = vrhaddq_u8(a.val[3], b.val[3]);
+        vst2q_u8(y0 + x, ya);
+        vst2q_u8(y1 + x, yb);
+        vst2q_u8(uv + x, c);
+    }
+#endif
+    for (; x + 2 <= width; x += 2)
+    {
+        const unsigned char *a = src0 + x * 2;
+        const unsigned char *b = src1 + x * 2;
+        y0[x] = a[0];
+        y0[x + 1] = a[2];
+        y1[x] = b[0];
+        y1[x + 1] = b[2];
+        uv[x] = (a[1] + b[1] + 1) >> 1;
+        uv[x + 1] = (a[3] + b[3] + 1) >> 1;
+    }
+}
+
+typedef struct {
+    const unsigned char *src;
+    int src_stride;
+    const unsigned char *src_uv;
+    int src_uv_stride;
+    unsigned char *dst;
+    int dst_stride;
+    unsigned char *dst_uv;
+    int dst_uv_stride;
+    int width;
+} color_task_t;
+
+static void yuyv_to_rgb_stripe(void *arg, int stripe, int row_begin, int row_end)
+{
+    color_task_t *t = (color_task_t *)arg;
+    for (int row = row_begin; row < row_end; row++)
+    {
+        yuyv_row_to_rgb(t->src + row * t->src_stride, t->dst + row * t->dst_stride, t->width);
+    }
+}
+
+static void nv12_to_rgb_stripe(void *arg, int stripe, int row_begin, int row_end)
+{
+    color_task_t *t = (color_task_t *)arg;
+    for (int row = row_begin; row < row_end; row++)
+    {
+        nv12_row_to_rgb(t->src + row * t->src_stride, t->src_uv + (row / 2) * t->src_uv_stride,
+                        t->dst + row * t->dst_stride, t->width);
+    }
+}
+
+static void yuyv_to_nv12_stripe(void *arg, int stripe, int row_begin, int row_end)
+{
+    color_task_t *t = (color_task_t *)arg;
+    for (int row = row_begin; row + 1 < row_end; row += 2)
+    {
+        yuyv_rows_to_nv12(t->src + row * t->src_stride, t->src + (row + 1) * t->src_stride,
+                          t->dst + row * t->dst_stride, t->dst + (row + 1) * t->dst_stride,
+                          t->dst_uv + (row / 2) * t->dst_uv_stride, t->width);
+    }
+}
+
+int yuyv_to_rgb888(const unsigned char *yuyv, int yuyv_stride, unsigned char *rgb, int rgb_stride,
+                   int width, int height, int num_threads)
+{
+    if (yuyv == NULL || rgb == NULL || width <= 0 || height <= 0 || (width & 1))
+    {
+        return -1;
+    }
+    color_task_t t = {0};
+    t.src = yuyv;
+    t.src_stride = yuyv_stride;
+    t.dst = rgb;
+    t.dst_stride = rgb_stride;
+    t.width = width;
+    return row_parallel_for(height, 1, num_threads, yuyv_to_rgb_stripe, &t);
+}
+
+int nv12_to_rgb888(const unsigned char *y, int y_stride, const unsigned char *uv, int uv_stride,
+                   unsigned char *rgb, int rgb_stride, int width, int height, int num_threads)
+{
+    if (y == NULL || uv == NULL || rgb == NULL || width <= 0 || height <= 0 || (width & 1) || (height & 1))
+    {
+        return -1;
+    }
+    color_task_t t = {0};
+    t.src = y;
+    t.src_stride = y_stride;
+    t.src_uv = uv;
+    t.src_uv_stride = uv_stride;
+    t.dst = rgb;
+    t.dst_stride = rgb_stride;
+    t.width = width;
+    return row_parallel_for(height, 2, num_threads, nv12_to_rgb_stripe, &t);
+}
+
+int yuyv_to_nv12(const unsigned char *yuyv, int yuyv_stride, unsigned char *y, int y_stride,
+                 unsigned char *uv, int uv_stride, int width, int height, int num_threads)
+{
+    if (yuyv == NULL || y == NULL || uv == NULL || width <= 0 || height <= 0 || (width & 1) || (height & 1))
+    {
+        return -1;
+    }
+    color_task_t t = {0};
+    t.src = yuyv;
+    t.src_stride = yuyv_stride;
+    t.dst = y;
+    t.dst_stride = y_stride;
+    t.dst_uv = uv;
+    t.dst_uv_stride = uv_stride;
+    t.width = width;
+    return row_parallel_for(height, 2, num_threads, yuyv_to_nv12_stripe, &t);
+}
+
+int convert_color_cpu(image_buffer_t *src_image, image_buffer_t *dst_image, int num_threads)
+{
+    if (src_image == NULL || dst_image == NULL || src_image->virt_addr == NULL || dst_image->virt_addr == NULL)
+    {
+        return -1;
+    }
+    if (src_image->width != dst_image->width || src_image->height != dst_image->height)
+    {
+        return -1;
+    }
+    int width = src_image->width;
+    int height = src_image->height;
+    unsigned char *src = src_image->virt_addr;
+    unsigned char *dst = dst_image->virt_addr;
+    int src_pitch = get_image_pitch(src_image);
+    int dst_pitch = get_image_pitch(dst_image);
+
+    if (src_image->format == IMAGE_FORMAT_YUYV_422 && dst_image->format == IMAGE_FORMAT_RGB888)
+    {
+        return yuyv_to_rgb888(src, src_pitch, dst, dst_pitch, width, height, num_threads);
+    }
+    if (src_image->format == IMAGE_FORMAT_YUV420SP_NV12 && dst_image->format == IMAGE_FORMAT_RGB888)
+    {
+        unsigned char *src_uv = src + src_pitch * get_image_height_stride(src_image);
+        return nv12_to_rgb888(src, src_pitch, src_uv, src_pitch, dst, dst_pitch, width, height, num_threads);
+    }
+    if (src_image->format == IMAGE_FORMAT_YUYV_422 && dst_image->format == IMAGE_FORMAT_YUV420SP_NV12)
+    {
+        unsigned char *dst_uv = dst + dst_pitch * get_image_height_stride(dst_image);
+        return yuyv_to_nv12(src, src_pitch, dst, dst_pitch, dst_uv, dst_pitch, width, height, num_threads);
+    }
+    printf("convert_color_cpu no support format %d->%d\n", src_image->format, dst_image->format);
+    return -1;
+}
+
+void yuyv_to_rgb(unsigned char *yuv, unsigned char *rgb, int width, int height)
+{
+    yuyv_to_rgb888(yuv, width * 2, rgb, width * 3, width, height, 1);
+}
@@ -4,6 +4,7 @@
 #include <ctype.h>
 
 #include "image_drawing.h"
+#include "image_utils.h"
 #include "font.h"
 
 #define max(a, b) (((a) > (b)) ? (a) : (b))
@@ -53,11 +54,10 @@ static unsigned int convert_color(unsigned int src_color, image_format_t dst_fmt
     return dst_color;
 }
 
-static void draw_rectangle_c1(unsigned char* pixels, int w, int h, int rx, int ry, int rw, int rh, unsigned int color,
+static void draw_rectangle_c1(unsigned char* pixels, int w, int h, int stride, int rx, int ry, int rw, int rh, unsigned int color,
                               int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w;
 
     if (thickness == -1) {
         // filled
@@ -176,11 +176,10 @@ static void draw_rectangle_c1(unsigned char* pixels, int w, int h, int rx, int r
     }
 }
 
-static void draw_rectangle_c2(unsigned char* pixels, int w, int h, int rx, int ry, int rw, int rh, unsigned int color,
+static void draw_rectangle_c2(unsigned char* pixels, int w, int h, int stride, int rx, int ry, int rw, int rh, unsigned int color,
                               int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 2;
 
     if (thickness == -1) {
         // filled
@@ -304,11 +303,10 @@ static void draw_rectangle_c2(unsigned char* pixels, int w, int h, int rx, int r
     }
 }
 
-static void draw_rectangle_c3(unsigned char* pixels, int w, int h, int rx, int ry, int rw, int rh, unsigned int color,
+static void draw_rectangle_c3(unsigned char* pixels, int w, int h, int stride, int rx, int ry, int rw, int rh, unsigned int color,
                               int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 3;
 
     if (thickness == -1) {
         // filled
@@ -437,11 +435,10 @@ static void draw_rectangle_c3(unsigned char* pixels, int w, int h, int rx, int r
     }
 }
 
-static void draw_rectangle_c4(unsigned char* pixels, int w, int h, int rx, int ry, int rw, int rh, unsigned int color,
+static void draw_rectangle_c4(unsigned char* pixels, int w, int h, int stride, int rx, int ry, int rw, int rh, unsigned int color,
                               int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 4;
 
     if (thickness == -1) {
         // filled
@@ -575,7 +572,7 @@ static void draw_rectangle_c4(unsigned char* pixels, int w, int h, int rx, int r
     }
 }
 
-static void draw_rectangle_yuv420sp(unsigned char* yuv420sp, int w, int h, int rx, int ry, int rw, int rh,
+static void draw_rectangle_yuv420sp(unsigned char* yuv420sp, unsigned char* uv, int w, int h, int stride, int rx, int ry, int rw, int rh,
                                     unsigned int color, int thickness)
 {
     // assert w % 2 == 0
@@ -597,11 +594,11 @@ static void draw_rectangle_yuv420sp(unsigned char* yuv420sp, int w, int h, int r
     pen_color_uv[1] = pen_color[2];
 
     unsigned char* Y = yuv420sp;
-    draw_rectangle_c1(Y, w, h, rx, ry, rw, rh, v_y, thickness);
+    draw_rectangle_c1(Y, w, h, stride, rx, ry, rw, rh, v_y, thickness);
 
-    unsigned char* UV = yuv420sp + w * h;
+    unsigned char* UV = uv;
     int thickness_uv = thickness == -1 ? thickness : max(thickness / 2, 1);
-    draw_rectangle_c2(UV, w / 2, h / 2, rx / 2, ry / 2, rw / 2, rh / 2, v_uv, thickness_uv);
+    draw_rectangle_c2(UV, w / 2, h / 2, stride, rx / 2, ry / 2, rw / 2, rh / 2, v_uv, thickness_uv);
 }
 
 static inline int distance_lessequal(int x0, int y0, int x1, int y1, float r)
@@ -620,11 +617,10 @@ static inline int distance_inrange(int x0, int y0, int x1, int y1, float r0, flo
     return q >= r0 * r0 && q < r1 * r1;
 }
 
-static void draw_circle_c1(unsigned char* pixels, int w, int h, int cx, int cy, int radius, unsigned int color,
+static void draw_circle_c1(unsigned char* pixels, int w, int h, int stride, int cx, int cy, int radius, unsigned int color,
                            int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w;
 
     if (thickness == -1) {
         // filled
@@ -681,11 +677,10 @@ static void draw_circle_c1(unsigned char* pixels, int w, int h, int cx, int cy,
     }
 }
 
-static void draw_circle_c2(unsigned char* pixels, int w, int h, int cx, int cy, int radius, unsigned int color,
+static void draw_circle_c2(unsigned char* pixels, int w, int h, int stride, int cx, int cy, int radius, unsigned int color,
                            int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 2;
 
     if (thickness == -1) {
         // filled
@@ -744,11 +739,10 @@ static void draw_circle_c2(unsigned char* pixels, int w, int h, int cx, int cy,
     }
 }
 
-static void draw_circle_c3(unsigned char* pixels, int w, int h, int cx, int cy, int radius, unsigned int color,
+static void draw_circle_c3(unsigned char* pixels, int w, int h, int stride, int cx, int cy, int radius, unsigned int color,
                            int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 3;
 
     if (thickness == -1) {
         // filled
@@ -809,11 +803,10 @@ static void draw_circle_c3(unsigned char* pixels, int w, int h, int cx, int cy,
     }
 }
 
-static void draw_circle_c4(unsigned char* pixels, int w, int h, int cx, int cy, int radius, unsigned int color,
+static void draw_circle_c4(unsigned char* pixels, int w, int h, int stride, int cx, int cy, int radius, unsigned int color,
                            int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 4;
 
     if (thickness == -1) {
         // filled
@@ -876,7 +869,7 @@ static void draw_circle_c4(unsigned char* pixels, int w, int h, int cx, int cy,
     }
 }
 
-static void draw_circle_yuv420sp(unsigned char* yuv420sp, int w, int h, int cx, int cy, int radius, unsigned int color,
+static void draw_circle_yuv420sp(unsigned char* yuv420sp, unsigned char* uv, int w, int h, int stride, int cx, int cy, int radius, unsigned int color,
                                  int thickness)
 {
     // assert w % 2 == 0
@@ -897,11 +890,11 @@ static void draw_circle_yuv420sp(unsigned char* yuv420sp, int w, int h, int cx,
     pen_color_uv[1] = pen_color[2];
 
     unsigned char* Y = yuv420sp;
-    draw_circle_c1(Y, w, h, cx, cy, radius, v_y, thickness);
+    draw_circle_c1(Y, w, h, stride, cx, cy, radius, v_y, thickness);
 
-    unsigned char* UV = yuv420sp + w * h;
+    unsigned char* UV = uv;
     int thickness_uv = thickness == -1 ? thickness : max(thickness / 2, 1);
-    draw_circle_c2(UV, w / 2, h / 2, cx / 2, cy / 2, radius / 2, v_uv, thickness_uv);
+    draw_circle_c2(UV, w / 2, h / 2, stride, cx / 2, cy / 2, radius / 2, v_uv, thickness_uv);
 }
 
 static inline int distance_lessthan(int x, int y, int x0, int y0, int x1, int y1, float t)
@@ -924,11 +917,10 @@ static inline int distance_lessthan(int x, int y, int x0, int y0, int x1, int y1
     return p < t;
 }
 
-static void draw_line_c1(unsigned char* pixels, int w, int h, int x0, int y0, int x1, int y1, unsigned int color,
+static void draw_line_c1(unsigned char* pixels, int w, int h, int stride, int x0, int y0, int x1, int y1, unsigned int color,
                          int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w;
 
     const float t0 = thickness / 2.f;
     const float t1 = thickness - t0;
@@ -962,11 +954,10 @@ static void draw_line_c1(unsigned char* pixels, int w, int h, int x0, int y0, in
     }
 }
 
-static void draw_line_c2(unsigned char* pixels, int w, int h, int x0, int y0, int x1, int y1, unsigned int color,
+static void draw_line_c2(unsigned char* pixels, int w, int h, int stride, int x0, int y0, int x1, int y1, unsigned int color,
                          int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 2;
 
     const float t0 = thickness / 2.f;
     const float t1 = thickness - t0;
@@ -1001,11 +992,10 @@ static void draw_line_c2(unsigned char* pixels, int w, int h, int x0, int y0, in
     }
 }
 
-static void draw_line_c3(unsigned char* pixels, int w, int h, int x0, int y0, int x1, int y1, unsigned int color,
+static void draw_line_c3(unsigned char* pixels, int w, int h, int stride, int x0, int y0, int x1, int y1, unsigned int color,
                          int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 3;
 
     const float t0 = thickness / 2.f;
     const float t1 = thickness - t0;
@@ -1041,11 +1031,10 @@ static void draw_line_c3(unsigned char* pixels, int w, int h, int x0, int y0, in
     }
 }
 
-static void draw_line_c4(unsigned char* pixels, int w, int h, int x0, int y0, int x1, int y1, unsigned int color,
+static void draw_line_c4(unsigned char* pixels, int w, int h, int stride, int x0, int y0, int x1, int y1, unsigned int color,
                          int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 4;
 
     const float t0 = thickness / 2.f;
     const float t1 = thickness - t0;
@@ -1082,7 +1071,7 @@ static void draw_line_c4(unsigned char* pixels, int w, int h, int x0, int y0, in
     }
 }
 
-static void draw_line_yuv420sp(unsigned char* yuv420sp, int w, int h, int x0, int y0, int x1, int y1,
+static void draw_line_yuv420sp(unsigned char* yuv420sp, unsigned char* uv, int w, int h, int stride, int x0, int y0, int x1, int y1,
                                unsigned int color, int thickness)
 {
     // assert w % 2 == 0
@@ -1104,11 +1093,11 @@ static void draw_line_yuv420sp(unsigned char* yuv420sp, int w, int h, int x0, in
     pen_color_uv[1] = pen_color[2];
 
     unsigned char* Y = yuv420sp;
-    draw_line_c1(Y, w, h, x0, y0, x1, y1, v_y, thickness);
+    draw_line_c1(Y, w, h, stride, x0, y0, x1, y1, v_y, thickness);
 
-    unsigned char* UV = yuv420sp + w * h;
+    unsigned char* UV = uv;
     int thickness_uv = thickness == -1 ? thickness : max(thickness / 2, 1);
-    draw_line_c2(UV, w / 2, h / 2, x0 / 2, y0 / 2, x1 / 2, y1 / 2, v_uv, thickness_uv);
+    draw_line_c2(UV, w / 2, h / 2, stride, x0 / 2, y0 / 2, x1 / 2, y1 / 2, v_uv, thickness_uv);
 }
 
 static void get_text_drawing_size(const char* text, int fontpixelsize, int* w, int* h)
@@ -1169,11 +1158,10 @@ static int resize_bilinear_c1(const unsigned char* src_pixels, int w, int h, uns
     return 0;
 }
 
-static void draw_text_c1(unsigned char* pixels, int w, int h, const char* text, int x, int y, int fontpixelsize,
+static void draw_text_c1(unsigned char* pixels, int w, int h, int stride, const char* text, int x, int y, int fontpixelsize,
                          unsigned int color)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w;
 
     unsigned char* resized_font_bitmap = malloc(fontpixelsize * fontpixelsize * 2);
 
@@ -1226,11 +1214,10 @@ static void draw_text_c1(unsigned char* pixels, int w, int h, const char* text,
     free(resized_font_bitmap);
 }
 
-static void draw_text_c2(unsigned char* pixels, int w, int h, const char* text, int x, int y, int fontpixelsize,
+static void draw_text_c2(unsigned char* pixels, int w, int h, int stride, const char* text, int x, int y, int fontpixelsize,
                          unsigned int color)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 2;
 
     unsigned char* resized_font_bitmap = malloc(fontpixelsize * fontpixelsize * 2);
 
@@ -1285,11 +1272,10 @@ static void draw_text_c2(unsigned char* pixels, int w, int h, const char* text,
     free(resized_font_bitmap);
 }
 
-static void draw_text_c3(unsigned char* pixels, int w, int h, const char* text, int x, int y, int fontpixelsize,
+static void draw_text_c3(unsigned char* pixels, int w, int h, int stride, const char* text, int x, int y, int fontpixelsize,
                          unsigned int color)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 3;
 
     unsigned char* resized_font_bitmap = malloc(fontpixelsize * fontpixelsize * 2);
 
@@ -1345,11 +1331,10 @@ static void draw_text_c3(unsigned char* pixels, int w, int h, const char* text,
     free(resized_font_bitmap);
 }
 
-static void draw_text_c4(unsigned char* pixels, int w, int h, const char* text, int x, int y, int fontpixelsize,
+static void draw_text_c4(unsigned char* pixels, int w, int h, int stride, const char* text, int x, int y, int fontpixelsize,
                          unsigned int color)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 4;
 
     unsigned char* resized_font_bitmap = malloc(fontpixelsize * fontpixelsize * 2);
 
@@ -1405,7 +1390,7 @@ static void draw_text_c4(unsigned char* pixels, int w, int h, const char* text,
     free(resized_font_bitmap);
 }
 
-static void draw_text_yuv420sp(unsigned char* yuv420sp, int w, int h, const char* text, int x, int y, int fontpixelsize,
+static void draw_text_yuv420sp(unsigned char* yuv420sp, unsigned char* uv, int w, int h, int stride, const char* text, int x, int y, int fontpixelsize,
                                unsigned int color)
 {
     // assert w % 2 == 0
@@ -1425,45 +1410,45 @@ static void draw_text_yuv420sp(unsigned char* yuv420sp, int w, int h, const char
     pen_color_uv[1] = pen_color[2];
 
     unsigned char* Y = yuv420sp;
-    draw_text_c1(Y, w, h, text, x, y, fontpixelsize, v_y);
+    draw_text_c1(Y, w, h, stride, text, x, y, fontpixelsize, v_y);
 
-    unsigned char* UV = yuv420sp + w * h;
-    draw_text_c2(UV, w / 2, h / 2, text, x / 2, y / 2, max(fontpixelsize / 2, 1), v_uv);
+    unsigned char* UV = uv;
+    draw_text_c2(UV, w / 2, h / 2, stride, text, x / 2, y / 2, max(fontpixelsize / 2, 1), v_uv);
 }
 
-static void draw_image_c1(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+static void draw_image_c1(unsigned char* pixels, int w, int h, int stride, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
     for (int i = 0; i < rh; i++) {
-        memcpy(pixels + (y + i) * w + x,  draw_img + i * rw,  rw);
+        memcpy(pixels + (y + i) * stride + x,  draw_img + i * rw,  rw);
     }
 }
 
-static void draw_image_c2(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+static void draw_image_c2(unsigned char* pixels, int w, int h, int stride, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
     for (int i = 0; i < rh; i++) {
-        memcpy(pixels + ((y + i) * w + x) * 2,  draw_img + i * rw * 2,  rw * 2);
+        memcpy(pixels + (y + i) * stride + x * 2,  draw_img + i * rw * 2,  rw * 2);
     }
 }
 
-static void draw_image_c3(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+static void draw_image_c3(unsigned char* pixels, int w, int h, int stride, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
     printf("draw_image_c3 pixels=%p wxh=%dx%d draw_img=%p pos=(%d %d) rwxrh=%dx%d\n", pixels, w, h, draw_img, x, y, rw, rh);
     for (int i = 0; i < rh; i++) {
-        memcpy(pixels + ((y + i) * w + x) * 3,  draw_img + i * rw * 3,  rw * 3);
+        memcpy(pixels + (y + i) * stride + x * 3,  draw_img + i * rw * 3,  rw * 3);
     }
 }
 
-static void draw_image_c4(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+static void draw_image_c4(unsigned char* pixels, int w, int h, int stride, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
     for (int i = 0; i < rh; i++) {
-        memcpy(pixels + ((y + i) * w + x) * 4,  draw_img + i * rw * 4,  rw * 4);
+        memcpy(pixels + (y + i) * stride + x * 4,  draw_img + i * rw * 4,  rw * 4);
     }
 }
 
-static void draw_image_yuv420sp(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+static void draw_image_yuv420sp(unsigned char* pixels, unsigned char* uv, int w, int h, int stride, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
-    draw_image_c1(pixels, w, h, draw_img, x, y, rw, rh);
-    draw_image_c2(pixels, w, h / 2, draw_img + rw * rh, x, y/2, rw, rh/2);
+    draw_image_c1(pixels, w, h, stride, draw_img, x, y, rw, rh);
+    draw_image_c1(uv, w, h / 2, stride, draw_img + rw * rh, x, y / 2, rw, rh / 2);
 }
 
 void draw_rectangle(image_buffer_t* image, int rx, int ry, int rw, int rh, unsigned int color,
@@ -1473,6 +1458,8 @@ void draw_rectangle(image_buffer_t* image, int rx, int ry, int rw, int rh, unsig
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_image_pitch(image);
+    unsigned char* uv = pixels + stride * get_image_height_stride(image);
 
     unsigned int draw_color = convert_color(color, format);
     // printf("draw_color=%x\n", draw_color);
@@ -1482,14 +1469,14 @@ void draw_rectangle(image_buffer_t* image, int rx, int ry, int rw, int rh, unsig
     switch (format)
     {
     case IMAGE_FORMAT_RGB888:
-        draw_rectangle_c3(pixels, w, h, rx, ry, rw, rh, draw_color, thickness);
+        draw_rectangle_c3(pixels, w, h, stride, rx, ry, rw, rh, draw_color, thickness);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_rectangle_c4(pixels, w, h, rx, ry, rw, rh, draw_color, thickness);
+        draw_rectangle_c4(pixels, w, h, stride, rx, ry, rw, rh, draw_color, thickness);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_rectangle_yuv420sp(pixels, w, h, rx, ry, rw, rh, draw_color, thickness);
+        draw_rectangle_yuv420sp(pixels, uv, w, h, stride, rx, ry, rw, rh, draw_color, thickness);
         break;
     default:
         printf("no support format %d", format);
@@ -1504,20 +1491,22 @@ void draw_line(image_buffer_t* image, int x0, int y0, int x1, int y1, unsigned i
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_image_pitch(image);
+    unsigned char* uv = pixels + stride * get_image_height_stride(image);
 
     unsigned draw_color = convert_color(color, format);
 
     switch (format)
     {
     case IMAGE_FORMAT_RGB888:
-        draw_line_c3(pixels, w, h, x0, y0, x1, y1, draw_color, thickness);
+        draw_line_c3(pixels, w, h, stride, x0, y0, x1, y1, draw_color, thickness);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_line_c4(pixels, w, h, x0, y0, x1, y1, draw_color, thickness);
+        draw_line_c4(pixels, w, h, stride, x0, y0, x1, y1, draw_color, thickness);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_line_yuv420sp(pixels, w, h, x0, y0, x1, y1, draw_color, thickness);
+        draw_line_yuv420sp(pixels, uv, w, h, stride, x0, y0, x1, y1, draw_color, thickness);
         break;
     default:
         printf("no support format %d", format);
@@ -1532,19 +1521,21 @@ void draw_text(image_buffer_t* image, const char* text, int x, int y, unsigned i
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_image_pitch(image);
+    unsigned char* uv = pixels + stride * get_image_height_stride(image);
     unsigned draw_color = convert_color(color, format);
 
     switch (format)
     {
     case IMAGE_FORMAT_RGB888:
-        draw_text_c3(pixels, w, h, text, x, y, fontsize, draw_color);
+        draw_text_c3(pixels, w, h, stride, text, x, y, fontsize, draw_color);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_text_c4(pixels, w, h, text, x, y, fontsize, draw_color);
+        draw_text_c4(pixels, w, h, stride, text, x, y, fontsize, draw_color);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_text_yuv420sp(pixels, w, h, text, x, y, fontsize, draw_color);
+        draw_text_yuv420sp(pixels, uv, w, h, stride, text, x, y, fontsize, draw_color);
         break;
     default:
         printf("no support format %d", format);
@@ -1559,19 +1550,21 @@ void draw_circle(image_buffer_t* image, int cx, int cy, int radius, unsigned int
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_image_pitch(image);
+    unsigned char* uv = pixels + stride * get_image_height_stride(image);
     unsigned draw_color = convert_color(color, format);
 
     switch (format)
     {
     case IMAGE_FORMAT_RGB888:
-        draw_circle_c3(pixels, w, h, cx, cy, radius, draw_color, thickness);
+        draw_circle_c3(pixels, w, h, stride, cx, cy, radius, draw_color, thickness);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_circle_c4(pixels, w, h, cx, cy, radius, draw_color, thickness);
+        draw_circle_c4(pixels, w, h, stride, cx, cy, radius, draw_color, thickness);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_circle_yuv420sp(pixels, w, h, cx, cy, radius, draw_color, thickness);
+        draw_circle_yuv420sp(pixels, uv, w, h, stride, cx, cy, radius, draw_color, thickness);
         break;
     default:
         printf("no support format %d", format);
@@ -1585,18 +1578,20 @@ void draw_image(image_buffer_t* image, unsigned char* draw_img, int x, int y, in
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_image_pitch(image);
+    unsigned char* uv = pixels + stride * get_image_height_stride(image);
 
     switch (format)
     {
     case IMAGE_FORMAT_RGB888:
-        draw_image_c3(pixels, w, h, draw_img, x, y, rw, rh);
+        draw_image_c3(pixels, w, h, stride, draw_img, x, y, rw, rh);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_image_c4(pixels, w, h, draw_img, x, y, rw, rh);
+        draw_image_c4(pixels, w, h, stride, draw_img, x, y, rw, rh);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_image_yuv420sp(pixels, w, h, draw_img, x, y, rw, rh);
+        draw_image_yuv420sp(pixels, uv, w, h, stride, draw_img, x, y, rw, rh);
         break;
     default:
         printf("no support format %d", format);
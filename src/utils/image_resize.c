@@ -0,0 +1,403 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGE_RESIZE_NEON 1
+#endif
+
+#include "image_resize.h"
+#include "image_utils.h"
+#include "row_parallel.h"
+
+#define RESIZE_COEF_BITS 8
+#define RESIZE_COEF_ONE (1 << RESIZE_COEF_BITS)
+
+// pixel centers aligned, two taps clamped to the image border
+static int build_axis(int src_len, int dst_len, int **ofs, unsigned short **coef)
+{
+    *ofs = (int *)malloc(sizeof(int) * dst_len * 2);
+    *coef = (unsigned short *)malloc(sizeof(unsigned short) * dst_len * 2);
+    if (*ofs == NULL || *coef == NULL)
+    {
+        return -1;
+    }
+    float scale = (float)src_len / dst_len;
+    for (int d = 0; d < dst_len; d++)
+    {
+        float f = (d + 0.5f) * scale - 0.5f;
+        int s = (int)floorf(f);
+        float frac = f - s;
+        if (s < 0)
+        {
+            s = 0;
+            frac = 0;
+        }
+        if (s >= src_len - 1)
+        {
+            s = src_len - 1;
+            frac = 0;
+        }
+        int w1 = (int)(frac * RESIZE_COEF_ONE + 0.5f);
+        (*ofs)[d * 2] = s;
+        (*ofs)[d * 2 + 1] = s + 1 < src_len ? s + 1 : s;
+        (*coef)[d * 2] = RESIZE_COEF_ONE - w1;
+        (*coef)[d * 2 + 1] = w1;
+    }
+    return 0;
+}
+
+static void release_table(resize_table_t *table)
+{
+    free(table->x_ofs);
+    free(table->x_coef);
+    free(table->y_ofs);
+    free(table->y_coef);
+    free(table->scratch);
+    memset(table, 0, sizeof(resize_table_t));
+}
+
+static int build_table(resize_table_t *table, int src_w, int src_h, int dst_w, int dst_h)
+{
+    if (table->x_ofs != NULL && table->src_width == src_w && table->src_height == src_h &&
+        table->dst_width == dst_w && table->dst_height == dst_h)
+    {
+        return 0;
+    }
+    release_table(table);
+    if (src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0)
+    {
+        return -1;
+    }
+    if (build_axis(src_w, dst_w, &table->x_ofs, &table->x_coef) != 0 ||
+        build_axis(src_h, dst_h, &table->y_ofs, &table->y_coef) != 0)
+    {
+        printf("resize table malloc fail %dx%d->%dx%d\n", src_w, src_h, dst_w, dst_h);
+        release_table(table);
+        return -1;
+    }
+    table->src_width = src_w;
+    table->src_height = src_h;
+    table->dst_width = dst_w;
+    table->dst_height = dst_h;
+    return 0;
+}
+
+int image_resizer_prepare(image_resizer_t *resizer, image_format_t format, int src_w, int src_h, int dst_w, int dst_h)
+{
+    resizer->format = format;
+    if (build_table(&resizer->plane, src_w, src_h, dst_w, dst_h) != 0)
+    {
+        return -1;
+    }
+    if (format == IMAGE_FORMAT_YUV420SP_NV12 || format == IMAGE_FORMAT_YUV420SP_NV21)
+    {
+        return build_table(&resizer->chroma, src_w / 2, src_h / 2, dst_w / 2, dst_h / 2);
+    }
+    release_table(&resizer->chroma);
+    return 0;
+}
+
+void image_resizer_release(image_resizer_t *resizer)
+{
+    release_table(&resizer->plane);
+    release_table(&resizer->chroma);
+}
+
+typedef struct {
+    const resize_table_t *table;
+    int channels;
+    const unsigned char *src;
+    int src_stride;
+    unsigned char *dst;
+    int dst_stride;
+} resize_task_t;
+
+#ifdef IMAGE_RESIZE_NEON
+// both taps of 8 target pixels, one pixel per lane since the source columns are not contiguous
+#define HRESIZE_LOAD_LANE(LD, CH, L)                               \
+    v0 = LD(src + x_ofs[(x + L) * 2] * CH, v0, L);                  \
+    v1 = LD(src + x_ofs[(x + L) * 2 + 1] * CH, v1, L);
+#define HRESIZE_LOAD(LD, CH)                                       \
+    HRESIZE_LOAD_LANE(LD, CH, 0)                                   \
+    HRESIZE_LOAD_LANE(LD, CH, 1)                                   \
+    HRESIZE_LOAD_LANE(LD, CH, 2)                                   \
+    HRESIZE_LOAD_LANE(LD, CH, 3)                                   \
+    HRESIZE_LOAD_LANE(LD, CH, 4)                                   \
+    HRESIZE_LOAD_LANE(LD, CH, 5)                                   \
+    HRESIZE_LOAD_LANE(LD, CH, 6)                                   \
+    HRESIZE_LOAD_LANE(LD, CH, 7)
+
+// p0 * w0 + p1 * w1 stays below 65536 as w0 + w1 == 256
+static inline uint16x8_t hresize_lerp(uint8x8_t p0, uint8x8_t p1, uint16x8x2_t w)
+{
+    return vmlaq_u16(vmulq_u16(vmovl_u8(p0), w.val[0]), vmovl_u8(p1), w.val[1]);
+}
+
+// channels planar in the registers, interleaved again by the store; returns the pixels done
+#define HRESIZE_NEON_CASE(CH, VTYPE, RTYPE, LD, ST)                     \
+    case CH:                                                            \
+    {                                                                   \
+        VTYPE v0, v1;                                                   \
+        for (int c = 0; c < CH; c++)                                    \
+        {                                                               \
+            v0.val[c] = vdup_n_u8(0);                                   \
+            v1.val[c] = vdup_n_u8(0);                                   \
+        }                                                               \
+        for (; x + 8 <= dst_w; x += 8)                                  \
+        {                                                               \
+            HRESIZE_LOAD(LD, CH)                                        \
+            uint16x8x2_t w = vld2q_u16(x_coef + x * 2);                 \
+            RTYPE r;                                                    \
+            for (int c = 0; c < CH; c++)                                \
+            {                                                           \
+                r.val[c] = hresize_lerp(v0.val[c], v1.val[c], w);       \
+            }                                                           \
+            ST(dst + x * CH, r);                                        \
+        }                                                               \
+    }                                                                   \
+    break;
+
+static int hresize_row_neon(const resize_table_t *table, int channels, const unsigned char *src, unsigned short *dst)
+{
+    const int *x_ofs = table->x_ofs;
+    const unsigned short *x_coef = table->x_coef;
+    int dst_w = table->dst_width;
+    int x = 0;
+    if (channels == 1)
+    {
+        uint8x8_t v0 = vdup_n_u8(0);
+        uint8x8_t v1 = vdup_n_u8(0);
+        for (; x + 8 <= dst_w; x += 8)
+        {
+            HRESIZE_LOAD(vld1_lane_u8, 1)
+            vst1q_u16(dst + x, hresize_lerp(v0, v1, vld2q_u16(x_coef + x * 2)));
+        }
+        return x;
+    }
+    switch (channels)
+    {
+        HRESIZE_NEON_CASE(2, uint8x8x2_t, uint16x8x2_t, vld2_lane_u8, vst2q_u16)
+        HRESIZE_NEON_CASE(3, uint8x8x3_t, uint16x8x3_t, vld3_lane_u8, vst3q_u16)
+        HRESIZE_NEON_CASE(4, uint8x8x4_t, uint16x8x4_t, vld4_lane_u8, vst4q_u16)
+    default:
+        break;
+    }
+    return x;
+}
+#endif
+
+// horizontal pass into Q8, the channel count is a constant in each case so the inner loop unrolls
+#define HRESIZE_CASE(CH)                                                     \
+    case CH:                                                                 \
+        for (; x < dst_w; x++)                                               \
+        {                                                                    \
+            const unsigned char *p0 = src + x_ofs[x * 2] * CH;               \
+            const unsigned char *p1 = src + x_ofs[x * 2 + 1] * CH;           \
+            int w0 = x_coef[x * 2];                                          \
+            int w1 = x_coef[x * 2 + 1];                                      \
+            for (int c = 0; c < CH; c++)                                     \
+            {                                                                \
+                dst[x * CH + c] = (unsigned short)(p0[c] * w0 + p1[c] * w1); \
+            }                                                                \
+        }                                                                    \
+        break;
+
+static void hresize_row(const resize_table_t *table, int channels, const unsigned char *src, unsigned short *dst)
+{
+    const int *x_ofs = table->x_ofs;
+    const unsigned short *x_coef = table->x_coef;
+    int dst_w = table->dst_width;
+    int x = 0;
+#ifdef IMAGE_RESIZE_NEON
+    x = hresize_row_neon(table, channels, src, dst);
+#endif
+    switch (channels)
+    {
+        HRESIZE_CASE(1)
+        HRESIZE_CASE(2)
+        HRESIZE_CASE(3)
+        HRESIZE_CASE(4)
+    default:
+        break;
+    }
+}
+
+static void vresize_row(const unsigned short *h0, const unsigned short *h1, int w0, int w1, unsigned char *dst, int len)
+{
+    int i = 0;
+#ifdef IMAGE_RESIZE_NEON
+    for (; i + 8 <= len; i += 8)
+    {
+        uint16x8_t a = vld1q_u16(h0 + i);
+        uint16x8_t b = vld1q_u16(h1 + i);
+        uint32x4_t lo = vmull_n_u16(vget_low_u16(a), w0);
+        uint32x4_t hi = vmull_n_u16(vget_high_u16(a), w0);
+        lo = vmlal_n_u16(lo, vget_low_u16(b), w1);
+        hi = vmlal_n_u16(hi, vget_high_u16(b), w1);
+        uint16x8_t r = vcombine_u16(vrshrn_n_u32(lo, 2 * RESIZE_COEF_BITS), vrshrn_n_u32(hi, 2 * RESIZE_COEF_BITS));
+        vst1_u8(dst + i, vqmovn_u16(r));
+    }
+#endif
+    for (; i < len; i++)
+    {
+        unsigned int v = (h0[i] * w0 + h1[i] * w1 + (1 << (2 * RESIZE_COEF_BITS - 1))) >> (2 * RESIZE_COEF_BITS);
+        dst[i] = v > 255 ? 255 : v;
+    }
+}
+
+static void resize_stripe(void *arg, int stripe, int row_begin, int row_end)
+{
+    resize_task_t *t = (resize_task_t *)arg;
+    const resize_table_t *table = t->table;
+    int row_len = table->dst_width * t->channels;
+    unsigned short *buf = table->scratch + stripe * row_len * 2;
+    // the two last horizontally scaled source rows, reused while upscaling
+    unsigned short *rows[2] = {buf, buf + row_len};
+    int cached[2] = {-1, -1};
+
+    for (int dy = row_begin; dy < row_end; dy++)
+    {
+        int sy0 = table->y_ofs[dy * 2];
+        int sy1 = table->y_ofs[dy * 2 + 1];
+        int s0 = cached[0] == sy0 ? 0 : (cached[1] == sy0 ? 1 : -1);
+        int s1 = cached[0] == sy1 ? 0 : (cached[1] == sy1 ? 1 : -1);
+        if (s0 < 0)
+        {
+            s0 = s1 == 0 ? 1 : 0;
+            hresize_row(table, t->channels, t->src + sy0 * t->src_stride, rows[s0]);
+            cached[s0] = sy0;
+        }
+        if (s1 < 0)
+        {
+            s1 = s0 == 0 ? 1 : 0;
+            hresize_row(table, t->channels, t->src + sy1 * t->src_stride, rows[s1]);
+            cached[s1] = sy1;
+        }
+        vresize_row(rows[s0], rows[s1], table->y_coef[dy * 2], table->y_coef[dy * 2 + 1],
+                    t->dst + dy * t->dst_stride, row_len);
+    }
+}
+
+static int resize_plane(resize_table_t *table, int channels, const unsigned char *src, int src_stride,
+                        unsigned char *dst, int dst_stride, int num_threads)
+{
+    int scratch_size = table->dst_width * channels * 2 * ROW_PARALLEL_MAX_THREADS;
+    if (table->scratch_size < scratch_size)
+    {
+        free(table->scratch);
+        table->scratch = (unsigned short *)malloc(sizeof(unsigned short) * scratch_size);
+        if (table->scratch == NULL)
+        {
+            printf("resize scratch malloc fail %d\n", scratch_size);
+            table->scratch_size = 0;
+            return -1;
+        }
+        table->scratch_size = scratch_size;
+    }
+
+    resize_task_t t;
+    t.table = table;
+    t.channels = channels;
+    t.src = src;
+    t.src_stride = src_stride;
+    t.dst = dst;
+    t.dst_stride = dst_stride;
+    if (row_parallel_for(table->dst_height, 1, num_threads, resize_stripe, &t) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int get_channels(image_format_t format)
+{
+    switch (format)
+    {
+    case IMAGE_FORMAT_GRAY8:
+    case IMAGE_FORMAT_YUV420SP_NV12:
+    case IMAGE_FORMAT_YUV420SP_NV21:
+        return 1;
+    case IMAGE_FORMAT_RGB888:
+        return 3;
+    case IMAGE_FORMAT_RGBA8888:
+        return 4;
+    default:
+        return -1;
+    }
+}
+
+int resize_image_bilinear(image_resizer_t *resizer, image_buffer_t *src, image_rect_t *src_box,
+                          image_buffer_t *dst, image_rect_t *dst_box, int num_threads)
+{
+    if (src->virt_addr == NULL || dst->virt_addr == NULL || src->format != dst->format)
+    {
+        return -1;
+    }
+    int channels = get_channels(src->format);
+    if (channels < 0)
+    {
+        printf("resize no support format %d\n", src->format);
+        return -1;
+    }
+    int yuv = src->format == IMAGE_FORMAT_YUV420SP_NV12 || src->format == IMAGE_FORMAT_YUV420SP_NV21;
+
+    int sx = 0, sy = 0, sw = src->width, sh = src->height;
+    if (src_box != NULL)
+    {
+        sx = src_box->left;
+        sy = src_box->top;
+        sw = src_box->right - src_box->left + 1;
+        sh = src_box->bottom - src_box->top + 1;
+    }
+    int dx = 0, dy = 0, dw = dst->width, dh = dst->height;
+    if (dst_box != NULL)
+    {
+        dx = dst_box->left;
+        dy = dst_box->top;
+        dw = dst_box->right - dst_box->left + 1;
+        dh = dst_box->bottom - dst_box->top + 1;
+    }
+    if (sx < 0 || sy < 0 || sx + sw > src->width || sy + sh > src->height ||
+        dx < 0 || dy < 0 || dx + dw > dst->width || dy + dh > dst->height)
+    {
+        printf("resize box out of image\n");
+        return -1;
+    }
+    if (yuv && ((sx | sy | sw | sh | dx | dy | dw | dh) & 1))
+    {
+        printf("resize yuv420sp box must be even\n");
+        return -1;
+    }
+
+    image_resizer_t local;
+    image_resizer_t *r = resizer;
+    if (r == NULL)
+    {
+        memset(&local, 0, sizeof(image_resizer_t));
+        r = &local;
+    }
+    int ret = image_resizer_prepare(r, src->format, sw, sh, dw, dh);
+    if (ret == 0)
+    {
+        int src_stride = get_image_pitch(src);
+        int dst_stride = get_image_pitch(dst);
+        ret = resize_plane(&r->plane, channels, src->virt_addr + sy * src_stride + sx * channels, src_stride,
+                           dst->virt_addr + dy * dst_stride + dx * channels, dst_stride, num_threads);
+        if (ret == 0 && yuv)
+        {
+            // interleaved chroma at half resolution, the box halves as well
+            unsigned char *src_uv = src->virt_addr + src_stride * get_image_height_stride(src);
+            unsigned char *dst_uv = dst->virt_addr + dst_stride * get_image_height_stride(dst);
+            ret = resize_plane(&r->chroma, 2, src_uv + (sy / 2) * src_stride + sx, src_stride,
+                               dst_uv + (dy / 2) * dst_stride + dx, dst_stride, num_threads);
+        }
+    }
+    if (r == &local)
+    {
+        image_resizer_release(&local);
+    }
+    return ret;
+}
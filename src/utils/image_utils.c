@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <dirent.h>
 #include <math.h>
 #include <sys/time.h>
@@ -9,6 +10,8 @@
 
 #include "image_utils.h"
 #include "file_utils.h"
+#include "rga_scheduler.h"
+#include "color_convert.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -66,103 +69,8 @@ static int read_image_raw(const char *path, image_buffer_t *image)
     return 0;
 }
 
-static int crop_and_scale_image_c(int channel, unsigned char *src, int src_width, int src_height,
-                                  int crop_x, int crop_y, int crop_width, int crop_height,
-                                  unsigned char *dst, int dst_width, int dst_height,
-                                  int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height)
-{
-    if (dst == NULL)
-    {
-        printf("dst buffer is null\n");
-        return -1;
-    }
-
-    float x_ratio = (float)crop_width / (float)dst_box_width;
-    float y_ratio = (float)crop_height / (float)dst_box_height;
-
-    // printf("src_width=%d src_height=%d crop_x=%d crop_y=%d crop_width=%d crop_height=%d\n",
-    //     src_width, src_height, crop_x, crop_y, crop_width, crop_height);
-    // printf("dst_width=%d dst_height=%d dst_box_x=%d dst_box_y=%d dst_box_width=%d dst_box_height=%d\n",
-    //     dst_width, dst_height, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
-    // printf("channel=%d x_ratio=%f y_ratio=%f\n", channel, x_ratio, y_ratio);
-
-    // 从原图指定区域取数据，双线性缩放到目标指定区域
-    for (int dst_y = dst_box_y; dst_y < dst_box_y + dst_box_height; dst_y++)
-    {
-        for (int dst_x = dst_box_x; dst_x < dst_box_x + dst_box_width; dst_x++)
-        {
-            int dst_x_offset = dst_x - dst_box_x;
-            int dst_y_offset = dst_y - dst_box_y;
-
-            int src_x = (int)(dst_x_offset * x_ratio) + crop_x;
-            int src_y = (int)(dst_y_offset * y_ratio) + crop_y;
-
-            float x_diff = (dst_x_offset * x_ratio) - (src_x - crop_x);
-            float y_diff = (dst_y_offset * y_ratio) - (src_y - crop_y);
-
-            int index1 = src_y * src_width * channel + src_x * channel;
-            int index2 = index1 + src_width * channel; // down
-            if (src_y == src_height - 1)
-            {
-                // 如果到图像最下边缘，变成选择上面的像素
-                index2 = index1 - src_width * channel;
-            }
-            int index3 = index1 + 1 * channel; // right
-            int index4 = index2 + 1 * channel; // down right
-            if (src_x == src_width - 1)
-            {
-                // 如果到图像最右边缘，变成选择左边的像素
-                index3 = index1 - 1 * channel;
-                index4 = index2 - 1 * channel;
-            }
-
-            // printf("dst_x=%d dst_y=%d dst_x_offset=%d dst_y_offset=%d src_x=%d src_y=%d x_diff=%f y_diff=%f src index=%d %d %d %d\n",
-            //     dst_x, dst_y, dst_x_offset, dst_y_offset,
-            //     src_x, src_y, x_diff, y_diff,
-            //     index1, index2, index3, index4);
-
-            for (int c = 0; c < channel; c++)
-            {
-                unsigned char A = src[index1 + c];
-                unsigned char B = src[index3 + c];
-                unsigned char C = src[index2 + c];
-                unsigned char D = src[index4 + c];
-
-                unsigned char pixel = (unsigned char)(A * (1 - x_diff) * (1 - y_diff) +
-                                                      B * x_diff * (1 - y_diff) +
-                                                      C * y_diff * (1 - x_diff) +
-                                                      D * x_diff * y_diff);
-
-                dst[(dst_y * dst_width + dst_x) * channel + c] = pixel;
-            }
-        }
-    }
-
-    return 0;
-}
-
-static int crop_and_scale_image_yuv420sp(unsigned char *src, int src_width, int src_height,
-                                         int crop_x, int crop_y, int crop_width, int crop_height,
-                                         unsigned char *dst, int dst_width, int dst_height,
-                                         int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height)
-{
-
-    unsigned char *src_y = src;
-    unsigned char *src_uv = src + src_width * src_height;
-
-    unsigned char *dst_y = dst;
-    unsigned char *dst_uv = dst + dst_width * dst_height;
-
-    crop_and_scale_image_c(1, src_y, src_width, src_height, crop_x, crop_y, crop_width, crop_height,
-                           dst_y, dst_width, dst_height, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
-
-    crop_and_scale_image_c(2, src_uv, src_width / 2, src_height / 2, crop_x / 2, crop_y / 2, crop_width / 2, crop_height / 2,
-                           dst_uv, dst_width / 2, dst_height / 2, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
-
-    return 0;
-}
-
-static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rect_t *src_box, image_rect_t *dst_box, char color)
+static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rect_t *src_box, image_rect_t *dst_box, char color, int fill_pad,
+                             image_resizer_t *resizer, int num_threads)
 {
     int ret;
     if (dst->virt_addr == NULL)
@@ -175,83 +83,49 @@ static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rec
     }
     if (src->format != dst->format)
     {
-        return -1;
-    }
-
-    int src_box_x = 0;
-    int src_box_y = 0;
-    int src_box_w = src->width;
-    int src_box_h = src->height;
-    if (src_box != NULL)
-    {
-        src_box_x = src_box->left;
-        src_box_y = src_box->top;
-        src_box_w = src_box->right - src_box->left + 1;
-        src_box_h = src_box->bottom - src_box->top + 1;
-    }
-    int dst_box_x = 0;
-    int dst_box_y = 0;
-    int dst_box_w = dst->width;
-    int dst_box_h = dst->height;
-    if (dst_box != NULL)
-    {
-        dst_box_x = dst_box->left;
-        dst_box_y = dst_box->top;
-        dst_box_w = dst_box->right - dst_box->left + 1;
-        dst_box_h = dst_box->bottom - dst_box->top + 1;
+        if (src->width == dst->width && src->height == dst->height && src_box == NULL && dst_box == NULL)
+        {
+            return convert_color_cpu(src, dst, num_threads);
+        }
+        // convert colour at source size first, then crop and scale in the target format
+        image_buffer_t tmp;
+        memset(&tmp, 0, sizeof(image_buffer_t));
+        tmp.width = src->width;
+        tmp.height = src->height;
+        tmp.format = dst->format;
+        tmp.size = get_image_size(&tmp);
+        tmp.virt_addr = (unsigned char *)malloc(tmp.size);
+        if (tmp.virt_addr == NULL)
+        {
+            return -1;
+        }
+        ret = convert_color_cpu(src, &tmp, num_threads);
+        if (ret == 0)
+        {
+            ret = convert_image_cpu(&tmp, dst, src_box, dst_box, color, fill_pad, resizer, num_threads);
+        }
+        free(tmp.virt_addr);
+        return ret;
     }
 
     // fill pad color
-    if (dst_box_w != dst->width || dst_box_h != dst->height)
+    if (fill_pad && dst_box != NULL &&
+        (dst_box->left != 0 || dst_box->top != 0 || dst_box->right != dst->width - 1 || dst_box->bottom != dst->height - 1))
     {
         int dst_size = get_image_size(dst);
         memset(dst->virt_addr, color, dst_size);
     }
 
-    int need_release_dst_buffer = 0;
-    int reti = 0;
-    if (src->format == IMAGE_FORMAT_RGB888)
-    {
-        reti = crop_and_scale_image_c(3, src->virt_addr, src->width, src->height,
-                                      src_box_x, src_box_y, src_box_w, src_box_h,
-                                      dst->virt_addr, dst->width, dst->height,
-                                      dst_box_x, dst_box_y, dst_box_w, dst_box_h);
-    }
-    else if (src->format == IMAGE_FORMAT_RGBA8888)
-    {
-        reti = crop_and_scale_image_c(4, src->virt_addr, src->width, src->height,
-                                      src_box_x, src_box_y, src_box_w, src_box_h,
-                                      dst->virt_addr, dst->width, dst->height,
-                                      dst_box_x, dst_box_y, dst_box_w, dst_box_h);
-    }
-    else if (src->format == IMAGE_FORMAT_GRAY8)
-    {
-        reti = crop_and_scale_image_c(1, src->virt_addr, src->width, src->height,
-                                      src_box_x, src_box_y, src_box_w, src_box_h,
-                                      dst->virt_addr, dst->width, dst->height,
-                                      dst_box_x, dst_box_y, dst_box_w, dst_box_h);
-    }
-    else if (src->format == IMAGE_FORMAT_YUV420SP_NV12 || src->format == IMAGE_FORMAT_YUV420SP_NV21)
-    {
-        reti = crop_and_scale_image_yuv420sp(src->virt_addr, src->width, src->height,
-                                             src_box_x, src_box_y, src_box_w, src_box_h,
-                                             dst->virt_addr, dst->width, dst->height,
-                                             dst_box_x, dst_box_y, dst_box_w, dst_box_h);
-    }
-    else
-    {
-        printf("no support format %d\n", src->format);
-    }
-    if (reti != 0)
+    ret = resize_image_bilinear(resizer, src, src_box, dst, dst_box, num_threads);
+    if (ret != 0)
     {
-        printf("convert_image_cpu fail %d\n", reti);
+        printf("convert_image_cpu fail %d\n", ret);
         return -1;
     }
-    printf("finish\n");
     return 0;
 }
 
-static int get_rga_fmt(image_format_t fmt)
+int get_rga_fmt(image_format_t fmt)
 {
     switch (fmt)
     {
@@ -270,36 +144,62 @@ static int get_rga_fmt(image_format_t fmt)
     }
 }
 
+int get_image_width_stride(const image_buffer_t *image)
+{
+    return image->width_stride > 0 ? image->width_stride : image->width;
+}
+
+int get_image_height_stride(const image_buffer_t *image)
+{
+    return image->height_stride > 0 ? image->height_stride : image->height;
+}
+
+int get_image_pitch(const image_buffer_t *image)
+{
+    int wstride = get_image_width_stride(image);
+    switch (image->format)
+    {
+    case IMAGE_FORMAT_GRAY8:
+    case IMAGE_FORMAT_YUV420SP_NV12:
+    case IMAGE_FORMAT_YUV420SP_NV21:
+        return wstride;
+    case IMAGE_FORMAT_RGB888:
+        return wstride * 3;
+    case IMAGE_FORMAT_RGBA8888:
+        return wstride * 4;
+    case IMAGE_FORMAT_YUYV_422:
+        return wstride * 2;
+    default:
+        return 0;
+    }
+}
+
 int get_image_size(image_buffer_t *image)
 {
     if (image == NULL)
     {
         return 0;
     }
+    int pitch = get_image_pitch(image);
+    int hstride = get_image_height_stride(image);
     switch (image->format)
     {
-    case IMAGE_FORMAT_GRAY8:
-        return image->width * image->height;
-    case IMAGE_FORMAT_RGB888:
-        return image->width * image->height * 3;
-    case IMAGE_FORMAT_RGBA8888:
-        return image->width * image->height * 4;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        return image->width * image->height * 3 / 2;
-    case IMAGE_FORMAT_YUYV_422:
-        return image->width * image->height * 2;
+        return pitch * hstride * 3 / 2;
     default:
-        break;
+        return pitch * hstride;
     }
 }
 
-static int convert_image_rga(image_buffer_t *src_img, image_buffer_t *dst_img, image_rect_t *src_box, image_rect_t *dst_box, char color)
+static int convert_image_rga(image_buffer_t *src_img, image_buffer_t *dst_img, image_rect_t *src_box, image_rect_t *dst_box, char color, int fill_pad)
 {
     int ret = 0;
 
     int srcWidth = src_img->width;
     int srcHeight = src_img->height;
+    int srcWstride = get_image_width_stride(src_img);
+    int srcHstride = get_image_height_stride(src_img);
     void *src = src_img->virt_addr;
     int src_fd = src_img->fd;
     void *src_phy = NULL;
@@ -307,6 +207,8 @@ static int convert_image_rga(image_buffer_t *src_img, image_buffer_t *dst_img, i
 
     int dstWidth = dst_img->width;
     int dstHeight = dst_img->height;
+    int dstWstride = get_image_width_stride(dst_img);
+    int dstHstride = get_image_height_stride(dst_img);
     void *dst = dst_img->virt_addr;
     int dst_fd = dst_img->fd;
     void *dst_phy = NULL;
@@ -367,6 +269,25 @@ static int convert_image_rga(image_buffer_t *src_img, image_buffer_t *dst_img, i
         drect.height = dstHeight;
     }
 
+    // pick the least loaded core able to run this job
+    int sched_core = -1;
+    rga_sched_request_t sched_request;
+    sched_request.src_format = src_img->format;
+    sched_request.dst_format = dst_img->format;
+    sched_request.src_width = srect.width;
+    sched_request.src_height = srect.height;
+    sched_request.dst_width = drect.width;
+    sched_request.dst_height = drect.height;
+    int im_core = rga_scheduler_acquire(&sched_request, &sched_core);
+    if (im_core < 0)
+    {
+        return -1;
+    }
+    if (im_core > 0)
+    {
+        imconfig(IM_CONFIG_SCHEDULER_CORE, im_core);
+    }
+
     // set rga buffer
     rga_buffer_t rga_buf_src;
     rga_buffer_t rga_buf_dst;
@@ -376,13 +297,13 @@ static int convert_image_rga(image_buffer_t *src_img, image_buffer_t *dst_img, i
     memset(&pat, 0, sizeof(rga_buffer_t));
 
     im_handle_param_t in_param;
-    in_param.width = srcWidth;
-    in_param.height = srcHeight;
+    in_param.width = srcWstride;
+    in_param.height = srcHstride;
     in_param.format = srcFmt;
 
     im_handle_param_t dst_param;
-    dst_param.width = dstWidth;
-    dst_param.height = dstHeight;
+    dst_param.width = dstWstride;
+    dst_param.height = dstHstride;
     dst_param.format = dstFmt;
 
     if (use_handle)
@@ -405,21 +326,21 @@ static int convert_image_rga(image_buffer_t *src_img, image_buffer_t *dst_img, i
             ret = -1;
             goto err;
         }
-        rga_buf_src = wrapbuffer_handle(rga_handle_src, srcWidth, srcHeight, srcFmt, srcWidth, srcHeight);
+        rga_buf_src = wrapbuffer_handle(rga_handle_src, srcWidth, srcHeight, srcFmt, srcWstride, srcHstride);
     }
     else
     {
         if (src_phy != NULL)
         {
-            rga_buf_src = wrapbuffer_physicaladdr(src_phy, srcWidth, srcHeight, srcFmt, srcWidth, srcHeight);
+            rga_buf_src = wrapbuffer_physicaladdr(src_phy, srcWidth, srcHeight, srcFmt, srcWstride, srcHstride);
         }
         else if (src_fd > 0)
         {
-            rga_buf_src = wrapbuffer_fd(src_fd, srcWidth, srcHeight, srcFmt, srcWidth, srcHeight);
+            rga_buf_src = wrapbuffer_fd(src_fd, srcWidth, srcHeight, srcFmt, srcWstride, srcHstride);
         }
         else
         {
-            rga_buf_src = wrapbuffer_virtualaddr(src, srcWidth, srcHeight, srcFmt, srcWidth, srcHeight);
+            rga_buf_src = wrapbuffer_virtualaddr(src, srcWidth, srcHeight, srcFmt, srcWstride, srcHstride);
         }
     }
 
@@ -443,25 +364,25 @@ static int convert_image_rga(image_buffer_t *src_img, image_buffer_t *dst_img, i
             ret = -1;
             goto err;
         }
-        rga_buf_dst = wrapbuffer_handle(rga_handle_dst, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+        rga_buf_dst = wrapbuffer_handle(rga_handle_dst, dstWidth, dstHeight, dstFmt, dstWstride, dstHstride);
     }
     else
     {
         if (dst_phy != NULL)
         {
-            rga_buf_dst = wrapbuffer_physicaladdr(dst_phy, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+            rga_buf_dst = wrapbuffer_physicaladdr(dst_phy, dstWidth, dstHeight, dstFmt, dstWstride, dstHstride);
         }
         else if (dst_fd > 0)
         {
-            rga_buf_dst = wrapbuffer_fd(dst_fd, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+            rga_buf_dst = wrapbuffer_fd(dst_fd, dstWidth, dstHeight, dstFmt, dstWstride, dstHstride);
         }
         else
         {
-            rga_buf_dst = wrapbuffer_virtualaddr(dst, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+            rga_buf_dst = wrapbuffer_virtualaddr(dst, dstWidth, dstHeight, dstFmt, dstWstride, dstHstride);
         }
     }
 
-    if (drect.width != dstWidth || drect.height != dstHeight)
+    if (fill_pad && (drect.width != dstWidth || drect.height != dstHeight))
     {
         im_rect dst_whole_rect = {0, 0, dstWidth, dstHeight};
         int imcolor;
@@ -470,9 +391,14 @@ static int convert_image_rga(image_buffer_t *src_img, image_buffer_t *dst_img, i
         p_imcolor[1] = color;
         p_imcolor[2] = color;
         p_imcolor[3] = color;
-        printf("fill dst image (x y w h)=(%d %d %d %d) with color=0x%x\n",
-               dst_whole_rect.x, dst_whole_rect.y, dst_whole_rect.width, dst_whole_rect.height, imcolor);
-        ret_rga = imfill(rga_buf_dst, dst_whole_rect, imcolor);
+        if (rga_scheduler_core_can_fill(sched_core))
+        {
+            ret_rga = imfill(rga_buf_dst, dst_whole_rect, imcolor);
+        }
+        else
+        {
+            ret_rga = IM_STATUS_NOT_SUPPORTED;
+        }
         if (ret_rga <= 0)
         {
             if (dst != NULL)
@@ -497,6 +423,8 @@ static int convert_image_rga(image_buffer_t *src_img, image_buffer_t *dst_img, i
     }
 
 err:
+    rga_scheduler_release(sched_core);
+
     if (rga_handle_src > 0)
     {
         releasebuffer_handle(rga_handle_src);
@@ -511,41 +439,28 @@ err:
     return ret;
 }
 
-int convert_image(image_buffer_t *src_img, image_buffer_t *dst_img, image_rect_t *src_box, image_rect_t *dst_box, char color)
+static int convert_image_impl(image_buffer_t *src_img, image_buffer_t *dst_img, image_rect_t *src_box, image_rect_t *dst_box, char color, int fill_pad,
+                              image_resizer_t *resizer, int num_threads)
 {
     int ret;
 
-    printf("src width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d\n",
-           src_img->width, src_img->height, src_img->format, src_img->virt_addr, src_img->fd);
-    printf("dst width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d\n",
-           dst_img->width, dst_img->height, dst_img->format, dst_img->virt_addr, dst_img->fd);
-    if (src_box != NULL)
-    {
-        printf("src_box=(%d %d %d %d)\n", src_box->left, src_box->top, src_box->right, src_box->bottom);
-    }
-    if (dst_box != NULL)
-    {
-        printf("dst_box=(%d %d %d %d)\n", dst_box->left, dst_box->top, dst_box->right, dst_box->bottom);
-    }
-    printf("color=0x%x\n", color);
-
-    ret = convert_image_rga(src_img, dst_img, src_box, dst_box, color);
+    ret = convert_image_rga(src_img, dst_img, src_box, dst_box, color, fill_pad);
     if (ret != 0)
     {
         printf("try convert image use cpu\n");
-        ret = convert_image_cpu(src_img, dst_img, src_box, dst_box, color);
+        ret = convert_image_cpu(src_img, dst_img, src_box, dst_box, color, fill_pad, resizer, num_threads);
     }
     return ret;
 }
 
-int convert_image_with_letterbox(image_buffer_t *src_image, image_buffer_t *dst_image, letterbox_t *letterbox, char color)
+int convert_image(image_buffer_t *src_img, image_buffer_t *dst_img, image_rect_t *src_box, image_rect_t *dst_box, char color)
+{
+    return convert_image_impl(src_img, dst_img, src_box, dst_box, color, 1, NULL, 0);
+}
+
+int get_letterbox_box(int src_w, int src_h, int dst_w, int dst_h, image_rect_t *dst_box, letterbox_t *letterbox)
 {
-    int ret = 0;
     int allow_slight_change = 1;
-    int src_w = src_image->width;
-    int src_h = src_image->height;
-    int dst_w = dst_image->width;
-    int dst_h = dst_image->height;
     int resize_w = dst_w;
     int resize_h = dst_h;
 
@@ -556,17 +471,15 @@ int convert_image_with_letterbox(image_buffer_t *src_image, image_buffer_t *dst_
     int _top_offset = 0;
     float scale = 1.0;
 
-    image_rect_t src_box;
-    src_box.left = 0;
-    src_box.top = 0;
-    src_box.right = src_image->width - 1;
-    src_box.bottom = src_image->height - 1;
+    if (src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0)
+    {
+        return -1;
+    }
 
-    image_rect_t dst_box;
-    dst_box.left = 0;
-    dst_box.top = 0;
-    dst_box.right = dst_image->width - 1;
-    dst_box.bottom = dst_image->height - 1;
+    dst_box->left = 0;
+    dst_box->top = 0;
+    dst_box->right = dst_w - 1;
+    dst_box->bottom = dst_h - 1;
 
     float _scale_w = (float)dst_w / src_w;
     float _scale_h = (float)dst_h / src_h;
@@ -595,35 +508,32 @@ int convert_image_with_letterbox(image_buffer_t *src_image, image_buffer_t *dst_
     // center
     if (_scale_w < _scale_h)
     {
-        dst_box.top = padding_h / 2;
-        if (dst_box.top % 2 != 0)
+        dst_box->top = padding_h / 2;
+        if (dst_box->top % 2 != 0)
         {
-            dst_box.top -= dst_box.top % 2;
-            if (dst_box.top < 0)
+            dst_box->top -= dst_box->top % 2;
+            if (dst_box->top < 0)
             {
-                dst_box.top = 0;
+                dst_box->top = 0;
             }
         }
-        dst_box.bottom = dst_box.top + resize_h - 1;
-        _top_offset = dst_box.top;
+        dst_box->bottom = dst_box->top + resize_h - 1;
+        _top_offset = dst_box->top;
     }
     else
     {
-        dst_box.left = padding_w / 2;
-        if (dst_box.left % 2 != 0)
+        dst_box->left = padding_w / 2;
+        if (dst_box->left % 2 != 0)
         {
-            dst_box.left -= dst_box.left % 2;
-            if (dst_box.left < 0)
+            dst_box->left -= dst_box->left % 2;
+            if (dst_box->left < 0)
             {
-                dst_box.left = 0;
+                dst_box->left = 0;
             }
         }
-        dst_box.right = dst_box.left + resize_w - 1;
-        _left_offset = dst_box.left;
+        dst_box->right = dst_box->left + resize_w - 1;
+        _left_offset = dst_box->left;
     }
-    printf("scale=%f dst_box=(%d %d %d %d) allow_slight_change=%d _left_offset=%d _top_offset=%d padding_w=%d padding_h=%d\n",
-           scale, dst_box.left, dst_box.top, dst_box.right, dst_box.bottom, allow_slight_change,
-           _left_offset, _top_offset, padding_w, padding_h);
 
     // set offset and scale
     if (letterbox != NULL)
@@ -632,6 +542,126 @@ int convert_image_with_letterbox(image_buffer_t *src_image, image_buffer_t *dst_
         letterbox->x_pad = _left_offset;
         letterbox->y_pad = _top_offset;
     }
+    return 0;
+}
+
+int init_letterbox_plan(letterbox_plan_t *plan, int src_w, int src_h, int dst_w, int dst_h, char color)
+{
+    // scale tables are rebuilt on the next cpu conversion if the sizes changed
+    image_resizer_t resizer = plan->resizer;
+    int num_threads = plan->num_threads;
+    memset(plan, 0, sizeof(letterbox_plan_t));
+    plan->resizer = resizer;
+    plan->num_threads = num_threads;
+    plan->src_width = src_w;
+    plan->src_height = src_h;
+    plan->dst_width = dst_w;
+    plan->dst_height = dst_h;
+    plan->color = color;
+    plan->pad_fd = -1;
+
+    plan->src_box.left = 0;
+    plan->src_box.top = 0;
+    plan->src_box.right = src_w - 1;
+    plan->src_box.bottom = src_h - 1;
+
+    int ret = get_letterbox_box(src_w, src_h, dst_w, dst_h, &plan->dst_box, &plan->letterbox);
+    if (ret != 0)
+    {
+        printf("get_letterbox_box fail! src=%dx%d dst=%dx%d\n", src_w, src_h, dst_w, dst_h);
+        return -1;
+    }
+    plan->need_pad = plan->dst_box.left != 0 || plan->dst_box.top != 0 ||
+                     plan->dst_box.right != dst_w - 1 || plan->dst_box.bottom != dst_h - 1;
+    printf("letterbox plan %dx%d->%dx%d scale=%f dst_box=(%d %d %d %d)\n", src_w, src_h, dst_w, dst_h,
+           plan->letterbox.scale, plan->dst_box.left, plan->dst_box.top, plan->dst_box.right, plan->dst_box.bottom);
+    return 0;
+}
+
+int init_letterbox_plan_crop(letterbox_plan_t *plan, int src_w, int src_h, const image_rect_t *crop, int dst_w, int dst_h,
+                             char color)
+{
+    if (crop->left < 0 || crop->top < 0 || crop->right >= src_w || crop->bottom >= src_h ||
+        crop->right < crop->left || crop->bottom < crop->top)
+    {
+        printf("letterbox crop (%d %d %d %d) out of %dx%d\n", crop->left, crop->top, crop->right, crop->bottom,
+               src_w, src_h);
+        return -1;
+    }
+    int ret = init_letterbox_plan(plan, crop->right - crop->left + 1, crop->bottom - crop->top + 1, dst_w, dst_h, color);
+    if (ret != 0)
+    {
+        return -1;
+    }
+    plan->src_width = src_w;
+    plan->src_height = src_h;
+    plan->src_box = *crop;
+    return 0;
+}
+
+void release_letterbox_plan(letterbox_plan_t *plan)
+{
+    image_resizer_release(&plan->resizer);
+}
+
+int letterbox_plan_match(const letterbox_plan_t *plan, const image_buffer_t *src_image, const image_buffer_t *dst_image)
+{
+    return plan->src_width == src_image->width && plan->src_height == src_image->height &&
+           plan->dst_width == dst_image->width && plan->dst_height == dst_image->height;
+}
+
+int letterbox_plan_begin_fill(letterbox_plan_t *plan, const image_buffer_t *dst_image)
+{
+    if (!plan->need_pad)
+    {
+        return 0;
+    }
+    // pad is only kept for the buffer it was filled on
+    if (plan->pad_filled && plan->pad_buf == dst_image->virt_addr && plan->pad_fd == dst_image->fd)
+    {
+        return 0;
+    }
+    plan->pad_filled = 1;
+    plan->pad_buf = dst_image->virt_addr;
+    plan->pad_fd = dst_image->fd;
+    return 1;
+}
+
+int convert_image_with_letterbox_plan(image_buffer_t *src_image, image_buffer_t *dst_image, letterbox_plan_t *plan)
+{
+    if (!letterbox_plan_match(plan, src_image, dst_image))
+    {
+        printf("letterbox plan %dx%d->%dx%d does not match image %dx%d->%dx%d\n",
+               plan->src_width, plan->src_height, plan->dst_width, plan->dst_height,
+               src_image->width, src_image->height, dst_image->width, dst_image->height);
+        return -1;
+    }
+    int fill_pad = letterbox_plan_begin_fill(plan, dst_image);
+    int ret = convert_image_impl(src_image, dst_image, &plan->src_box, &plan->dst_box, plan->color, fill_pad, &plan->resizer,
+                                 plan->num_threads);
+    if (ret != 0)
+    {
+        plan->pad_filled = 0;
+    }
+    return ret;
+}
+
+int convert_image_with_letterbox(image_buffer_t *src_image, image_buffer_t *dst_image, letterbox_t *letterbox, char color)
+{
+    int ret = 0;
+    letterbox_plan_t plan;
+
+    memset(&plan, 0, sizeof(letterbox_plan_t));
+    ret = init_letterbox_plan(&plan, src_image->width, src_image->height, dst_image->width, dst_image->height, color);
+    if (ret != 0)
+    {
+        return -1;
+    }
+    if (letterbox != NULL)
+    {
+        *letterbox = plan.letterbox;
+    }
+
     // alloc memory buffer for dst image,
     // remember to free
     if (dst_image->virt_addr == NULL && dst_image->fd <= 0)
@@ -644,7 +674,8 @@ int convert_image_with_letterbox(image_buffer_t *src_image, image_buffer_t *dst_
             return -1;
         }
     }
-    ret = convert_image(src_image, dst_image, &src_box, &dst_box, color);
+    ret = convert_image_with_letterbox_plan(src_image, dst_image, &plan);
+    release_letterbox_plan(&plan);
     return ret;
 }
 
@@ -656,7 +687,8 @@ int cvtcolor_rga(image_buffer_t *src_img_buf, image_format_t dst_img_format)
 
     int src_buf_size = get_image_size(src_img_buf);
 
-    int dst_buf_size = src_img_buf->width * src_img_buf->height * get_bpp_from_format(get_rga_fmt(dst_img_format));
+    int dst_buf_size = get_image_width_stride(src_img_buf) * get_image_height_stride(src_img_buf) *
+                       get_bpp_from_format(get_rga_fmt(dst_img_format));
 
     char *dst_buf = (char *)malloc(dst_buf_size);
 
@@ -670,8 +702,10 @@ int cvtcolor_rga(image_buffer_t *src_img_buf, image_format_t dst_img_format)
         printf("importbuffer failed!\n");
         goto release_buffer;
     }
-    src_img = wrapbuffer_handle(src_handle, src_img_buf->width, src_img_buf->height, src_img_buf->format);
-    dst_img = wrapbuffer_handle(dst_handle, src_img_buf->width, src_img_buf->height, dst_img_format);
+    src_img = wrapbuffer_handle(src_handle, src_img_buf->width, src_img_buf->height, get_rga_fmt(src_img_buf->format),
+                                get_image_width_stride(src_img_buf), get_image_height_stride(src_img_buf));
+    dst_img = wrapbuffer_handle(dst_handle, src_img_buf->width, src_img_buf->height, get_rga_fmt(dst_img_format),
+                                get_image_width_stride(src_img_buf), get_image_height_stride(src_img_buf));
 
     // int ret = imcheck(src_img, dst_img, {}, {});
     // if (IM_STATUS_NOERROR != ret) {
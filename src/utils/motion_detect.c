@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MOTION_DETECT_NEON 1
+#endif
+
+#include "motion_detect.h"
+#include "image_utils.h"
+
+#define NOISE_BITS 4
+
+void default_motion_config(motion_config_t *config)
+{
+    config->enable = 1;
+    config->scale = 4;
+    config->tile_size = 16;
+    config->threshold = 10;
+    config->min_tiles = 1;
+    config->bg_shift = 4;
+    config->max_skip = 30;
+}
+
+void init_motion_detector(motion_detector_t *detector, const motion_config_t *config)
+{
+    memset(detector, 0, sizeof(motion_detector_t));
+    detector->config = *config;
+    if (detector->config.scale < 2)
+    {
+        detector->config.scale = 2;
+    }
+    if (detector->config.tile_size < 1)
+    {
+        detector->config.tile_size = 16;
+    }
+}
+
+void release_motion_detector(motion_detector_t *detector)
+{
+    free(detector->luma);
+    free(detector->background);
+    free(detector->noise);
+    detector->luma = NULL;
+    detector->background = NULL;
+    detector->noise = NULL;
+    detector->initialized = 0;
+}
+
+static int alloc_buffers(motion_detector_t *detector, int src_width, int src_height)
+{
+    release_motion_detector(detector);
+    int scale = detector->config.scale;
+    int tile = detector->config.tile_size;
+    detector->src_width = src_width;
+    detector->src_height = src_height;
+    detector->width = src_width / scale;
+    detector->height = src_height / scale;
+    if (detector->width <= 0 || detector->height <= 0)
+    {
+        return -1;
+    }
+    detector->tiles_x = (detector->width + tile - 1) / tile;
+    detector->tiles_y = (detector->height + tile - 1) / tile;
+    detector->luma = (unsigned char *)malloc(detector->width * detector->height);
+    detector->background = (unsigned char *)malloc(detector->width * detector->height);
+    detector->noise = (unsigned short *)calloc(detector->tiles_x * detector->tiles_y, sizeof(unsigned short));
+    if (detector->luma == NULL || detector->background == NULL || detector->noise == NULL)
+    {
+        printf("motion detector malloc fail %dx%d\n", detector->width, detector->height);
+        release_motion_detector(detector);
+        return -1;
+    }
+    return 0;
+}
+
+// each sample is the mean of the top left 2x2 luma pixels of its block
+static void downsample_luma(motion_detector_t *detector, const unsigned char *y, int pitch, int step)
+{
+    int scale = detector->config.scale;
+    for (int oy = 0; oy < detector->height; oy++)
+    {
+        const unsigned char *r0 = y + oy * scale * pitch;
+        const unsigned char *r1 = r0 + pitch;
+        unsigned char *dst = detector->luma + oy * detector->width;
+        for (int ox = 0; ox < detector->width; ox++)
+        {
+            int x = ox * scale * step;
+            dst[ox] = (unsigned char)((r0[x] + r0[x + step] + r1[x] + r1[x + step] + 2) >> 2);
+        }
+    }
+}
+
+static unsigned int sad_row(const unsigned char *a, const unsigned char *b, int len)
+{
+    unsigned int sad = 0;
+    int i = 0;
+#ifdef MOTION_DETECT_NEON
+    uint16x8_t acc = vdupq_n_u16(0);
+    for (; i + 16 <= len; i += 16)
+    {
+        acc = vpadalq_u8(acc, vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+    }
+    uint32x4_t sum4 = vpaddlq_u16(acc);
+    uint64x2_t sum2 = vpaddlq_u32(sum4);
+    sad = (unsigned int)(vgetq_lane_u64(sum2, 0) + vgetq_lane_u64(sum2, 1));
+#endif
+    for (; i < len; i++)
+    {
+        sad += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    }
+    return sad;
+}
+
+static void update_background(motion_detector_t *detector)
+{
+    int shift = detector->config.bg_shift;
+    int round = (1 << shift) - 1;
+    int n = detector->width * detector->height;
+    for (int i = 0; i < n; i++)
+    {
+        // rounded away from the background so small differences still converge
+        int diff = detector->luma[i] - detector->background[i];
+        if (diff > 0)
+        {
+            detector->background[i] += (diff + round) >> shift;
+        }
+        else if (diff < 0)
+        {
+            detector->background[i] -= (-diff + round) >> shift;
+        }
+    }
+}
+
+int motion_detect(motion_detector_t *detector, image_buffer_t *image)
+{
+    const motion_config_t *config = &detector->config;
+    if (!config->enable)
+    {
+        return 1;
+    }
+    if (image == NULL || image->virt_addr == NULL)
+    {
+        return -1;
+    }
+    int step;
+    switch (image->format)
+    {
+    case IMAGE_FORMAT_YUYV_422:
+        step = 2;
+        break;
+    case IMAGE_FORMAT_YUV420SP_NV12:
+    case IMAGE_FORMAT_YUV420SP_NV21:
+    case IMAGE_FORMAT_GRAY8:
+        step = 1;
+        break;
+    default:
+        printf("motion detect no support format %d\n", image->format);
+        return -1;
+    }
+
+    if (!detector->initialized || detector->src_width != image->width || detector->src_height != image->height)
+    {
+        if (alloc_buffers(detector, image->width, image->height) != 0)
+        {
+            return -1;
+        }
+        downsample_luma(detector, image->virt_addr, get_image_pitch(image), step);
+        memcpy(detector->background, detector->luma, detector->width * detector->height);
+        detector->initialized = 1;
+        detector->skipped = 0;
+        return 1;
+    }
+
+    downsample_luma(detector, image->virt_addr, get_image_pitch(image), step);
+
+    int tile = config->tile_size;
+    int changed = 0;
+    for (int ty = 0; ty < detector->tiles_y; ty++)
+    {
+        int y0 = ty * tile;
+        int y1 = y0 + tile < detector->height ? y0 + tile : detector->height;
+        for (int tx = 0; tx < detector->tiles_x; tx++)
+        {
+            int x0 = tx * tile;
+            int x1 = x0 + tile < detector->width ? x0 + tile : detector->width;
+            unsigned int sad = 0;
+            for (int y = y0; y < y1; y++)
+            {
+                int offset = y * detector->width + x0;
+                sad += sad_row(detector->luma + offset, detector->background + offset, x1 - x0);
+            }
+            int mad = (int)((sad << NOISE_BITS) / ((y1 - y0) * (x1 - x0)));
+            unsigned short *noise = &detector->noise[ty * detector->tiles_x + tx];
+            if (mad > *noise + (config->threshold << NOISE_BITS))
+            {
+                changed++;
+            }
+            else
+            {
+                // the tile noise only learns from static frames
+                *noise = (unsigned short)(*noise + ((mad - *noise) >> 3));
+            }
+        }
+    }
+    detector->changed_tiles = changed;
+    update_background(detector);
+
+    if (changed >= config->min_tiles)
+    {
+        detector->skipped = 0;
+        return 1;
+    }
+    detector->skipped++;
+    if (config->max_skip > 0 && detector->skipped >= config->max_skip)
+    {
+        detector->skipped = 0;
+        return 1;
+    }
+    return 0;
+}
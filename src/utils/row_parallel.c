@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "row_parallel.h"
+
+// below this a stripe does not pay for its thread
+#define ROW_PARALLEL_MIN_ROWS 16
+// stripes of every caller waiting for a worker
+#define ROW_PARALLEL_QUEUE (ROW_PARALLEL_MAX_THREADS * 4)
+
+typedef struct {
+    int pending;
+    pthread_cond_t done;
+} row_batch_t;
+
+typedef struct {
+    row_task_fn task;
+    void *arg;
+    int stripe;
+    int row_begin;
+    int row_end;
+    row_batch_t *batch;
+} row_stripe_t;
+
+// workers are started once for the process and wait for stripes between frames
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t mutex;
+    pthread_cond_t work;
+    row_stripe_t queue[ROW_PARALLEL_QUEUE];
+    int head;
+    int count;
+    int num_workers;
+} pool = {PTHREAD_ONCE_INIT, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+static void run_stripe(row_stripe_t *stripe)
+{
+    stripe->task(stripe->arg, stripe->stripe, stripe->row_begin, stripe->row_end);
+    pthread_mutex_lock(&pool.mutex);
+    if (--stripe->batch->pending == 0)
+    {
+        pthread_cond_signal(&stripe->batch->done);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+}
+
+// with pool.mutex held
+static int take_stripe(row_stripe_t *stripe)
+{
+    if (pool.count == 0)
+    {
+        return 0;
+    }
+    *stripe = pool.queue[pool.head];
+    pool.head = (pool.head + 1) % ROW_PARALLEL_QUEUE;
+    pool.count--;
+    return 1;
+}
+
+static void *worker_main(void *param)
+{
+    for (;;)
+    {
+        row_stripe_t stripe;
+        pthread_mutex_lock(&pool.mutex);
+        while (!take_stripe(&stripe))
+        {
+            pthread_cond_wait(&pool.work, &pool.mutex);
+        }
+        pthread_mutex_unlock(&pool.mutex);
+        run_stripe(&stripe);
+    }
+    return NULL;
+}
+
+static void start_workers()
+{
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int count = cpus < ROW_PARALLEL_MAX_THREADS ? cpus : ROW_PARALLEL_MAX_THREADS;
+    // the caller runs one stripe itself
+    for (int i = 0; i < count - 1; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker_main, NULL) != 0)
+        {
+            printf("row_parallel: %d of %d workers started\n", i, count - 1);
+            break;
+        }
+        pthread_detach(thread);
+        pool.num_workers++;
+    }
+}
+
+int row_parallel_for(int rows, int row_align, int num_threads, row_task_fn task, void *arg)
+{
+    if (task == NULL || rows <= 0)
+    {
+        return -1;
+    }
+    if (row_align < 1)
+    {
+        row_align = 1;
+    }
+    if (num_threads <= 0)
+    {
+        num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (num_threads > ROW_PARALLEL_MAX_THREADS)
+    {
+        num_threads = ROW_PARALLEL_MAX_THREADS;
+    }
+    if (num_threads > rows / ROW_PARALLEL_MIN_ROWS)
+    {
+        num_threads = rows / ROW_PARALLEL_MIN_ROWS;
+    }
+    if (num_threads <= 1)
+    {
+        task(arg, 0, 0, rows);
+        return 0;
+    }
+    pthread_once(&pool.once, start_workers);
+
+    int stripe_rows = (rows + num_threads - 1) / num_threads;
+    stripe_rows = (stripe_rows + row_align - 1) / row_align * row_align;
+
+    row_batch_t batch;
+    batch.pending = 0;
+    pthread_cond_init(&batch.done, NULL);
+    row_stripe_t stripes[ROW_PARALLEL_MAX_THREADS];
+    int n = 0;
+    for (int row = 0; row < rows && n < num_threads; row += stripe_rows, n++)
+    {
+        stripes[n].task = task;
+        stripes[n].arg = arg;
+        stripes[n].stripe = n;
+        stripes[n].row_begin = row;
+        stripes[n].row_end = row + stripe_rows < rows ? row + stripe_rows : rows;
+        stripes[n].batch = &batch;
+    }
+
+    pthread_mutex_lock(&pool.mutex);
+    batch.pending = n;
+    int queued = 1;
+    for (; queued < n && pool.num_workers > 0 && pool.count < ROW_PARALLEL_QUEUE; queued++)
+    {
+        pool.queue[(pool.head + pool.count) % ROW_PARALLEL_QUEUE] = stripes[queued];
+        pool.count++;
+    }
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.mutex);
+
+    // no worker or no room left for the rest, run it here
+    for (int i = queued; i < n; i++)
+    {
+        run_stripe(&stripes[i]);
+    }
+    run_stripe(&stripes[0]);
+
+    pthread_mutex_lock(&pool.mutex);
+    while (batch.pending > 0)
+    {
+        // help with queued stripes instead of sleeping, a task may wait on nested stripes
+        row_stripe_t stripe;
+        if (take_stripe(&stripe))
+        {
+            pthread_mutex_unlock(&pool.mutex);
+            run_stripe(&stripe);
+            pthread_mutex_lock(&pool.mutex);
+            continue;
+        }
+        pthread_cond_wait(&batch.done, &pool.mutex);
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    pthread_cond_destroy(&batch.done);
+    return 0;
+}
@@ -57,6 +57,7 @@ static int v4l2_close(v4l2_context_t *ctx)
 v4l2_context_t *alloc_v4l2_context()
 {
         v4l2_context_t *ctx = (v4l2_context_t *)malloc(sizeof(v4l2_context_t));
+        memset(ctx, 0, sizeof(v4l2_context_t));
         ctx->open_device = open_device;
         ctx->init_device = init_device;
         ctx->start_capturing = start_capturing;
@@ -204,6 +205,11 @@ static int init_device(v4l2_context_t *ctx)
         if (fmt.fmt.pix.sizeimage < min)
                 fmt.fmt.pix.sizeimage = min;
 
+        /* consumers take the layout from here instead of assuming packed rows */
+        ctx->width = fmt.fmt.pix.width;
+        ctx->height = fmt.fmt.pix.height;
+        ctx->bytesperline = fmt.fmt.pix.bytesperline;
+
         if (ctx->io_method == IO_METHOD_MMAP)
                 return init_mmap(ctx);
         else
@@ -217,7 +223,8 @@ static void main_loop(v4l2_context_t *ctx)
         fd_set fds;
         FD_ZERO(&fds);
         FD_SET(fd, &fds);
-        for (;;)
+        /* the select timeout bounds how long a stop request waits */
+        while (ctx->run == NULL || *ctx->run)
         {
                 struct timeval tv;
                 tv.tv_sec = 2;
@@ -18,6 +18,7 @@
 #include <math.h>
 
 #include "yolov5.h"
+#include "npu_scheduler.h"
 extern "C" {
 #include "common.h"
 #include "file_utils.h"
@@ -34,6 +35,47 @@ static void dump_tensor_attr(rknn_tensor_attr *attr)
            get_qnt_type_string(attr->qnt_type), attr->zp, attr->scale);
 }
 
+static void shape_of_dims(rknn_tensor_format fmt, const uint32_t *dims, yolov5_shape_t *shape)
+{
+    if (fmt == RKNN_TENSOR_NCHW)
+    {
+        shape->height = dims[2];
+        shape->width = dims[3];
+    }
+    else
+    {
+        shape->height = dims[1];
+        shape->width = dims[2];
+    }
+}
+
+// shapes of a model compiled with dynamic input, else only the static one
+static void query_input_shapes(rknn_app_context_t *app_ctx)
+{
+    app_ctx->num_shapes = 1;
+    app_ctx->shapes[0].width = app_ctx->model_width;
+    app_ctx->shapes[0].height = app_ctx->model_height;
+
+    rknn_input_range *range = (rknn_input_range *)calloc(1, sizeof(rknn_input_range));
+    if (range == NULL)
+    {
+        return;
+    }
+    range->index = 0;
+    int ret = rknn_query(app_ctx->rknn_ctx, RKNN_QUERY_INPUT_DYNAMIC_RANGE, range, sizeof(rknn_input_range));
+    if (ret == RKNN_SUCC && range->shape_number > 1)
+    {
+        int count = range->shape_number < YOLOV5_MAX_SHAPES ? range->shape_number : YOLOV5_MAX_SHAPES;
+        for (int i = 0; i < count; i++)
+        {
+            shape_of_dims(app_ctx->input_attrs[0].fmt, range->dyn_range[i], &app_ctx->shapes[i]);
+            printf("  input shape %d: %dx%d\n", i, app_ctx->shapes[i].width, app_ctx->shapes[i].height);
+        }
+        app_ctx->num_shapes = count;
+    }
+    free(range);
+}
+
 int init_yolov5_model(rknn_app_context_t *app_ctx)
 {
     int ret;
@@ -48,7 +90,7 @@ int init_yolov5_model(rknn_app_context_t *app_ctx)
         return -1;
     }
 
-    ret = rknn_init(&ctx, model, model_len, 0, NULL);
+    ret = rknn_init(&ctx, model, model_len, app_ctx->init_flags, NULL);
     free(model);
     if (ret < 0)
     {
@@ -110,6 +152,15 @@ int init_yolov5_model(rknn_app_context_t *app_ctx)
     {
         app_ctx->is_quant = false;
     }
+#if !defined(RV1106_1103) && !defined(RKNPU1)
+    app_ctx->is_fp16 = !app_ctx->is_quant && !app_ctx->float_outputs && output_attrs[0].type == RKNN_TENSOR_FLOAT16;
+#else
+    app_ctx->is_fp16 = false;
+#endif
+    if (app_ctx->is_fp16)
+    {
+        printf("model outputs decoded as fp16\n");
+    }
 
     app_ctx->io_num = io_num;
     app_ctx->input_attrs = (rknn_tensor_attr *)malloc(io_num.n_input * sizeof(rknn_tensor_attr));
@@ -134,6 +185,123 @@ int init_yolov5_model(rknn_app_context_t *app_ctx)
     printf("model input height=%d, width=%d, channel=%d\n",
            app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
 
+    query_input_shapes(app_ctx);
+    if (app_ctx->num_shapes > 1)
+    {
+        // the compiled default can be any of them, start on the first like rknn does
+        return set_yolov5_input_shape(app_ctx, app_ctx->shapes[0].width, app_ctx->shapes[0].height);
+    }
+    return 0;
+}
+
+int set_yolov5_input_shape(rknn_app_context_t *app_ctx, int width, int height)
+{
+    if (width == app_ctx->model_width && height == app_ctx->model_height)
+    {
+        return 0;
+    }
+    int found = 0;
+    for (int i = 0; i < app_ctx->num_shapes; i++)
+    {
+        found |= app_ctx->shapes[i].width == width && app_ctx->shapes[i].height == height;
+    }
+    if (!found)
+    {
+        printf("input shape %dx%d is not one of the model\n", width, height);
+        return -1;
+    }
+
+    rknn_tensor_attr attr = app_ctx->input_attrs[0];
+    if (attr.fmt == RKNN_TENSOR_NCHW)
+    {
+        attr.dims[2] = height;
+        attr.dims[3] = width;
+    }
+    else
+    {
+        attr.dims[1] = height;
+        attr.dims[2] = width;
+    }
+    int ret = rknn_set_input_shapes(app_ctx->rknn_ctx, 1, &attr);
+    if (ret != RKNN_SUCC)
+    {
+        printf("rknn_set_input_shapes %dx%d fail! ret=%d\n", width, height, ret);
+        return -1;
+    }
+    app_ctx->input_attrs[0] = attr;
+
+    // grids and so the strides of post process come from the output dims
+    for (int i = 0; i < app_ctx->io_num.n_output; i++)
+    {
+        rknn_tensor_attr out;
+        memset(&out, 0, sizeof(out));
+        out.index = i;
+        ret = rknn_query(app_ctx->rknn_ctx, RKNN_QUERY_CURRENT_OUTPUT_ATTR, &out, sizeof(rknn_tensor_attr));
+        if (ret != RKNN_SUCC)
+        {
+            printf("rknn_query fail! ret=%d\n", ret);
+            return -1;
+        }
+        app_ctx->output_attrs[i] = out;
+    }
+    app_ctx->model_width = width;
+    app_ctx->model_height = height;
+    printf("model input shape %dx%d\n", width, height);
+    return 0;
+}
+
+int pick_yolov5_input_shape(const rknn_app_context_t *app_ctx, int src_width, int src_height, int level,
+                            yolov5_shape_t *shape)
+{
+    if (app_ctx->num_shapes <= 0 || src_width <= 0 || src_height <= 0)
+    {
+        return -1;
+    }
+
+    // share of the shape the scaled source covers, the rest is letterbox pad
+    int best = 0;
+    float best_fill = 0;
+    for (int i = 0; i < app_ctx->num_shapes; i++)
+    {
+        const yolov5_shape_t *s = &app_ctx->shapes[i];
+        float scale = fminf((float)s->width / src_width, (float)s->height / src_height);
+        float fill = scale * src_width * scale * src_height / ((float)s->width * s->height);
+        const yolov5_shape_t *b = &app_ctx->shapes[best];
+        if (fill > best_fill + 0.01f ||
+            (fill > best_fill - 0.01f && s->width * s->height > b->width * b->height))
+        {
+            best = i;
+            best_fill = fill;
+        }
+    }
+
+    // each level takes the next smaller shape of about the same aspect
+    const yolov5_shape_t *b = &app_ctx->shapes[best];
+    float aspect = (float)b->width / b->height;
+    for (int l = 0; l < level; l++)
+    {
+        int next = -1;
+        for (int i = 0; i < app_ctx->num_shapes; i++)
+        {
+            const yolov5_shape_t *s = &app_ctx->shapes[i];
+            const yolov5_shape_t *cur = &app_ctx->shapes[best];
+            if (fabsf((float)s->width / s->height - aspect) > 0.1f * aspect ||
+                s->width * s->height >= cur->width * cur->height)
+            {
+                continue;
+            }
+            if (next < 0 || s->width * s->height > app_ctx->shapes[next].width * app_ctx->shapes[next].height)
+            {
+                next = i;
+            }
+        }
+        if (next < 0)
+        {
+            break;
+        }
+        best = next;
+    }
+    *shape = app_ctx->shapes[best];
     return 0;
 }
 
@@ -149,6 +317,11 @@ int release_yolov5_model(rknn_app_context_t *app_ctx)
         free(app_ctx->output_attrs);
         app_ctx->output_attrs = NULL;
     }
+    if (app_ctx->own_internal_mem != NULL)
+    {
+        rknn_destroy_mem(app_ctx->rknn_ctx, app_ctx->own_internal_mem);
+        app_ctx->own_internal_mem = NULL;
+    }
     if (app_ctx->rknn_ctx != 0)
     {
         rknn_destroy(app_ctx->rknn_ctx);
@@ -157,45 +330,132 @@ int release_yolov5_model(rknn_app_context_t *app_ctx)
     return 0;
 }
 
-int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img, object_detect_result_list *od_results)
+int init_yolov5_input(rknn_app_context_t *app_ctx, yolov5_input_t *input)
+{
+    memset(input, 0, sizeof(yolov5_input_t));
+    input->job.fence_fd = -1;
+    input->img.format = IMAGE_FORMAT_RGB888;
+    // room for every shape, a switch only changes the dims
+    int max_size = 0;
+    for (int i = 0; i < app_ctx->num_shapes; i++)
+    {
+        input->img.width = app_ctx->shapes[i].width;
+        input->img.height = app_ctx->shapes[i].height;
+        int size = get_image_size(&input->img);
+        max_size = size > max_size ? size : max_size;
+    }
+    input->img.width = app_ctx->model_width;
+    input->img.height = app_ctx->model_height;
+    input->img.size = get_image_size(&input->img);
+    max_size = input->img.size > max_size ? input->img.size : max_size;
+    input->img.virt_addr = (unsigned char *)malloc(max_size);
+    if (input->img.virt_addr == NULL)
+    {
+        printf("malloc buffer size:%d fail!\n", max_size);
+        return -1;
+    }
+    return 0;
+}
+
+void resize_yolov5_input(rknn_app_context_t *app_ctx, yolov5_input_t *input)
+{
+    rga_job_wait(&input->job, -1);
+    input->img.width = app_ctx->model_width;
+    input->img.height = app_ctx->model_height;
+    input->img.size = get_image_size(&input->img);
+}
+
+void release_yolov5_input(yolov5_input_t *input)
+{
+    rga_job_wait(&input->job, -1);
+    release_letterbox_plan(&input->plan);
+    if (input->img.virt_addr != NULL)
+    {
+        free(input->img.virt_addr);
+        input->img.virt_addr = NULL;
+    }
+}
+
+int prepare_yolov5_input(rknn_app_context_t *app_ctx, image_buffer_t *img, yolov5_input_t *input)
+{
+    int bg_color = 114;
+
+    if ((!app_ctx) || !(img) || (!input))
+    {
+        return -1;
+    }
+
+    // the slot may still be owned by a previous job
+    rga_job_wait(&input->job, -1);
+
+    // geometry is only computed again when the stream size changes
+    if (!letterbox_plan_match(&input->plan, img, &input->img))
+    {
+        if (init_letterbox_plan(&input->plan, img->width, img->height, input->img.width, input->img.height, bg_color) != 0)
+        {
+            return -1;
+        }
+    }
+
+    int ret = convert_image_with_letterbox_plan_async(img, &input->img, &input->plan, &input->job);
+    if (ret < 0)
+    {
+        printf("convert_image_with_letterbox_plan_async fail! ret=%d\n", ret);
+        return -1;
+    }
+    return 0;
+}
+
+int prepare_yolov5_input_with_plan(rknn_app_context_t *app_ctx, image_buffer_t *img, letterbox_plan_t *plan,
+                                   yolov5_input_t *input)
+{
+    if ((!app_ctx) || !(img) || (!plan) || (!input))
+    {
+        return -1;
+    }
+
+    rga_job_wait(&input->job, -1);
+
+    int ret = convert_image_with_letterbox_plan_async(img, &input->img, plan, &input->job);
+    if (ret < 0)
+    {
+        printf("convert_image_with_letterbox_plan_async fail! ret=%d\n", ret);
+        return -1;
+    }
+    return 0;
+}
+
+int inference_yolov5_input(rknn_app_context_t *app_ctx, yolov5_input_t *input, object_detect_result_list *od_results)
+{
+    if (!input)
+    {
+        return -1;
+    }
+    return inference_yolov5_input_with_letterbox(app_ctx, input, &input->plan.letterbox, od_results);
+}
+
+int inference_yolov5_input_with_letterbox(rknn_app_context_t *app_ctx, yolov5_input_t *input, letterbox_t *letterbox,
+                                          object_detect_result_list *od_results)
 {
     int ret;
-    image_buffer_t dst_img;
-    letterbox_t letter_box;
     rknn_input inputs[app_ctx->io_num.n_input];
     rknn_output outputs[app_ctx->io_num.n_output];
-    const float nms_threshold = NMS_THRESH;      // Default NMS threshold
-    const float box_conf_threshold = BOX_THRESH; // Default box threshold
-    int bg_color = 114;
+    const float nms_threshold = app_ctx->nms_threshold > 0 ? app_ctx->nms_threshold : NMS_THRESH;
+    const float box_conf_threshold = app_ctx->box_threshold > 0 ? app_ctx->box_threshold : BOX_THRESH;
 
-    if ((!app_ctx) || !(img) || (!od_results))
+    if ((!app_ctx) || !(input) || (!letterbox) || (!od_results))
     {
         return -1;
     }
 
     memset(od_results, 0x00, sizeof(*od_results));
-    memset(&letter_box, 0, sizeof(letterbox_t));
-    memset(&dst_img, 0, sizeof(image_buffer_t));
     memset(inputs, 0, sizeof(inputs));
     memset(outputs, 0, sizeof(outputs));
 
-    // Pre Process
-    dst_img.width = app_ctx->model_width;
-    dst_img.height = app_ctx->model_height;
-    dst_img.format = IMAGE_FORMAT_RGB888;
-    dst_img.size = get_image_size(&dst_img);
-    dst_img.virt_addr = (unsigned char *)malloc(dst_img.size);
-    if (dst_img.virt_addr == NULL)
-    {
-        printf("malloc buffer size:%d fail!\n", dst_img.size);
-        return -1;
-    }
-
-    // letterbox
-    ret = convert_image_with_letterbox(img, &dst_img, &letter_box, bg_color);
+    ret = rga_job_wait(&input->job, -1);
     if (ret < 0)
     {
-        printf("convert_image_with_letterbox fail! ret=%d\n", ret);
+        printf("letterbox job fail! ret=%d\n", ret);
         return -1;
     }
 
@@ -204,8 +464,7 @@ int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img, obj
     inputs[0].type = RKNN_TENSOR_UINT8;
     inputs[0].fmt = RKNN_TENSOR_NHWC;
     inputs[0].size = app_ctx->model_width * app_ctx->model_height * app_ctx->model_channel;
-    inputs[0].buf = dst_img.virt_addr;
-    // inputs[0].buf = img;
+    inputs[0].buf = input->img.virt_addr;
 
     ret = rknn_inputs_set(app_ctx->rknn_ctx, app_ctx->io_num.n_input, inputs);
     if (ret < 0)
@@ -215,8 +474,7 @@ int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img, obj
     }
 
     // Run
-    printf("rknn_run\n");
-    ret = rknn_run(app_ctx->rknn_ctx, nullptr);
+    ret = npu_sched_run(app_ctx->npu_id, app_ctx->rknn_ctx, nullptr);
     if (ret < 0)
     {
         printf("rknn_run fail! ret=%d\n", ret);
@@ -228,26 +486,44 @@ int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img, obj
     for (int i = 0; i < app_ctx->io_num.n_output; i++)
     {
         outputs[i].index = i;
-        outputs[i].want_float = (!app_ctx->is_quant);
+        outputs[i].want_float = (!app_ctx->is_quant && !app_ctx->is_fp16);
     }
     ret = rknn_outputs_get(app_ctx->rknn_ctx, app_ctx->io_num.n_output, outputs, NULL);
     if (ret < 0)
     {
         printf("rknn_outputs_get fail! ret=%d\n", ret);
-        goto out;
+        return ret;
     }
 
     // Post Process
-    post_process(app_ctx, outputs, &letter_box, box_conf_threshold, nms_threshold, od_results);
+    post_process(app_ctx, outputs, letterbox, box_conf_threshold, nms_threshold, od_results);
 
     // Remeber to release rknn output
     rknn_outputs_release(app_ctx->rknn_ctx, app_ctx->io_num.n_output, outputs);
 
-out:
-    if (dst_img.virt_addr != NULL)
+    return ret;
+}
+
+int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img, object_detect_result_list *od_results)
+{
+    int ret;
+    yolov5_input_t input;
+
+    if ((!app_ctx) || !(img) || (!od_results))
     {
-        free(dst_img.virt_addr);
+        return -1;
     }
 
+    ret = init_yolov5_input(app_ctx, &input);
+    if (ret != 0)
+    {
+        return -1;
+    }
+    ret = prepare_yolov5_input(app_ctx, img, &input);
+    if (ret == 0)
+    {
+        ret = inference_yolov5_input(app_ctx, &input, od_results);
+    }
+    release_yolov5_input(&input);
     return ret;
-}
\ No newline at end of file
+}